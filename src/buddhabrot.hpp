@@ -0,0 +1,374 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mandelbrot_kernel.hpp"
+
+/** @brief Accumulates escaping orbits into a density buffer
+ *
+ * Each sample picks a point c, iterates it with `IterateMandelbrot` and, if
+ * it escapes, adds every point of its orbit that falls in the view to the
+ * density buffer, together with its mirror image as the set is symmetric
+ * and conj(c) has the mirrored orbit.
+ * Points of the main cardioid and the period-2 bulb never escape and are
+ * rejected before iterating.
+ *
+ * Wide views sample c uniformly. Zoomed views, where almost no orbit crosses
+ * the screen, use Metropolis sampling: the next c is a small mutation of the
+ * current one, or now and then a fresh uniform point, and is accepted with
+ * the ratio of their contributions (orbit points on screen). The current
+ * orbit is deposited once per step with a weight inversely proportional to
+ * its contribution, which undoes the bias of the sampling.
+ *
+ * One sampler per CPU, each with its own buffer, so nothing is shared while
+ * sampling. Counts saturate at 0xFFFF.
+ * @tparam FxpT 16.16 fixed-point type with BuildRaw() and RawValue()
+ * @tparam MaxIterations Iteration cap, also the longest orbit kept
+ */
+template <typename FxpT, uint16_t MaxIterations>
+class BuddhabrotSampler
+{
+private:
+    static constexpr int32_t One = 1 << 16;
+    static constexpr int32_t DomainReal = -2 * One;  ///< Left edge of the sampled c
+    static constexpr int32_t DomainImag = -3 * One / 2;
+    static constexpr int32_t DomainSpan = 3 * One;   ///< Width and height of the sampled c
+    static constexpr uint8_t RestartOdds = 8;        ///< One Metropolis proposal in this many is uniform
+    static constexpr uint16_t WeightScale = 16;      ///< Metropolis weight of an orbit with one point on screen
+
+    uint16_t *density;
+    uint16_t width;
+    uint16_t height;
+    int32_t minReal; ///< View bounds, raw 16.16
+    int32_t maxReal;
+    int32_t minImag;
+    int32_t maxImag;
+    int64_t scaleReal; ///< Pixels per raw unit, 32 fraction bits
+    int64_t scaleImag;
+    int32_t mutation;  ///< Largest Metropolis step, raw 16.16
+    bool metropolis;
+    uint32_t random;
+
+    // Orbit points on screen of the current and the proposed sample, as buffer offsets
+    uint32_t orbits[2][2 * MaxIterations];
+    uint16_t lengths[2];
+    uint8_t current;
+    int32_t currentReal;
+    int32_t currentImag;
+
+    uint32_t samples;
+    uint32_t accepted;
+    uint32_t deposits;
+
+    uint32_t next()
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+
+    /** @brief Raw value in [0, span) */
+    int32_t uniform(int32_t span)
+    {
+        return static_cast<int32_t>((static_cast<int64_t>(next() >> 16) * span) >> 16);
+    }
+
+    /** @brief Whether c is inside the main cardioid or the period-2 bulb */
+    static bool inBulbs(const FxpT &real, const FxpT &imag)
+    {
+        const FxpT quarter = FxpT::BuildRaw(One / 4);
+        const FxpT x = real - quarter;
+        const FxpT imag2 = imag * imag;
+        const FxpT q = x * x + imag2;
+
+        if (q * (q + x) < imag2 * quarter)
+        {
+            return true;
+        }
+
+        const FxpT y = real + FxpT::BuildRaw(One);
+        return y * y + imag2 < FxpT::BuildRaw(One / 16);
+    }
+
+    /** @brief Iterate c and keep its orbit points on screen
+     * @return Iterations spent
+     */
+    uint16_t trace(int32_t real, int32_t imag, uint8_t slot)
+    {
+        const FxpT cReal = FxpT::BuildRaw(real);
+        const FxpT cImag = FxpT::BuildRaw(imag);
+        uint16_t length = 0;
+
+        lengths[slot] = 0;
+
+        if (inBulbs(cReal, cImag))
+        {
+            return 1;
+        }
+
+        const uint16_t iterations = IterateMandelbrot(cReal, cImag, MaxIterations, [&](const FxpT &zReal, const FxpT &zImag)
+                                                      {
+            const int32_t x = zReal.RawValue();
+            const int32_t y = zImag.RawValue();
+
+            if (x >= minReal && x < maxReal)
+            {
+                const uint32_t column = static_cast<uint32_t>(((x - minReal) * scaleReal) >> 32);
+
+                if (y >= minImag && y < maxImag)
+                {
+                    const uint32_t row = static_cast<uint32_t>(((y - minImag) * scaleImag) >> 32);
+                    orbits[slot][length++] = row * width + column;
+                }
+
+                // The orbit of conj(c) passes through the mirror image
+                if (-y >= minImag && -y < maxImag)
+                {
+                    const uint32_t row = static_cast<uint32_t>(((-y - minImag) * scaleImag) >> 32);
+                    orbits[slot][length++] = row * width + column;
+                }
+            } });
+
+        // Orbits that never escape are the set itself, not part of the image
+        lengths[slot] = iterations < MaxIterations ? length : 0;
+        return iterations + 1;
+    }
+
+    /** @brief Add an orbit to the density buffer */
+    void deposit(uint8_t slot, uint16_t weight)
+    {
+        const uint32_t *orbit = orbits[slot];
+
+        for (uint16_t i = 0; i < lengths[slot]; ++i)
+        {
+            uint16_t &cell = density[orbit[i]];
+            cell = cell > 0xFFFF - weight ? 0xFFFF : cell + weight;
+        }
+
+        deposits += lengths[slot];
+    }
+
+public:
+    BuddhabrotSampler() : density(nullptr),
+                          width(0),
+                          height(0),
+                          minReal(0),
+                          maxReal(0),
+                          minImag(0),
+                          maxImag(0),
+                          scaleReal(0),
+                          scaleImag(0),
+                          mutation(0),
+                          metropolis(false),
+                          random(1),
+                          orbits(),
+                          lengths(),
+                          current(0),
+                          currentReal(0),
+                          currentImag(0),
+                          samples(0),
+                          accepted(0),
+                          deposits(0)
+    {
+    }
+
+    /** @brief Start sampling a view into a cleared buffer
+     * @param buffer Density buffer of width * height counts
+     * @param bufferWidth Width of the buffer
+     * @param bufferHeight Height of the buffer
+     * @param viewMinReal Raw 16.16 bounds of the view, min below max
+     * @param viewMaxReal
+     * @param viewMinImag
+     * @param viewMaxImag
+     * @param seed Random seed, different for each CPU
+     */
+    void Start(uint16_t *buffer,
+               uint16_t bufferWidth,
+               uint16_t bufferHeight,
+               int32_t viewMinReal,
+               int32_t viewMaxReal,
+               int32_t viewMinImag,
+               int32_t viewMaxImag,
+               uint32_t seed)
+    {
+        density = buffer;
+        width = bufferWidth;
+        height = bufferHeight;
+        minReal = viewMinReal;
+        maxReal = viewMaxReal;
+        minImag = viewMinImag;
+        maxImag = viewMaxImag;
+
+        // Pixels per unit, slightly less than exact so the right edge stays on screen
+        scaleReal = (static_cast<int64_t>(width) << 32) / (maxReal - minReal + 1);
+        scaleImag = (static_cast<int64_t>(height) << 32) / (maxImag - minImag + 1);
+
+        // Below a quarter of the domain, uniform samples rarely reach the screen
+        metropolis = (maxReal - minReal) < DomainSpan / 4;
+        mutation = (maxReal - minReal) / 2;
+        random = seed != 0 ? seed : 1;
+        lengths[0] = lengths[1] = 0;
+        current = 0;
+        currentReal = DomainReal;
+        currentImag = DomainImag;
+        samples = 0;
+        accepted = 0;
+        deposits = 0;
+    }
+
+    /** @brief Sample orbits until the budget is spent
+     * @param budget Work allowed, in iteration units
+     * @return Work done
+     */
+    uint32_t Run(uint32_t budget)
+    {
+        uint32_t spent = 0;
+
+        while (spent < budget)
+        {
+            ++samples;
+
+            if (!metropolis)
+            {
+                spent += trace(DomainReal + uniform(DomainSpan), DomainImag + uniform(DomainSpan), current);
+
+                if (lengths[current] > 0)
+                {
+                    ++accepted;
+                    deposit(current, 1);
+                }
+
+                continue;
+            }
+
+            const uint8_t proposal = current ^ 1;
+            int32_t real;
+            int32_t imag;
+
+            if (lengths[current] == 0 || next() % RestartOdds == 0)
+            {
+                real = DomainReal + uniform(DomainSpan);
+                imag = DomainImag + uniform(DomainSpan);
+            }
+            else
+            {
+                real = currentReal + uniform(2 * mutation) - mutation;
+                imag = currentImag + uniform(2 * mutation) - mutation;
+            }
+
+            spent += trace(real, imag, proposal);
+
+            // Accept with probability min(1, new / old)
+            const uint16_t contribution = lengths[proposal];
+            const uint16_t previous = lengths[current];
+
+            if (contribution > 0 &&
+                (previous == 0 || contribution >= previous || (next() >> 16) * previous < static_cast<uint32_t>(contribution) << 16))
+            {
+                current = proposal;
+                currentReal = real;
+                currentImag = imag;
+                ++accepted;
+            }
+
+            // Weight WeightScale / contribution, the fraction rounded at random so long orbits do not saturate the counts
+            const uint16_t length = lengths[current];
+
+            if (length > 0)
+            {
+                const uint16_t weight = WeightScale / length + (next() % length < WeightScale % length ? 1 : 0);
+
+                if (weight > 0)
+                {
+                    deposit(current, weight);
+                }
+            }
+        }
+
+        return spent;
+    }
+
+    /** @brief Orbits tried since Start() */
+    uint32_t GetSamples() const { return samples; }
+
+    /** @brief Samples that escaped (uniform) or were accepted (Metropolis) */
+    uint32_t GetAccepted() const { return accepted; }
+
+    /** @brief Orbit points added to the buffer */
+    uint32_t GetDeposits() const { return deposits; }
+
+    bool IsMetropolis() const { return metropolis; }
+};
+
+/** @brief Map the sum of per-CPU density buffers to palette indices
+ *
+ * Empty pixels get index 0, the others 1 to 254 by the square root of their
+ * density relative to the densest pixel, which keeps the faint outer orbits
+ * visible next to the bright core.
+ * @param buffers Density buffers to add up
+ * @param bufferCount Number of buffers
+ * @param count Pixels per buffer
+ * @param out Palette indices
+ * @return Density of the densest pixel
+ */
+inline uint32_t ToneMapDensity(const uint16_t *const *buffers, uint8_t bufferCount, size_t count, uint8_t *out)
+{
+    static constexpr uint16_t Levels = 254;
+    uint32_t densest = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t sum = 0;
+
+        for (uint8_t b = 0; b < bufferCount; ++b)
+        {
+            sum += buffers[b][i];
+        }
+
+        densest = sum > densest ? sum : densest;
+    }
+
+    // Index j + 1 from density thresholds[j] = densest * (j / (Levels - 1))^2 on
+    uint32_t thresholds[Levels];
+
+    for (uint16_t j = 0; j < Levels; ++j)
+    {
+        thresholds[j] = static_cast<uint32_t>(static_cast<uint64_t>(densest) * j * j / ((Levels - 1) * (Levels - 1)));
+    }
+
+    thresholds[0] = 1;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t sum = 0;
+
+        for (uint8_t b = 0; b < bufferCount; ++b)
+        {
+            sum += buffers[b][i];
+        }
+
+        // Last threshold not above the density
+        uint16_t low = 0;
+        uint16_t high = Levels;
+
+        while (low < high)
+        {
+            const uint16_t middle = (low + high) / 2;
+
+            if (thresholds[middle] <= sum)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        out[i] = static_cast<uint8_t>(low);
+    }
+
+    return densest;
+}
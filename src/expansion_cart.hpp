@@ -0,0 +1,324 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace SRL::Logger;
+
+/** @brief RAM expansion cartridge detection
+ *
+ * Probes the A-bus CS1 identification byte for the 1MB (8Mbit) and 4MB
+ * (32Mbit) extended RAM cartridges, enables the cartridge and verifies the
+ * memory with a write/read-back test. The 1MB cartridge is seen as two 512KB
+ * banks, the 4MB cartridge as one contiguous region.
+ */
+class ExpansionCart
+{
+public:
+    /** @brief Contiguous block of cartridge memory */
+    struct Region
+    {
+        uint8_t *base; ///< Cache-through address of the first byte
+        size_t size;   ///< Size in bytes
+    };
+
+    static constexpr uint8_t MaxRegions = 2;
+
+private:
+    static constexpr uintptr_t IdAddress = 0x24FFFFFF;     ///< CS1 cartridge identification byte
+    static constexpr uintptr_t EnableAddress = 0x257EFFFE; ///< Cartridge RAM write enable
+    static constexpr uintptr_t AbusSetAddress = 0x25FE00B0; ///< SCU A-bus set register (ASR0)
+    static constexpr uintptr_t RamBase = 0x22400000;
+    static constexpr uintptr_t SecondBankBase = 0x22600000;
+
+    static constexpr uint8_t Id1MB = 0x5A;
+    static constexpr uint8_t Id4MB = 0x5C;
+
+    Region regions[MaxRegions];
+    uint8_t regionCount;
+
+    /** @brief Check that a region really holds what is written to it */
+    static bool verify(const Region &region)
+    {
+        volatile uint32_t *first = reinterpret_cast<volatile uint32_t *>(region.base);
+        volatile uint32_t *last = reinterpret_cast<volatile uint32_t *>(region.base + region.size - sizeof(uint32_t));
+
+        *first = 0x5AA55AA5;
+        *last = 0xA55AA55A;
+        return *first == 0x5AA55AA5 && *last == 0xA55AA55A;
+    }
+
+public:
+    /** @brief Detect and enable the cartridge
+     *
+     * Leaves the object empty (GetSize() == 0) when no RAM cartridge is
+     * present or when it fails the memory test.
+     */
+    ExpansionCart() : regions(), regionCount(0)
+    {
+        const uint8_t id = *reinterpret_cast<volatile uint8_t *>(IdAddress);
+
+        if (id != Id1MB && id != Id4MB)
+        {
+            Log::LogPrint<LogLevels::INFO>("cart: no RAM cartridge (id 0x%x)", id);
+            return;
+        }
+
+        // Relax A-bus CS0/CS1 wait states and enable writes to cartridge RAM
+        *reinterpret_cast<volatile uint32_t *>(AbusSetAddress) = 0x23301FF0;
+        *reinterpret_cast<volatile uint16_t *>(EnableAddress) = 1;
+
+        if (id == Id4MB)
+        {
+            regions[regionCount++] = Region{reinterpret_cast<uint8_t *>(RamBase), 4 * 1024 * 1024};
+        }
+        else
+        {
+            regions[regionCount++] = Region{reinterpret_cast<uint8_t *>(RamBase), 512 * 1024};
+            regions[regionCount++] = Region{reinterpret_cast<uint8_t *>(SecondBankBase), 512 * 1024};
+        }
+
+        for (uint8_t i = 0; i < regionCount; ++i)
+        {
+            if (!verify(regions[i]))
+            {
+                Log::LogPrint<LogLevels::WARNING>("cart: memory test failed at 0x%x", reinterpret_cast<uintptr_t>(regions[i].base));
+                regionCount = 0;
+                return;
+            }
+        }
+
+        Log::LogPrint<LogLevels::INFO>("cart: %dKB RAM cartridge detected", static_cast<int32_t>(GetSize() / 1024));
+    }
+
+    /** @brief Total usable cartridge memory in bytes, 0 when absent */
+    size_t GetSize() const
+    {
+        size_t size = 0;
+
+        for (uint8_t i = 0; i < regionCount; ++i)
+        {
+            size += regions[i].size;
+        }
+
+        return size;
+    }
+
+    /** @brief Whether a working RAM cartridge was found */
+    bool IsPresent() const { return regionCount > 0; }
+
+    /** @brief Number of contiguous regions */
+    uint8_t GetRegionCount() const { return regionCount; }
+
+    /** @brief Get a contiguous region */
+    const Region &GetRegion(uint8_t index) const { return regions[index]; }
+};
+
+/** @brief Large frame cache living in expansion cartridge RAM
+ *
+ * Stores raw snapshots of the canvas and of the iteration buffer, keyed by
+ * view. A snapshot records how many rows were rendered, so it serves both as
+ * a cached image of a completed view and as resumable state of a view left
+ * half rendered. Snapshots are moved with DMA in both directions so loading
+ * a cached view costs bus time only.
+ *
+ * Memory is managed as a ring: new snapshots are written after the newest
+ * one and overwrite the oldest, never spanning a region boundary. The
+ * descriptors stay in work RAM.
+ * @tparam KeyT Snapshot key, must be copyable and comparable with ==
+ * @tparam MaxEntries Maximum number of snapshots tracked
+ */
+template <typename KeyT, size_t MaxEntries = 32>
+class CartCache
+{
+private:
+    /** @brief Descriptor of one snapshot */
+    struct Entry
+    {
+        KeyT key;           ///< Key the snapshot was stored under
+        uint8_t *address;   ///< Start of the snapshot in cartridge memory
+        size_t canvasSize;  ///< Bytes of canvas data
+        size_t bufferSize;  ///< Bytes of iteration data following the canvas
+        uint16_t rows;      ///< Number of fully rendered rows
+        uint32_t sequence;  ///< Store order, lowest is the oldest
+        bool live;          ///< Slot in use
+    };
+
+    const ExpansionCart &cart;
+    Entry entries[MaxEntries];
+    uint32_t sequence;
+    uint8_t region;  ///< Region the ring head is in
+    size_t head;     ///< Offset of the ring head within the region
+
+    /** @brief Round a size up to a 4 byte multiple for DMA */
+    static size_t align(size_t size)
+    {
+        return (size + 3) & ~static_cast<size_t>(3);
+    }
+
+    /** @brief Find a live entry for a key
+     * @return Entry index or -1
+     */
+    int32_t find(const KeyT &key) const
+    {
+        for (size_t i = 0; i < MaxEntries; ++i)
+        {
+            if (entries[i].live && entries[i].key == key)
+            {
+                return static_cast<int32_t>(i);
+            }
+        }
+
+        return -1;
+    }
+
+    /** @brief Drop every entry overlapping [begin, end) */
+    void evict(const uint8_t *begin, const uint8_t *end)
+    {
+        for (size_t i = 0; i < MaxEntries; ++i)
+        {
+            const uint8_t *start = entries[i].address;
+            const uint8_t *stop = start + align(entries[i].canvasSize) + entries[i].bufferSize;
+
+            if (entries[i].live && start < end && begin < stop)
+            {
+                entries[i].live = false;
+            }
+        }
+    }
+
+    /** @brief Reserve space at the ring head, evicting what it overlaps
+     * @return Start address or nullptr when the snapshot can never fit
+     */
+    uint8_t *allocate(size_t size)
+    {
+        for (uint8_t tries = 0; tries <= cart.GetRegionCount(); ++tries)
+        {
+            const ExpansionCart::Region &current = cart.GetRegion(region);
+
+            if (head + size <= current.size)
+            {
+                uint8_t *address = current.base + head;
+                evict(address, address + size);
+                head += size;
+                return address;
+            }
+
+            region = (region + 1) % cart.GetRegionCount();
+            head = 0;
+        }
+
+        return nullptr;
+    }
+
+public:
+    /** @brief Construct an empty cache over the cartridge memory */
+    explicit CartCache(const ExpansionCart &cart) : cart(cart), entries(), sequence(0), region(0), head(0) {}
+
+    /** @brief Whether the cache has any memory to work with */
+    bool IsAvailable() const { return cart.IsPresent(); }
+
+    /** @brief Store a snapshot, replacing any previous one for the key
+     * @param key Key of the snapshot
+     * @param rows Number of fully rendered rows
+     * @param canvas Canvas pixels
+     * @param canvasSize Size of the canvas in bytes
+     * @param iterations Iteration buffer
+     * @param bufferSize Size of the iteration buffer in bytes
+     * @return true when the snapshot was stored
+     */
+    bool Store(const KeyT &key, uint16_t rows, const uint8_t *canvas, size_t canvasSize, const uint16_t *iterations, size_t bufferSize)
+    {
+        if (!IsAvailable())
+        {
+            return false;
+        }
+
+        const int32_t existing = find(key);
+
+        if (existing >= 0)
+        {
+            entries[existing].live = false;
+        }
+
+        uint8_t *address = allocate(align(canvasSize) + align(bufferSize));
+
+        if (address == nullptr)
+        {
+            return false;
+        }
+
+        // Reuse a free descriptor, or the oldest one when all are taken
+        size_t slot = 0;
+
+        for (size_t i = 0; i < MaxEntries; ++i)
+        {
+            if (!entries[i].live)
+            {
+                slot = i;
+                break;
+            }
+
+            if (entries[i].sequence < entries[slot].sequence)
+            {
+                slot = i;
+            }
+        }
+
+        entries[slot] = Entry{key, address, canvasSize, bufferSize, rows, sequence++, true};
+
+        slDMACopy(const_cast<uint8_t *>(canvas), address, align(canvasSize));
+        slDMAWait();
+        slDMACopy(const_cast<uint16_t *>(iterations), address + align(canvasSize), align(bufferSize));
+        slDMAWait();
+
+        Log::LogPrint<LogLevels::DEBUG>("cart: stored %d rows at 0x%x", rows, reinterpret_cast<uintptr_t>(address));
+        return true;
+    }
+
+    /** @brief Load a snapshot back into work RAM
+     * @param key Key of the snapshot
+     * @param rows Receives the number of fully rendered rows
+     * @param canvas Destination canvas pixels
+     * @param iterations Destination iteration buffer
+     * @return true when a snapshot was found and loaded
+     */
+    bool Load(const KeyT &key, uint16_t &rows, uint8_t *canvas, uint16_t *iterations) const
+    {
+        const int32_t index = find(key);
+
+        if (index < 0)
+        {
+            return false;
+        }
+
+        const Entry &entry = entries[index];
+
+        slDMACopy(entry.address, canvas, align(entry.canvasSize));
+        slDMAWait();
+        slDMACopy(entry.address + align(entry.canvasSize), iterations, align(entry.bufferSize));
+        slDMAWait();
+
+        // DMA bypasses the CPU cache, drop any stale lines of the destinations
+        slCashPurge();
+
+        rows = entry.rows;
+        return true;
+    }
+
+    /** @brief Number of snapshots currently held */
+    size_t GetCount() const
+    {
+        size_t count = 0;
+
+        for (size_t i = 0; i < MaxEntries; ++i)
+        {
+            count += entries[i].live ? 1 : 0;
+        }
+
+        return count;
+    }
+};
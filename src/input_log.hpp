@@ -0,0 +1,370 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Recorded pad input, for replaying a navigation session
+ *
+ * Shared by the Saturn renderer and the host tool (`tools/inputlog.cxx`).
+ * The pad state is sampled once per frame and only its changes are stored,
+ * so holding a direction for seconds costs one event. Multi-byte fields are
+ * big-endian and read byte by byte, like `ZoomStream`.
+ *
+ * File layout:
+ * - header: magic, 32-bit frame count, 32-bit event count
+ * - events: 16-bit frames since the previous event, 16-bit button mask
+ *
+ * Gaps longer than 0xFFFF frames are split with events repeating the mask.
+ */
+namespace InputLog
+{
+    static constexpr uint8_t Magic[4] = {'M', 'I', 'L', '1'};
+    static constexpr size_t HeaderSize = 12;
+    static constexpr size_t EventSize = 4;
+
+    /** @brief Buttons of the mask, independent of the SDK's own values */
+    enum Button : uint16_t
+    {
+        Left = 1 << 0,
+        Right = 1 << 1,
+        Up = 1 << 2,
+        Down = 1 << 3,
+        A = 1 << 4,
+        B = 1 << 5,
+        C = 1 << 6,
+        X = 1 << 7,
+        Y = 1 << 8,
+        Z = 1 << 9,
+        L = 1 << 10,
+        R = 1 << 11,
+        Start = 1 << 12
+    };
+
+    /** @brief Pad state change */
+    struct Event
+    {
+        uint16_t delay;   ///< Frames since the previous event, or since the start
+        uint16_t buttons; ///< Mask of the held buttons from that frame on
+    };
+
+    inline uint16_t Read16(const uint8_t *in)
+    {
+        return static_cast<uint16_t>((in[0] << 8) | in[1]);
+    }
+
+    inline uint32_t Read32(const uint8_t *in)
+    {
+        return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+               (static_cast<uint32_t>(in[2]) << 8) | in[3];
+    }
+
+    inline void Write16(uint8_t *out, uint16_t value)
+    {
+        out[0] = static_cast<uint8_t>(value >> 8);
+        out[1] = static_cast<uint8_t>(value);
+    }
+
+    inline void Write32(uint8_t *out, uint32_t value)
+    {
+        out[0] = static_cast<uint8_t>(value >> 24);
+        out[1] = static_cast<uint8_t>(value >> 16);
+        out[2] = static_cast<uint8_t>(value >> 8);
+        out[3] = static_cast<uint8_t>(value);
+    }
+
+    /** @brief Bytes of a log holding `eventCount` events */
+    inline constexpr size_t FileSize(uint32_t eventCount)
+    {
+        return HeaderSize + eventCount * EventSize;
+    }
+
+    /** @brief Parse a log header
+     * @return false when the magic does not match
+     */
+    inline bool ParseHeader(const uint8_t *in, uint32_t &frameCount, uint32_t &eventCount)
+    {
+        for (size_t i = 0; i < sizeof(Magic); ++i)
+        {
+            if (in[i] != Magic[i])
+            {
+                return false;
+            }
+        }
+
+        frameCount = Read32(in + 4);
+        eventCount = Read32(in + 8);
+        return true;
+    }
+
+    /** @brief Serialize a log header into HeaderSize bytes */
+    inline void WriteHeader(uint8_t *out, uint32_t frameCount, uint32_t eventCount)
+    {
+        for (size_t i = 0; i < sizeof(Magic); ++i)
+        {
+            out[i] = Magic[i];
+        }
+
+        Write32(out + 4, frameCount);
+        Write32(out + 8, eventCount);
+    }
+
+    inline Event ReadEvent(const uint8_t *in)
+    {
+        return Event{Read16(in), Read16(in + 2)};
+    }
+
+    inline void WriteEvent(uint8_t *out, const Event &event)
+    {
+        Write16(out, event.delay);
+        Write16(out + 2, event.buttons);
+    }
+}
+
+/** @brief Where the main loop takes its pad input from */
+enum class InputMode : uint8_t
+{
+    Live,   ///< The pad
+    Record, ///< The pad, logged for a later replay
+    Replay  ///< A recorded log, the pad is ignored until it ends
+};
+
+/** @brief Pad state of the current and the previous frame
+ *
+ * Gives the main loop the same queries whether the buttons come from the
+ * pad or from a replayed log.
+ */
+class PadState
+{
+private:
+    uint16_t held = 0;
+    uint16_t previous = 0;
+
+public:
+    /** @brief Move to the next frame */
+    void Update(uint16_t buttons)
+    {
+        previous = held;
+        held = buttons;
+    }
+
+    uint16_t GetButtons() const { return held; }
+
+    bool IsHeld(uint16_t button) const { return (held & button) != 0; }
+
+    /** @brief Whether a button went down this frame */
+    bool WasPressed(uint16_t button) const { return (held & ~previous & button) != 0; }
+};
+
+/** @brief Collects pad states into a log in memory
+ * @tparam MaxEvents Events kept, recording stops when they are used up
+ */
+template <size_t MaxEvents>
+class InputRecorder
+{
+private:
+    InputLog::Event events[MaxEvents];
+    uint32_t eventCount = 0;
+    uint32_t frameCount = 0;
+    uint32_t lastEventFrame = 0;
+    uint16_t last = 0;
+
+public:
+    /** @brief Record the state of one frame
+     * @return false when the log is full and the frame was dropped
+     */
+    bool Record(uint16_t buttons)
+    {
+        if (IsFull())
+        {
+            return false;
+        }
+
+        if (buttons != last || frameCount - lastEventFrame == 0xFFFF)
+        {
+            events[eventCount++] = InputLog::Event{static_cast<uint16_t>(frameCount - lastEventFrame), buttons};
+            lastEventFrame = frameCount;
+            last = buttons;
+        }
+
+        ++frameCount;
+        return true;
+    }
+
+    /** @brief Whether no event can be added */
+    bool IsFull() const { return eventCount >= MaxEvents; }
+
+    uint32_t GetEventCount() const { return eventCount; }
+
+    uint32_t GetFrameCount() const { return frameCount; }
+
+    const InputLog::Event &GetEvent(uint32_t index) const { return events[index]; }
+
+    /** @brief Serialize the log
+     * @param out Destination of InputLog::FileSize(GetEventCount()) bytes
+     */
+    void Write(uint8_t *out) const
+    {
+        InputLog::WriteHeader(out, frameCount, eventCount);
+
+        for (uint32_t i = 0; i < eventCount; ++i)
+        {
+            InputLog::WriteEvent(out + InputLog::HeaderSize + i * InputLog::EventSize, events[i]);
+        }
+    }
+};
+
+/** @brief Plays a serialized log back one frame at a time
+ *
+ * Reads the events straight from the file image, which has to stay valid
+ * while playing.
+ */
+class InputReplayer
+{
+private:
+    const uint8_t *data = nullptr;
+    uint32_t frameCount = 0;
+    uint32_t eventCount = 0;
+    uint32_t nextEvent = 0;
+    uint32_t frame = 0;
+    uint32_t nextEventFrame = 0;
+    uint16_t buttons = 0;
+
+    void schedule()
+    {
+        if (nextEvent < eventCount)
+        {
+            nextEventFrame += InputLog::Read16(data + InputLog::HeaderSize + nextEvent * InputLog::EventSize);
+        }
+    }
+
+public:
+    /** @brief Start playing a log
+     * @param file File image
+     * @param size Bytes of the file image
+     * @return false when it is not a log or is truncated
+     */
+    bool Open(const uint8_t *file, size_t size)
+    {
+        data = nullptr;
+
+        if (size < InputLog::HeaderSize || !InputLog::ParseHeader(file, frameCount, eventCount) ||
+            size < InputLog::FileSize(eventCount))
+        {
+            return false;
+        }
+
+        data = file;
+        nextEvent = 0;
+        frame = 0;
+        nextEventFrame = 0;
+        buttons = 0;
+        schedule();
+        return true;
+    }
+
+    /** @brief Buttons held in the next frame, only while not IsDone() */
+    uint16_t Next()
+    {
+        while (nextEvent < eventCount && frame == nextEventFrame)
+        {
+            buttons = InputLog::ReadEvent(data + InputLog::HeaderSize + nextEvent * InputLog::EventSize).buttons;
+            ++nextEvent;
+            schedule();
+        }
+
+        ++frame;
+        return buttons;
+    }
+
+    bool IsOpen() const { return data != nullptr; }
+
+    /** @brief Whether every recorded frame was played */
+    bool IsDone() const { return frame >= frameCount; }
+
+    uint32_t GetFrameCount() const { return frameCount; }
+};
+
+/** @brief Frame time, input latency and throughput of a replayed session */
+class ReplayStats
+{
+private:
+    uint8_t targetFields;
+    uint32_t frames = 0;
+    uint32_t fields = 0;
+    uint16_t maxFields = 0;
+    uint32_t lateFrames = 0;
+    uint32_t pixels = 0;
+    uint32_t maxPixels = 0;
+    uint32_t latencies = 0;
+    uint32_t latencyFields = 0;
+    uint16_t maxLatency = 0;
+    uint32_t pendingSince = 0; ///< Field count when the waiting input came
+    bool pending = false;
+
+public:
+    /** @param targetFields Fields per frame the session aims for */
+    explicit ReplayStats(uint8_t targetFields) : targetFields(targetFields)
+    {
+    }
+
+    /** @brief Account for a finished frame
+     * @param frameFields Display fields the frame took
+     * @param framePixels Pixels the renderer completed during the frame
+     */
+    void FrameDone(uint16_t frameFields, uint32_t framePixels)
+    {
+        ++frames;
+        fields += frameFields;
+        maxFields = frameFields > maxFields ? frameFields : maxFields;
+        lateFrames += frameFields > targetFields ? 1 : 0;
+        pixels += framePixels;
+        maxPixels = framePixels > maxPixels ? framePixels : maxPixels;
+    }
+
+    /** @brief The view changed, latency runs until ViewShown()
+     * @param now Fields since the session started, before the current frame
+     */
+    void ViewRequested(uint32_t now)
+    {
+        if (!pending)
+        {
+            pendingSince = now;
+            pending = true;
+        }
+    }
+
+    /** @brief The requested view is covered on screen, by its preview or a cached image
+     * @param now Fields since the session started, after the current frame
+     */
+    void ViewShown(uint32_t now)
+    {
+        if (!pending)
+        {
+            return;
+        }
+
+        const uint16_t latency = static_cast<uint16_t>(now - pendingSince);
+        ++latencies;
+        latencyFields += latency;
+        maxLatency = latency > maxLatency ? latency : maxLatency;
+        pending = false;
+    }
+
+    uint32_t GetFrames() const { return frames; }
+
+    uint32_t GetFields() const { return fields; }
+
+    uint16_t GetMaxFields() const { return maxFields; }
+
+    uint32_t GetLateFrames() const { return lateFrames; }
+
+    uint32_t GetPixels() const { return pixels; }
+
+    uint32_t GetMaxPixels() const { return maxPixels; }
+
+    uint32_t GetLatencies() const { return latencies; }
+
+    uint32_t GetLatencyFields() const { return latencyFields; }
+
+    uint16_t GetMaxLatency() const { return maxLatency; }
+};
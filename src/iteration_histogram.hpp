@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Histogram of iteration counts for equalized coloring
+ *
+ * Counts how many pixels escaped after each number of iterations, with the
+ * last bin holding the pixels that reached the cap (the set interior). Each
+ * worker fills its own histogram as its pixels complete, so no counter is
+ * shared between processors; they are merged once when the palette mapping
+ * is rebuilt.
+ * @tparam MaxIterations Iteration cap, the index of the interior bin
+ */
+template <uint16_t MaxIterations>
+class IterationHistogram
+{
+private:
+    uint32_t counts[MaxIterations + 1];
+
+    static uint16_t bin(uint16_t iteration)
+    {
+        return iteration < MaxIterations ? iteration : MaxIterations;
+    }
+
+public:
+    IterationHistogram() : counts()
+    {
+    }
+
+    /** @brief Forget all counts */
+    void Clear()
+    {
+        for (uint16_t i = 0; i <= MaxIterations; ++i)
+        {
+            counts[i] = 0;
+        }
+    }
+
+    /** @brief Count one completed pixel */
+    void Add(uint16_t iteration)
+    {
+        ++counts[bin(iteration)];
+    }
+
+    /** @brief Take back a pixel counted before, when it gets recomputed */
+    void Remove(uint16_t iteration)
+    {
+        uint32_t &count = counts[bin(iteration)];
+        count = count > 0 ? count - 1 : 0;
+    }
+
+    /** @brief Count a run of completed pixels */
+    void AddRange(const uint16_t *iterations, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            ++counts[bin(iterations[i])];
+        }
+    }
+
+    /** @brief Add the counts of another histogram */
+    void Merge(const IterationHistogram &other)
+    {
+        for (uint16_t i = 0; i <= MaxIterations; ++i)
+        {
+            counts[i] += other.counts[i];
+        }
+    }
+
+    /** @brief Number of pixels counted */
+    uint32_t GetTotal() const
+    {
+        uint32_t total = 0;
+
+        for (uint16_t i = 0; i <= MaxIterations; ++i)
+        {
+            total += counts[i];
+        }
+
+        return total;
+    }
+
+    /** @brief Build a histogram-equalized palette mapping
+     *
+     * Escaped pixels are spread over [first, last] by the cumulative
+     * distribution of their iteration counts, so every palette entry covers
+     * about the same number of pixels however the counts are distributed.
+     * @param lut Receives one palette index per iteration count, MaxIterations + 1 entries
+     * @param first First palette index for escaped pixels
+     * @param last Last palette index for escaped pixels
+     * @param interior Palette index of pixels that reached the cap
+     */
+    void BuildEqualizedLut(uint8_t *lut, uint8_t first, uint8_t last, uint8_t interior) const
+    {
+        const uint32_t range = last - first;
+        const uint32_t escaped = GetTotal() - counts[MaxIterations];
+        uint32_t running = 0;
+
+        for (uint16_t i = 0; i < MaxIterations; ++i)
+        {
+            running += counts[i];
+            lut[i] = escaped > 0 ? static_cast<uint8_t>(first + running * range / escaped)
+                                 : static_cast<uint8_t>(first + i % (range + 1));
+        }
+
+        lut[MaxIterations] = interior;
+    }
+};
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief MC68EC000 Mandelbrot program for the sound CPU
+ *
+ * Iterates a batch of 16.16 fixed-point pixels on the 68000. The program is
+ * assembled at compile time from the helpers below so the Saturn loader
+ * (`SoundCpuWorker`) and the host emulator (`tools/m68ksim.cxx`) share the
+ * very same words.
+ *
+ * The 68000 only multiplies 16 by 16 bits, so each 16.16 product is built
+ * from the four partial products of its halves with MULU, corrected for the
+ * sign of each operand, keeping bits 47..16 like the SH2 `Fxp` multiply.
+ * Squares need three of them.
+ *
+ * Sound RAM layout (68000 addresses, big-endian like the SH2):
+ * - 0x0000: reset vectors, stack pointer and entry point
+ * - ProgramAddress: the program
+ * - MailboxAddress: batch parameters and results (see Slot)
+ * - StackTop: top of the stack, which the program never uses
+ *
+ * The program waits for Slot::Command to become non-zero, iterates the
+ * batch, stores each count and bumps Slot::Done as it goes and clears
+ * Slot::Command when it is finished. Slot::Cancel is checked once per
+ * iteration: when set, the batch ends at once and the pixel in progress is
+ * dropped, so whoever cancels never waits more than one iteration.
+ */
+namespace SoundCpu
+{
+    static constexpr uint32_t ProgramAddress = 0x400;  ///< After the exception vectors
+    static constexpr uint32_t MailboxAddress = 0x1000;
+    static constexpr uint32_t StackTop = 0x2000;
+    static constexpr size_t ProgramSize = (MailboxAddress - ProgramAddress) / 2; ///< Words available for the program
+    static constexpr size_t MaxBatch = 32;             ///< Pixels per batch
+
+    /** @brief Mailbox word assignment */
+    namespace Slot
+    {
+        static constexpr uint16_t Command = 0;       ///< Set by the SH2 to start a batch, cleared by the 68000 at its end
+        static constexpr uint16_t Cancel = 1;        ///< Set by the SH2 to end the batch early
+        static constexpr uint16_t Count = 2;         ///< Pixels in the batch
+        static constexpr uint16_t MaxIterations = 3;
+        static constexpr uint16_t Done = 4;          ///< Counts stored so far
+        static constexpr uint16_t Results = 8;       ///< MaxBatch iteration counts
+        static constexpr uint16_t CReal = Results + MaxBatch;   ///< MaxBatch raw 16.16 values, high word first
+        static constexpr uint16_t CImag = CReal + 2 * MaxBatch;
+        static constexpr uint16_t Words = CImag + 2 * MaxBatch; ///< Size of the mailbox
+    }
+
+    static_assert(MailboxAddress + 2 * Slot::Words <= StackTop, "mailbox overlaps the stack");
+
+    /** @brief Data registers, address registers are plain numbers 0-7 */
+    enum Reg : uint16_t
+    {
+        D0,
+        D1,
+        D2,
+        D3,
+        D4,
+        D5,
+        D6,
+        D7
+    };
+
+    /** @brief Branch conditions */
+    enum Cond : uint16_t
+    {
+        Always = 0x0, ///< BRA
+        HS = 0x4,     ///< Unsigned higher or same (BCC)
+        NE = 0x6,
+        EQ = 0x7,
+        PL = 0xA,
+        GT = 0xE
+    };
+
+    // Effective address fields, mode << 3 | register
+    constexpr uint16_t Data(uint16_t d) { return d; }
+    constexpr uint16_t Addr(uint16_t a) { return 0x08 | a; }
+    constexpr uint16_t Ind(uint16_t a) { return 0x10 | a; }
+    constexpr uint16_t PostInc(uint16_t a) { return 0x18 | a; }
+    constexpr uint16_t Disp(uint16_t a) { return 0x28 | a; } ///< Followed by a 16-bit displacement
+    static constexpr uint16_t Imm = 0x3C;                    ///< Followed by the immediate
+
+    /** @brief Destination field of MOVE, register and mode swapped */
+    constexpr uint16_t MoveDst(uint16_t ea) { return static_cast<uint16_t>(((ea & 7) << 9) | ((ea >> 3) << 6)); }
+
+    /** @brief Two-pass compile-time assembler
+     *
+     * The first pass records label addresses, the second one resolves the
+     * forward branches against them. Branches to labels always take the
+     * 16-bit displacement form so both passes lay out the same code.
+     */
+    struct Assembler
+    {
+        enum Label : uint8_t
+        {
+            Idle,
+            Pixel,
+            Loop,
+            Done,
+            Finish,
+            LabelCount
+        };
+
+        uint16_t code[ProgramSize] = {};
+        size_t size = 0;
+        uint16_t labels[LabelCount] = {};
+
+        constexpr void Emit(uint16_t word) { code[size++] = word; }
+        constexpr void Emit32(uint32_t value)
+        {
+            Emit(static_cast<uint16_t>(value >> 16));
+            Emit(static_cast<uint16_t>(value));
+        }
+
+        /** @brief Byte address of the next word */
+        constexpr uint16_t Here() const { return static_cast<uint16_t>(ProgramAddress + 2 * size); }
+        constexpr void Mark(Label label) { labels[label] = Here(); }
+
+        /** @brief Bcc.W to a label */
+        constexpr void Branch(Cond cond, Label label)
+        {
+            const uint16_t from = static_cast<uint16_t>(Here() + 2);
+            Emit(static_cast<uint16_t>(0x6000 | (cond << 8)));
+            Emit(static_cast<uint16_t>(labels[label] - from));
+        }
+
+        /** @brief Bcc.B over the next `words` words */
+        constexpr void Skip(Cond cond, uint8_t words) { Emit(static_cast<uint16_t>(0x6000 | (cond << 8) | (2 * words))); }
+
+        constexpr void MoveL(uint16_t src, uint16_t dst) { Emit(static_cast<uint16_t>(0x2000 | MoveDst(dst) | src)); }
+        constexpr void MoveW(uint16_t src, uint16_t dst) { Emit(static_cast<uint16_t>(0x3000 | MoveDst(dst) | src)); }
+        constexpr void Moveq(int8_t value, Reg d) { Emit(static_cast<uint16_t>(0x7000 | (d << 9) | static_cast<uint8_t>(value))); }
+        constexpr void Lea(uint16_t src, uint16_t a) { Emit(static_cast<uint16_t>(0x41C0 | (a << 9) | src)); }
+        constexpr void AddL(uint16_t src, Reg d) { Emit(static_cast<uint16_t>(0xD080 | (d << 9) | src)); }
+        constexpr void SubL(uint16_t src, Reg d) { Emit(static_cast<uint16_t>(0x9080 | (d << 9) | src)); }
+        constexpr void AddaL(uint16_t src, uint16_t a) { Emit(static_cast<uint16_t>(0xD1C0 | (a << 9) | src)); }
+        constexpr void Mulu(uint16_t src, Reg d) { Emit(static_cast<uint16_t>(0xC0C0 | (d << 9) | src)); }
+        constexpr void CmpW(uint16_t src, Reg d) { Emit(static_cast<uint16_t>(0xB040 | (d << 9) | src)); }
+        constexpr void CmpaL(uint16_t src, uint16_t a) { Emit(static_cast<uint16_t>(0xB1C0 | (a << 9) | src)); }
+        constexpr void CmpiL(uint32_t value, Reg d)
+        {
+            Emit(static_cast<uint16_t>(0x0C80 | d));
+            Emit32(value);
+        }
+        constexpr void AddqW(uint8_t value, uint16_t dst) { Emit(static_cast<uint16_t>(0x5040 | ((value & 7) << 9) | dst)); }
+        constexpr void AddqL(uint8_t value, uint16_t dst) { Emit(static_cast<uint16_t>(0x5080 | ((value & 7) << 9) | dst)); }
+        constexpr void ClrW(uint16_t dst) { Emit(static_cast<uint16_t>(0x4240 | dst)); }
+        constexpr void TstW(uint16_t src) { Emit(static_cast<uint16_t>(0x4A40 | src)); }
+        constexpr void TstL(uint16_t src) { Emit(static_cast<uint16_t>(0x4A80 | src)); }
+        constexpr void Swap(Reg d) { Emit(static_cast<uint16_t>(0x4840 | d)); }
+
+        /** @brief Mailbox word through A0 */
+        constexpr void Mailbox(uint16_t slot) { Emit(static_cast<uint16_t>(2 * slot)); }
+
+        /** @brief out = a * b, 16.16, with one scratch register
+         *
+         * With a = ah:al and b = bh:bl, bits 47..16 of the product are
+         * al*bl >> 16 + ah*bl + al*bh + ah*bh << 16, where MULU treats ah and
+         * bh as unsigned: a negative operand adds the other's low half
+         * shifted by 16, which is taken back. b is swapped and restored.
+         */
+        constexpr void Multiply(Reg a, Reg b, Reg out, Reg t)
+        {
+            MoveL(Data(a), Data(out));
+            Mulu(Data(b), out);
+            ClrW(Data(out));
+            Swap(out);
+            MoveL(Data(a), Data(t));
+            Swap(t);
+            Mulu(Data(b), t);
+            AddL(Data(t), out);
+            Swap(b);
+            MoveL(Data(a), Data(t));
+            Mulu(Data(b), t);
+            AddL(Data(t), out);
+            MoveL(Data(a), Data(t));
+            Swap(t);
+            Mulu(Data(b), t);
+            Swap(t);
+            ClrW(Data(t));
+            AddL(Data(t), out);
+            Swap(b);
+
+            TstL(Data(a));
+            Skip(PL, 4);
+            MoveL(Data(b), Data(t));
+            Swap(t);
+            ClrW(Data(t));
+            SubL(Data(t), out);
+
+            TstL(Data(b));
+            Skip(PL, 4);
+            MoveL(Data(a), Data(t));
+            Swap(t);
+            ClrW(Data(t));
+            SubL(Data(t), out);
+        }
+
+        /** @brief out = a * a, 16.16, the cross product computed once and doubled */
+        constexpr void Square(Reg a, Reg out, Reg t)
+        {
+            MoveL(Data(a), Data(out));
+            Mulu(Data(out), out);
+            ClrW(Data(out));
+            Swap(out);
+            MoveL(Data(a), Data(t));
+            Swap(t);
+            Mulu(Data(a), t);
+            AddL(Data(t), t);
+            AddL(Data(t), out);
+            MoveL(Data(a), Data(t));
+            Swap(t);
+            Mulu(Data(t), t);
+            Swap(t);
+            ClrW(Data(t));
+            AddL(Data(t), out);
+
+            TstL(Data(a));
+            Skip(PL, 5);
+            MoveL(Data(a), Data(t));
+            Swap(t);
+            ClrW(Data(t));
+            AddL(Data(t), t);
+            SubL(Data(t), out);
+        }
+    };
+
+    /** @brief Assemble the program
+     *
+     * A0 mailbox, A1/A2 c of the current pixel, A3 next result, A4 end of
+     * the results. D0/D1 z, D2/D3 squares of z, D4 scratch, D5 cross term,
+     * D6 2 * zReal then |z|^2, D7 iteration.
+     * @param labels Label addresses from a previous pass
+     */
+    constexpr Assembler Assemble(const uint16_t (&labels)[Assembler::LabelCount])
+    {
+        Assembler a;
+
+        for (size_t i = 0; i < Assembler::LabelCount; ++i)
+        {
+            a.labels[i] = labels[i];
+        }
+
+        a.Emit(static_cast<uint16_t>(0x2000 | MoveDst(Addr(0)) | Imm)); // MOVEA.L #MailboxAddress,A0
+        a.Emit32(MailboxAddress);
+
+        a.Mark(Assembler::Idle);
+        a.TstW(Disp(0));
+        a.Mailbox(Slot::Command);
+        a.Branch(EQ, Assembler::Idle);
+
+        // Batch setup
+        a.Lea(Disp(0), 1);
+        a.Mailbox(Slot::CReal);
+        a.Lea(Disp(0), 2);
+        a.Mailbox(Slot::CImag);
+        a.Lea(Disp(0), 3);
+        a.Mailbox(Slot::Results);
+        a.Moveq(0, D6);
+        a.MoveW(Disp(0), Data(D6));
+        a.Mailbox(Slot::Count);
+        a.AddL(Data(D6), D6);
+        a.MoveL(Addr(3), Addr(4));
+        a.AddaL(Data(D6), 4);
+
+        // Per pixel: z = c, squares of z, iteration = 0
+        a.Mark(Assembler::Pixel);
+        a.MoveL(Ind(1), Data(D0));
+        a.MoveL(Ind(2), Data(D1));
+        a.Square(D0, D2, D4);
+        a.Square(D1, D3, D4);
+        a.Moveq(0, D7);
+
+        a.Mark(Assembler::Loop);
+        a.CmpW(Disp(0), D7);
+        a.Mailbox(Slot::MaxIterations);
+        a.Branch(HS, Assembler::Done);
+        a.TstW(Disp(0));
+        a.Mailbox(Slot::Cancel);
+        a.Branch(NE, Assembler::Finish);
+
+        // Cross term (2 * zReal) * zImag, doubled first like the Fxp kernel
+        a.MoveL(Data(D0), Data(D6));
+        a.AddL(Data(D6), D6);
+        a.Multiply(D6, D1, D5, D4);
+        a.AddL(Ind(2), D5);
+
+        // zReal = zReal2 - zImag2 + cReal, zImag = cross + cImag
+        a.MoveL(Data(D2), Data(D0));
+        a.SubL(Data(D3), D0);
+        a.AddL(Ind(1), D0);
+        a.MoveL(Data(D5), Data(D1));
+
+        // Squares of the new z, kept for the next iteration
+        a.Square(D0, D2, D4);
+        a.Square(D1, D3, D4);
+
+        // Escape when zReal2 + zImag2 > 4.0
+        a.MoveL(Data(D2), Data(D6));
+        a.AddL(Data(D3), D6);
+        a.CmpiL(0x40000, D6);
+        a.Branch(GT, Assembler::Done);
+
+        a.AddqW(1, Data(D7));
+        a.Branch(Always, Assembler::Loop);
+
+        // Store the count, advance to the next pixel
+        a.Mark(Assembler::Done);
+        a.MoveW(Data(D7), PostInc(3));
+        a.AddqW(1, Disp(0));
+        a.Mailbox(Slot::Done);
+        a.AddqL(4, Addr(1));
+        a.AddqL(4, Addr(2));
+        a.CmpaL(Addr(4), 3);
+        a.Branch(NE, Assembler::Pixel);
+
+        a.Mark(Assembler::Finish);
+        a.ClrW(Disp(0));
+        a.Mailbox(Slot::Command);
+        a.Branch(Always, Assembler::Idle);
+
+        return a;
+    }
+
+    /** @brief Fill a mailbox image for one batch
+     *
+     * Slot::Command is left clear: it has to be written last, once the rest
+     * of the mailbox is in sound RAM.
+     * @param cReal Raw 16.16 real parts, one per pixel
+     * @param cImag Raw 16.16 imaginary parts, one per pixel
+     * @param count Number of pixels, 1..MaxBatch
+     * @param maxIterations Iteration cap
+     * @param mailbox Mailbox image, one entry per 16-bit word
+     */
+    inline void PrepareBatch(const int32_t *cReal, const int32_t *cImag, size_t count, uint16_t maxIterations, uint16_t (&mailbox)[Slot::Words])
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            mailbox[Slot::CReal + 2 * i] = static_cast<uint16_t>(static_cast<uint32_t>(cReal[i]) >> 16);
+            mailbox[Slot::CReal + 2 * i + 1] = static_cast<uint16_t>(cReal[i]);
+            mailbox[Slot::CImag + 2 * i] = static_cast<uint16_t>(static_cast<uint32_t>(cImag[i]) >> 16);
+            mailbox[Slot::CImag + 2 * i + 1] = static_cast<uint16_t>(cImag[i]);
+        }
+
+        mailbox[Slot::Command] = 0;
+        mailbox[Slot::Cancel] = 0;
+        mailbox[Slot::Count] = static_cast<uint16_t>(count);
+        mailbox[Slot::MaxIterations] = maxIterations;
+        mailbox[Slot::Done] = 0;
+    }
+
+    static constexpr uint16_t NoLabels[Assembler::LabelCount] = {};
+    static constexpr Assembler Layout = Assemble(NoLabels);
+    static constexpr Assembler Program = Assemble(Layout.labels);
+
+    static_assert(Program.size <= ProgramSize, "68000 program does not fit before the mailbox");
+}
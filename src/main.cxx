@@ -3,6 +3,28 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <type_traits>
+
+#include "buddhabrot.hpp"
+#include "expansion_cart.hpp"
+#include "input_log.hpp"
+#include "iteration_histogram.hpp"
+#include "mandelbrot_kernel.hpp"
+#include "onchip_ram.hpp"
+#include "quality_governor.hpp"
+#include "region_index.hpp"
+#include "render_pipeline.hpp"
+#include "render_strategy.hpp"
+#include "scu_dsp.hpp"
+#include "sound_cpu.hpp"
+#include "vdp1_fills.hpp"
+#include "vdp1_tiles.hpp"
+#include "vdp2_bitmap.hpp"
+#include "view_history.hpp"
+#include "view_transform.hpp"
+#include "wide_fixed.hpp"
+#include "zoom_player.hpp"
 
 // Using to shorten names for Vector and HighColor
 using namespace SRL::Types;
@@ -13,6 +35,41 @@ using namespace SRL::Logger;
 static constexpr uint16_t MAX_ITERATIONS = 100;
 static constexpr uint16_t WIDTH = SRL::TV::Width;
 static constexpr uint16_t HEIGHT = SRL::TV::Height;
+static constexpr size_t VIEW_HISTORY_BUDGET = 128 * 1024; // Bytes of work RAM for compressed views
+static constexpr uint8_t NAVIGATION_DEPTH = 32;           // Views remembered for going back
+static constexpr const char *ZOOM_STREAM_FILE = "ZOOM.MZS"; // Pre-rendered zoom played in kiosk mode
+static constexpr uint8_t DSP_SHARE_STEP = 4;                // Pixels moved between the master and the DSP per row
+static constexpr bool SOUND_CPU_WORKER = true;              // The 68000 iterates a few pixels per row, needs SRL_USE_SGL_SOUND_DRIVER = 0
+static constexpr OutputBackend OUTPUT_BACKEND = OutputBackend::Vdp2Bitmap; // Where the canvas is shown
+static constexpr size_t FILL_POLYGONS = 128;                // Guessed uniform rectangles drawn as VDP1 polygons, 0 to write them all
+static constexpr uint16_t FILL_MIN_AREA = 64;               // Pixels of the smallest rectangle worth a polygon
+static constexpr uint8_t PREVIEW_STEP = 4;                  // Preview at 1/PREVIEW_STEP resolution, 2 or 4
+static constexpr uint16_t AA_THRESHOLD = 2;                 // Neighbour iteration difference that gets 2x2 samples
+static constexpr uint16_t AA_STRONG_THRESHOLD = 8;          // Neighbour iteration difference that gets 4x4 samples
+static constexpr bool PALETTE_ROTATION = true;              // Cycle the CRAM palette every frame, anti-aliasing then keeps a sample's color
+static constexpr uint8_t REPEAT_DELAY = 20;                 // Frames a direction is held before it repeats
+static constexpr uint8_t REPEAT_INTERVAL = 6;               // Frames between repeated pans while held
+static constexpr RenderStrategyKind RENDER_STRATEGY = RenderStrategyKind::Scanline; // Order of the full resolution pass
+static constexpr uint16_t STRATEGY_TILE_SIZE = 32;          // Tile size of RenderStrategyKind::Tiles
+static constexpr uint16_t PIPELINE_TILE_SIZE = 16;          // Tile size of RenderStrategyKind::Pipeline
+static constexpr TileOrder TILE_ORDER = TileOrder::Spiral;  // Tile order of both, spiral out of the screen center where zooms aim
+static constexpr uint8_t PIPELINE_DEPTH = 8;                // Tiles in flight between the pipeline stages
+static constexpr bool ONCHIP_RAM = true;                    // Half of each SH2 cache as RAM for the hot tables
+static constexpr uint8_t PRECISION_MARGIN_BITS = 2;         // A pixel step spans at least 2^n units of the kernel's last bit
+static constexpr uint16_t REGION_NODES = 4096;              // Nodes of the known region quadtree, 8 bytes each
+static constexpr uint8_t KNOWN_BLOCK = 8;                   // Canvas squares looked up in it, a multiple of PREVIEW_STEP
+static constexpr uint16_t REGION_MIN_GUESS = 4;             // Guessed rectangles narrower than this are not recorded
+static constexpr InputMode INPUT_MODE = InputMode::Live;    // Pad input live, recorded, or replayed from INPUT_LOG_FILE
+static constexpr const char *INPUT_LOG_FILE = "INPUT.MIL";  // Session played in InputMode::Replay
+static constexpr size_t INPUT_LOG_EVENTS = 4096;            // Pad changes kept in InputMode::Record, 4 bytes each
+static constexpr uint16_t BUDDHABROT_ITERATIONS = 200;      // Longest orbit of the Buddhabrot mode
+static constexpr uint16_t BUDDHABROT_TONEMAP_FRAMES = 30;   // Frames between two Buddhabrot canvas updates
+
+#if defined(SRL_FRAMERATE) && SRL_FRAMERATE > 0
+static constexpr uint8_t TARGET_FIELDS = SRL_FRAMERATE; // Fields per frame set in the makefile
+#else
+static constexpr uint8_t TARGET_FIELDS = 2;             // Dynamic frame rate, aim for 30 fps
+#endif
 
 /** @brief Color palette management
  *
@@ -23,7 +80,10 @@ static constexpr uint16_t HEIGHT = SRL::TV::Height;
 class Palette : public SRL::Bitmap::Palette
 {
 public:
-    explicit Palette(size_t count) : SRL::Bitmap::Palette(count) {}
+    explicit Palette(size_t count) : SRL::Bitmap::Palette(count), nearestKeys(), nearestIndices()
+    {
+        std::fill(nearestKeys, nearestKeys + NearestCacheSize, NoKey);
+    }
 
     /** @brief Set a palette entry
      *
@@ -73,7 +133,68 @@ public:
             SetColor(i, HighColor::FromRGB555(i, i * 2 % 256, i * 4 % 256));
         }
         SetColor(Count - 1, HighColor::FromRGB555(255, 255, 255));
+        std::fill(nearestKeys, nearestKeys + NearestCacheSize, NoKey);
+    }
+
+    /** @brief Split a color into its 5-bit components
+     *
+     * Reads the hardware RGB555 layout: red in bits 0-4, green in 5-9 and
+     * blue in 10-14.
+     */
+    static void ToRGB(const HighColor &color, uint8_t &red, uint8_t &green, uint8_t &blue)
+    {
+        const uint16_t raw = reinterpret_cast<const uint16_t &>(color);
+        red = raw & 0x1F;
+        green = (raw >> 5) & 0x1F;
+        blue = (raw >> 10) & 0x1F;
+    }
+
+    /** @brief Find the palette entry closest to a color
+     *
+     * Searches the whole palette, with a small direct-mapped cache in front
+     * since anti-aliased edges keep producing the same blends.
+     * @param red Red component, 0..31
+     * @param green Green component, 0..31
+     * @param blue Blue component, 0..31
+     * @return Index of the nearest entry by squared RGB distance
+     */
+    uint8_t FindNearest(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        const uint16_t key = red | (green << 5) | (blue << 10);
+        const uint8_t slot = static_cast<uint8_t>(key ^ (key >> 7));
+
+        if (nearestKeys[slot] == key)
+        {
+            return nearestIndices[slot];
+        }
+
+        uint8_t best = 0;
+        int32_t bestDistance = INT32_MAX;
+
+        for (uint16_t i = 0; i < Count && i < 256; ++i)
+        {
+            uint8_t r, g, b;
+            ToRGB(Colors[i], r, g, b);
+            const int32_t distance = (r - red) * (r - red) + (g - green) * (g - green) + (b - blue) * (b - blue);
+
+            if (distance < bestDistance)
+            {
+                best = static_cast<uint8_t>(i);
+                bestDistance = distance;
+            }
+        }
+
+        nearestKeys[slot] = key;
+        nearestIndices[slot] = best;
+        return best;
     }
+
+private:
+    static constexpr uint16_t NearestCacheSize = 256;
+    static constexpr uint16_t NoKey = 0xFFFF; ///< Never a 15-bit color
+
+    uint16_t nearestKeys[NearestCacheSize];
+    uint8_t nearestIndices[NearestCacheSize];
 };
 
 /** @brief Simple canvas for rendering the Mandelbrot set
@@ -127,13 +248,31 @@ public:
     {
         if (x < width && y < height)
         {
-            this->imageData[y * width + x] = bitmap->Palette->Colors[color];
+            this->imageData[y * width + x] = color;
+        }
+    }
+
+    /** @brief Fill a run of pixels with one palette index
+     *
+     * Writes `length` pixels starting at the linear offset `offset`. The run
+     * is clipped to the image buffer.
+     */
+    void Fill(size_t offset, size_t length, uint8_t color)
+    {
+        const size_t size = static_cast<size_t>(width) * height;
+
+        if (offset < size)
+        {
+            memset(this->imageData + offset, color, std::min(length, size - offset));
         }
     }
 
-    void RotatePalette(int32_t canvasTextureId)
+    /** @brief Rotate the CRAM palette by one entry
+     * @param paletteId CRAM bank the canvas palette was loaded into
+     */
+    void RotatePalette(int32_t paletteId)
     {
-        SRL::CRAM::Palette palette(bitmap->ColorMode, SRL::VDP1::Metadata[canvasTextureId].PaletteId);
+        SRL::CRAM::Palette palette(bitmap->ColorMode, paletteId);
         int16_t size = palette.GetSize();
         SRL::Types::HighColor* data = palette.GetData();
         
@@ -144,6 +283,18 @@ public:
     }
 
 
+    /** @brief Color a palette entry has in CRAM right now, rotation included
+     * @param paletteId CRAM bank the canvas palette was loaded into
+     * @param index Palette entry
+     */
+    HighColor GetShownColor(int32_t paletteId, uint8_t index) const
+    {
+        SRL::CRAM::Palette palette(bitmap->ColorMode, paletteId);
+        const SRL::Types::HighColor *data = palette.GetData();
+
+        return data != nullptr && index < palette.GetSize() ? data[index] : HighColor(0, 0, 0);
+    }
+
     /** @brief Get bitmap info for this canvas
      *
      * Returns a copy of the internal BitmapInfo object.
@@ -204,66 +355,224 @@ struct MandelbrotParameters
     uint16_t y; ///< Y coordinate on the canvas
 };
 
-// Forward declaration of MandelbrotRenderer so SlaveTask can reference it
-template <typename RealT>
-class MandelbrotRenderer;
-
-template <typename RealT = Fxp>
-class SlaveTask : public ITask
+/** @brief Region of the complex plane shown on screen
+ *
+ * Describes the bounds mapped to the canvas corners and provides the
+ * navigation steps used by the pad controls.
+ */
+template <typename T>
+struct MandelbrotView
 {
-public:
-    /** @brief Constructor
-     *
-     * Initializes an empty task ready for parameters to be set.
-     */
-    SlaveTask() : params(), iteration(0) {}
+    T minReal; ///< Real coordinate of the left edge
+    T maxReal; ///< Real coordinate of the right edge
+    T minImag; ///< Imaginary coordinate of the top edge
+    T maxImag; ///< Imaginary coordinate of the bottom edge
 
-    /** @brief Execute the task work
-     *
-     * This is implemented after `MandelbrotRenderer` so the renderer's
-     * templated calculate function can be referenced.
-     */
-    void Do();
+    bool operator==(const MandelbrotView &other) const
+    {
+        return minReal == other.minReal && maxReal == other.maxReal &&
+               minImag == other.minImag && maxImag == other.maxImag;
+    }
 
-    /** @brief Set parameters for the task
-     *
-     * Copies the MandelbrotParameters into the task so the slave worker
-     * can compute the iteration count for that pixel.
+    /** @brief Zoom by a factor of two around the view center
+     * @param in true to zoom in, false to zoom out
+     * @return The zoomed view
      */
-    void setMandelbrotRenderer(const MandelbrotParameters<RealT> &_params)
+    MandelbrotView Zoomed(bool in) const
     {
-        params = _params;
+        const T two = static_cast<T>(2.0);
+        const T centerReal = (minReal + maxReal) / two;
+        const T centerImag = (minImag + maxImag) / two;
+        const T halfReal = in ? (maxReal - minReal) / static_cast<T>(4.0) : (maxReal - minReal);
+        const T halfImag = in ? (maxImag - minImag) / static_cast<T>(4.0) : (maxImag - minImag);
+
+        return MandelbrotView{centerReal - halfReal, centerReal + halfReal, centerImag - halfImag, centerImag + halfImag};
     }
 
-    /** @brief Retrieve the parameters currently stored in the task
-     * @return copy of the stored MandelbrotParameters
+    /** @brief Move the view by a quarter of its size
+     * @param dx Horizontal direction (-1, 0 or 1)
+     * @param dy Vertical direction (-1, 0 or 1)
+     * @return The panned view
      */
-    const MandelbrotParameters<RealT> getMandelbrotRenderer() const
+    MandelbrotView Panned(int8_t dx, int8_t dy) const
+    {
+        const T four = static_cast<T>(4.0);
+        const T stepReal = (maxReal - minReal) / four;
+        const T stepImag = (maxImag - minImag) / four;
+        MandelbrotView view = *this;
+
+        if (dx != 0)
+        {
+            const T shift = dx > 0 ? stepReal : -stepReal;
+            view.minReal += shift;
+            view.maxReal += shift;
+        }
+
+        if (dy != 0)
+        {
+            const T shift = dy > 0 ? stepImag : -stepImag;
+            view.minImag += shift;
+            view.maxImag += shift;
+        }
+
+        return view;
+    }
+};
+
+/** @brief Arithmetic the iteration runs in, cheapest first */
+enum class Precision : uint8_t
+{
+    Fxp16, ///< SRL `Fxp`, the only one the SCU DSP can run
+    Fxp24, ///< `Fxp24`, same cost on the SH2 with 8 more fraction bits
+    Full,  ///< The renderer's own coordinate type
+    Count
+};
+
+static constexpr const char *PrecisionNames[] = {"fxp16", "fxp24", "full"};
+
+/** @brief Iterate a point in the given precision
+ *
+ * Coordinates in `Fxp48` are narrowed to the cheaper types by dropping
+ * fraction bits. Other coordinate types are always iterated as they are.
+ */
+template <typename RealT>
+uint16_t IterateAt(Precision precision, const RealT &real, const RealT &imag, uint16_t maxIterations)
+{
+    if constexpr (std::is_same_v<RealT, Fxp48>)
+    {
+        if (precision == Precision::Fxp16)
+        {
+            return IterateMandelbrot(Fxp::BuildRaw(real.RawAt(16)), Fxp::BuildRaw(imag.RawAt(16)), maxIterations);
+        }
+
+        if (precision == Precision::Fxp24)
+        {
+            return IterateMandelbrot(Fxp24::BuildRaw(real.RawAt(Fxp24::FractionBits)),
+                                     Fxp24::BuildRaw(imag.RawAt(Fxp24::FractionBits)),
+                                     maxIterations);
+        }
+    }
+
+    return IterateMandelbrot(real, imag, maxIterations);
+}
+
+/** @brief Cheapest precision that still resolves a pixel step
+ * @param step Distance between two pixels in the complex plane
+ */
+template <typename RealT>
+Precision SelectPrecision(const RealT &step)
+{
+    if constexpr (std::is_same_v<RealT, Fxp48>)
     {
-        return params;
+        const int64_t units = step.RawValue() >> PRECISION_MARGIN_BITS; // Last bits of Fxp48 the step spans
+
+        if (units >= int64_t(1) << (Fxp48::FractionBits - 16))
+        {
+            return Precision::Fxp16;
+        }
+
+        if (units >= int64_t(1) << (Fxp48::FractionBits - Fxp24::FractionBits))
+        {
+            return Precision::Fxp24;
+        }
     }
 
-    /** @brief Get the X coordinate stored in the task parameters */
-    uint16_t getCurrentX() const
+    return Precision::Full;
+}
+
+/** @brief Compute stage of the render pipeline, run on the slave SH2
+ *
+ * Takes tiles from the compute queue and writes their raw iteration counts
+ * to the staging buffer of each, then passes them to the colorize queue.
+ * It stops when the compute queue is empty or the colorize queue is full;
+ * the master starts it again when it queues or collects tiles. Everything
+ * shared with the master is reached through CacheThrough() pointers.
+ *
+ * The tile being computed and its column coordinates are copied into the
+ * slave's on-chip RAM when ONCHIP_RAM is set, so the inner loop does not
+ * read uncached work RAM.
+ */
+template <typename RealT = Fxp>
+class TileComputeTask : public ITask
+{
+public:
+    using Queue = StageQueue<PipelineTile, PIPELINE_DEPTH>;
+    using Transform = ViewTransform<RealT, WIDTH, HEIGHT>;
+
+    TileComputeTask() : jobs(nullptr), results(nullptr), staging(nullptr), transform(nullptr), work(nullptr), precision(Precision::Full) {}
+
+    /** @brief Connect the task to the renderer's queues and buffers, cache-through addresses */
+    void setBuffers(Queue *jobs, Queue *results, uint16_t *staging, const Transform *transform)
     {
-        return params.x;
+        this->jobs = jobs;
+        this->results = results;
+        this->staging = staging;
+        this->transform = transform;
     }
 
-    /** @brief Get the Y coordinate stored in the task parameters */
-    uint16_t getCurrentY() const
+    /** @brief Set the precision of the next tiles, only while no tile is in flight */
+    void setPrecision(Precision value)
     {
-        return params.y;
+        precision = value;
     }
 
-    /** @brief Return the computed iteration count (if available) */
-    uint16_t getIteration() const
+    /** @brief Compute the queued tiles */
+    void Do()
     {
-        return iteration;
+        if (work == nullptr)
+        {
+            // First run, on the slave: only the slave can switch its own cache
+            if (ONCHIP_RAM)
+            {
+                onChip.Enable();
+            }
+
+            work = onChip.Allocate<Work>(1);
+            work = work != nullptr ? work : &fallback;
+        }
+
+        PipelineTile &tile = work->tile;
+        const Precision kernel = CacheThrough(this)->precision;
+
+        while (!results->IsFull() && jobs->Pop(tile))
+        {
+            uint16_t *out = staging + tile.slot * PIPELINE_TILE_SIZE * PIPELINE_TILE_SIZE;
+
+            for (uint16_t i = 0; i < tile.width; ++i)
+            {
+                work->columns[i] = transform->Real(tile.x + i);
+            }
+
+            for (uint16_t y = tile.y; y < tile.y + tile.height; ++y)
+            {
+                const RealT imag = transform->Imag(y);
+
+                for (uint16_t i = 0; i < tile.width; ++i)
+                {
+                    *out++ = IterateAt(kernel, work->columns[i], imag, MAX_ITERATIONS);
+                }
+            }
+
+            results->Push(tile);
+        }
     }
 
 protected:
-    MandelbrotParameters<RealT> params;
-    uint16_t iteration;
+    /** @brief Slave work descriptor, kept in its on-chip RAM */
+    struct Work
+    {
+        PipelineTile tile;
+        RealT columns[PIPELINE_TILE_SIZE];
+    };
+
+    Queue *jobs;
+    Queue *results;
+    uint16_t *staging;
+    const Transform *transform;
+    OnChipRam onChip; ///< The slave's, only used from Do()
+    Work *work;
+    Work fallback;    ///< Used when the on-chip RAM is off
+    Precision precision;
 };
 
 /** @brief Mandelbrot set renderer
@@ -273,225 +582,2643 @@ protected:
  * and display of the fractal on the screen using VDP1.
  */
 template <typename RealT = Fxp>
-class MandelbrotRenderer
+class MandelbrotRenderer : public IRenderContext
 {
 private:
     Canvas *canvas;
     Palette *palette;
-    int32_t canvasTextureId;
-
-    const RealT minReal = static_cast<RealT>(-2.0);
-    const RealT maxReal = static_cast<RealT>(1.0);
-    const RealT minImag = static_cast<RealT>(-1.0);
-    const RealT maxImag = static_cast<RealT>(1.0);
+    OutputBackend backend;
+    Vdp1TileSet *tiles;        ///< Canvas textures, Vdp1Sprite backend only
+    int32_t paletteId;         ///< CRAM bank of the canvas palette
+    Vdp2BitmapLayer *layer;    ///< Bitmap screen, Vdp2Bitmap backend only
+    Vdp1TileSet *previewTiles; ///< Preview textures, drawn enlarged by PREVIEW_STEP
+    uint8_t *preview;          ///< Preview image, one pixel per coarse sample
+    uint16_t previewWidth;
+    uint16_t previewHeight;
+    volatile uint16_t previewUploaded = 0; ///< Preview rows already in the textures
+    uint16_t *iterations;
+
+    // Canvas rows changed since the last upload, first row in the high half and last row in the
+    // low half of one word, so the VBlank upload takes the range in a single read
+    static constexpr uint32_t NoDirtyRows = 0xFFFF0000; ///< Empty, first > last
+    volatile uint32_t dirtyRows = NoDirtyRows;
+
+    MandelbrotView<RealT> view = {
+        static_cast<RealT>(-2.0),
+        static_cast<RealT>(1.0),
+        static_cast<RealT>(-1.0),
+        static_cast<RealT>(1.0)};
+
+    ViewHistory<MandelbrotView<RealT>> history;
+    CartCache<MandelbrotView<RealT>> cartCache;
+
+    MandelbrotView<RealT> backStack[NAVIGATION_DEPTH];
+    uint8_t backCount = 0;
 
     uint16_t Width;
     uint16_t Height;
 
-    uint16_t currentY = 0;
-    uint16_t currentX = 0;
+    uint16_t currentY = 0;    ///< Next row of the preview pass
+    bool previewing = true;   ///< Preview pass still running
+    bool refine = true;       ///< Full resolution pass allowed to run
+    uint16_t previewIterations = MAX_ITERATIONS; ///< Iteration cap of the preview pass
+    uint16_t sampleCap = MAX_ITERATIONS;         ///< Samples below this count are exact, all of them at MAX_ITERATIONS
+    uint16_t previewFrames = 0;                  ///< render() calls spent on the current preview
+    uint16_t lastPreviewFrames = 0;              ///< Frames of the last finished preview, until taken
+
+    /** @brief Processors that own the pixels they compute */
+    enum Worker : uint8_t
+    {
+        MasterWorker,
+        DspWorker,
+        SoundWorker,
+        SlaveWorker,
+        WorkerCount
+    };
+
+    IterationHistogram<MAX_ITERATIONS> histograms[WorkerCount]; ///< One per worker, merged by equalize()
+    uint8_t colorLutStorage[MAX_ITERATIONS + 1];
+    uint8_t *colorLut;                                         ///< Iteration count to palette index
+
+    uint16_t aaRow = 0;        ///< Next row of the anti-aliasing stage
+    uint32_t aaPixels = 0;     ///< Pixels supersampled in the current view
+    RealT aaOffsetsReal[2][4]; ///< Sub-pixel offsets of the 2x2 and 4x4 grids
+    RealT aaOffsetsImag[2][4];
     bool renderComplete = false;
 
-    SlaveTask<RealT> task;
+    Precision precision = Precision::Full; ///< Kernel of the current view
+
+    ScuDspWorker dsp;
+    uint8_t dspShare = 16;    ///< Pixels at the end of each row given to the DSP
+    uint32_t dspWaits = 0;    ///< Rows where the master waited for the DSP
+
+    SoundCpuWorker sound;
+    uint8_t soundShare = 4;   ///< Pixels before the DSP part of each row given to the 68000
+
+    ViewTransform<RealT, WIDTH, HEIGHT> transform; ///< Pixel to complex plane mapping of the view
+
+    OnChipRam onChip;      ///< The master's, holds colorLut and the column table when they fit
+    const RealT *columns;  ///< Column table of the transform
+    int32_t *onChipColumns; ///< The column table narrowed to the kernel's raw 32-bit values, when it fits
+    uint8_t onChipBits = 0; ///< Fraction bits of onChipColumns for the current kernel, 0 when unusable
+    uint32_t recolorTicks = 0;  ///< Timer ticks spent in recolor() for the current view
+    uint32_t colorizeTicks = 0; ///< Timer ticks spent colorizing pipeline tiles
+
+    // Pipeline: the slave computes, the master colorizes, VBlank uploads
+    StageQueue<PipelineTile, PIPELINE_DEPTH> computeQueue;  ///< Master to slave, cache-through
+    StageQueue<PipelineTile, PIPELINE_DEPTH> colorizeQueue; ///< Slave to master, cache-through
+    StageQueue<PipelineTile, PIPELINE_DEPTH> uploadQueue;   ///< Master to VBlank
+    uint16_t staging[PIPELINE_DEPTH][PIPELINE_TILE_SIZE * PIPELINE_TILE_SIZE]; ///< Raw counts of the tiles in flight
+    uint8_t freeSlots[PIPELINE_DEPTH];
+    uint8_t freeCount = PIPELINE_DEPTH;
+    TileComputeTask<RealT> tileTask;
+
+    ScanlineStrategy scanline;
+    ProgressiveStrategy<PREVIEW_STEP / 2> progressive; ///< Its first grid refines the preview
+    GuessingStrategy guessing;
+    SubdivisionStrategy subdivision;
+    TileStrategy<STRATEGY_TILE_SIZE, TileCount(WIDTH, HEIGHT, STRATEGY_TILE_SIZE)> tileOrder;
+    PipelineStrategy<PIPELINE_TILE_SIZE, TileCount(WIDTH, HEIGHT, PIPELINE_TILE_SIZE)> pipelined;
+    IRenderStrategy *strategies[static_cast<uint8_t>(RenderStrategyKind::Count)];
+    IRenderStrategy *strategy; ///< Runs the full resolution pass
+
+    uint32_t computedPixels = 0; ///< Full pass pixels iterated in the current view
+    uint32_t guessedPixels = 0;  ///< Full pass pixels guessed in the current view
+    uint32_t strategyWork = 0;   ///< Iteration units the full pass spent
+    uint16_t strategyFrames = 0; ///< render() calls the full pass ran in
+    uint32_t framePixels = 0;    ///< Pixels completed since takeFramePixels()
+
+    Vdp1FillLayer<FILL_POLYGONS> fills{WIDTH, HEIGHT}; ///< Guessed rectangles not written into the canvas yet
+    uint32_t filledRects = 0;   ///< Fills added in the current full pass
+    uint32_t filledPixels = 0;
+
+    static constexpr uint16_t Unknown = 0xFFFF;
+    RegionIndex<RealT, REGION_NODES> regions{static_cast<RealT>(4.0)}; ///< Uniform regions found by past views
+    uint16_t *knownBlocks;     ///< Iteration count of each KNOWN_BLOCK square found in regions, or Unknown
+    uint16_t knownColumns;
+    uint16_t knownRows;
+    uint16_t knownCount = 0;   ///< Squares of the current view found in regions
+
+    // Max-filtered pyramid of the last image with completed rows, seeds the preview of the next view
+    static constexpr uint8_t MipLevels = 3;                ///< 1/2, 1/4 and 1/8 of the canvas
+    static constexpr uint16_t MipBand = 1 << MipLevels;    ///< Canvas rows folded in at once
+    uint16_t *mips[MipLevels];
+    uint16_t mipWidths[MipLevels];
+    uint16_t mipHeights[MipLevels];
+    MandelbrotView<RealT> mipView;  ///< View the pyramid was built from
+    uint16_t mipRows = 0;           ///< Canvas rows of mipView folded into every level
+    volatile bool previewSeeded = false; ///< The whole preview changed and waits for upload
+
+    /** @brief Real coordinate of a canvas column, from the per-view table */
+    RealT columnReal(uint16_t x) const
+    {
+        return columns[x];
+    }
 
-public:
-    /** @brief Construct a MandelbrotRenderer
-     *
-     * Allocates palette and canvas resources and attempts to load the
-     * texture into VDP1. The renderer is ready to progressively render
-     * lines after construction.
+    /** @brief Map the canvas onto the current view */
+    void updateTransform()
+    {
+        transform.Set(view.minReal, view.maxReal, view.minImag, view.maxImag);
+    }
+
+    /** @brief Raw value of a coordinate narrowed to a 32-bit kernel type
+     * @param bits Fraction bits of the kernel type, 16 or 24
      */
-    MandelbrotRenderer() : canvas(nullptr),
-                           palette(nullptr),
-                           canvasTextureId(-1),
-                           Width(WIDTH),
-                           Height(HEIGHT),
-                           currentY(0),
-                           currentX(0),
-                           renderComplete(false),
-                           task()
+    static int32_t narrowRaw(const RealT &value, uint8_t bits)
     {
-        palette = new Palette(256);
-        if (!palette)
+        if constexpr (std::is_same_v<RealT, Fxp48>)
         {
-            Log::LogPrint<LogLevels::FATAL>("palette allocation error");
-            assert(palette != nullptr && "palette allocation error");
+            return value.RawAt(bits);
         }
+        else
+        {
+            return fxpRaw(value);
+        }
+    }
 
-        palette->Init();
-
-        canvas = new Canvas(Width, Height, *palette);
-
-        if (canvas == nullptr)
+    /** @brief Fraction bits of the 32-bit type the current kernel iterates in, 0 when it is wider */
+    uint8_t kernelBits() const
+    {
+        if constexpr (std::is_same_v<RealT, Fxp>)
         {
-            Log::LogPrint<LogLevels::FATAL>("canvas allocation error");
-            assert(canvas != nullptr && "canvas allocation error");
+            return 16;
+        }
+        else if constexpr (std::is_same_v<RealT, Fxp48>)
+        {
+            return precision == Precision::Fxp16 ? 16 : (precision == Precision::Fxp24 ? Fxp24::FractionBits : 0);
+        }
+        else
+        {
+            return 0;
         }
+    }
 
-        canvasTextureId = SRL::VDP1::TryLoadTexture(canvas, Canvas::LoadPalette);
+    /** @brief Refill the on-chip column table at the precision of the current kernel
+     *
+     * The full `Fxp48` table is 8 bytes a column and does not fit next to
+     * colorLut, the narrowed one is 4 bytes and is what the 32-bit kernels
+     * read anyway. The full precision kernel reads the work RAM table.
+     */
+    void narrowColumns()
+    {
+        onChipBits = onChipColumns != nullptr ? kernelBits() : 0;
 
-        if (canvasTextureId < 0)
+        for (uint16_t x = 0; x < Width && onChipBits != 0; ++x)
         {
-            Log::LogPrint<LogLevels::FATAL>("canvasTextureId(%d) not loaded", canvasTextureId);
-            assert(canvasTextureId = > 0 && "palette allocation error");
+            onChipColumns[x] = narrowRaw(transform.Real(x), onChipBits);
         }
-
-        task.ResetTask();
     }
 
-    /** @brief Render one scanline of the Mandelbrot set
+    /** @brief Iterate a canvas pixel with the current kernel, from the on-chip column table when it has it
      *
-     * Progressively computes and writes one horizontal line of the
-     * Mandelbrot image to the canvas. The method advances internal
-     * scanline state so repeated calls complete the full image.
+     * Same count as calculateMandelbrot(), which narrows the same coordinates.
      */
-    void render()
+    uint16_t iteratePixel(uint16_t x, const RealT &imag, uint16_t maxIterations) const
     {
-        if (currentY >= Height)
+        if (onChipBits == 16)
         {
-            currentY = 0;
+            return IterateMandelbrot(Fxp::BuildRaw(onChipColumns[x]), Fxp::BuildRaw(narrowRaw(imag, 16)), maxIterations);
         }
 
-        for (currentX = 0; currentX < Width; currentX++)
+        if (onChipBits == Fxp24::FractionBits)
         {
-            MandelbrotParameters<RealT> params{
-                minReal + currentX * (maxReal - minReal) / (Width - 1),
-                minImag + currentY * (maxImag - minImag) / (Height - 1),
-                currentX,
-                currentY};
+            return IterateMandelbrot(Fxp24::BuildRaw(onChipColumns[x]),
+                                     Fxp24::BuildRaw(narrowRaw(imag, Fxp24::FractionBits)),
+                                     maxIterations);
+        }
 
-            // If a previous slave result is available, use it
-            if (task.IsDone())
-            {
-                canvas->SetPixel(task.getCurrentX(), task.getCurrentY(), task.getIteration() % 256);
-            }
+        return calculateMandelbrot(MandelbrotParameters<RealT>{columnReal(x), imag, x, 0}, maxIterations, precision);
+    }
 
-            // Send this work to the slave if possible (ExecuteOnSlave checks ResetTask)
-            task.setMandelbrotRenderer(params);
-            SRL::Slave::ExecuteOnSlave(task);
+    /** @brief Imaginary coordinate of a canvas row, call once per row */
+    RealT rowImag(uint16_t y) const
+    {
+        return transform.Imag(y);
+    }
+
+    /** @brief Pick the cheapest kernel resolving the pixel spacing of the view
+     *
+     * Only called when the view changes, so every pixel of an image comes
+     * from the same kernel and no seam can appear between them.
+     */
+    void choosePrecision()
+    {
+        const Precision next = SelectPrecision((view.maxReal - view.minReal) / (Width - 1));
 
-            // Also compute locally as a fallback so rendering proceeds immediately
-            uint16_t iteration = MandelbrotRenderer<RealT>::calculateMandelbrot(params);
-            canvas->SetPixel(currentX, currentY, iteration % 256);
+        if (next != precision)
+        {
+            Log::LogPrint<LogLevels::INFO>("precision: %s", PrecisionNames[static_cast<uint8_t>(next)]);
         }
-        currentX = 0;
-        ++currentY;
 
-        if (currentY >= Height)
+        precision = next;
+        tileTask.setPrecision(precision);
+        narrowColumns();
+    }
+
+    /** @brief Whether the current view can be iterated by the DSP, which only runs `Fxp` */
+    bool dspUsable() const
+    {
+        if constexpr (std::is_same_v<RealT, Fxp>)
+        {
+            return true;
+        }
+        else
         {
-            renderComplete = true;
+            return std::is_same_v<RealT, Fxp48> && precision == Precision::Fxp16;
         }
     }
 
-    /** @brief Copy canvas image to VDP1 texture memory via DMA
-     *
-     * Performs a DMA transfer from the canvas image buffer into the VDP1
-     * texture slot previously allocated for this canvas.
-     */
-    void copyToVDP1() const
+    /** @brief Raw 16.16 value of a coordinate, for the DSP */
+    static int32_t fxpRaw(const RealT &value)
     {
-        if (canvas != nullptr)
+        if constexpr (std::is_same_v<RealT, Fxp>)
+        {
+            return value.RawValue();
+        }
+        else if constexpr (std::is_same_v<RealT, Fxp48>)
+        {
+            return value.RawAt(16);
+        }
+        else
         {
-            slDMACopy(canvas->GetData(),
-                      SRL::VDP1::Textures[canvasTextureId].GetData(),
-                      Width * Height * sizeof(uint16_t));
-            slDMAWait();
+            return 0;
         }
-        Log::LogPrint<LogLevels::TESTING>("copyToVDP1");
     }
 
-    /** @brief Draw the current texture to screen using VDP1 sprite
-     *
-     * Submits a sprite draw call that uses the canvas texture to render the
-     * Mandelbrot image on screen.
-     */
-    void draw() const
+    /** @brief Integer part of a coordinate, rounded down */
+    static int32_t wholePart(const RealT &value)
     {
-        SRL::Scene2D::DrawSprite(canvasTextureId, Vector3D(0.0, 0.0, 500.0));
-        canvas->RotatePalette(canvasTextureId);
+        if constexpr (std::is_same_v<RealT, Fxp> || std::is_same_v<RealT, Fxp48>)
+        {
+            return fxpRaw(value) >> 16;
+        }
+        else
+        {
+            return static_cast<int32_t>(value);
+        }
     }
 
-    /** @brief Query whether the renderer finished the full image
-     * @return true when all scanlines have been rendered
+    /** @brief Give the end of a row to the DSP
+     * @param y Pixel row
+     * @return First column handled by the DSP, Width when it got nothing
      */
-    bool isComplete() const { return renderComplete; }
+    uint16_t submitToDsp(uint16_t y)
+    {
+        const uint8_t count = static_cast<uint8_t>(std::min<uint16_t>(dspShare, Width));
+        const uint16_t first = Width - count;
+        const int32_t imag = fxpRaw(rowImag(y));
+        int32_t cReal[ScuDsp::MaxBatch];
+        int32_t cImag[ScuDsp::MaxBatch];
 
-    /** @brief Calculate iteration count for a point in the complex plane
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            cReal[i] = fxpRaw(columnReal(first + i));
+            cImag[i] = imag;
+        }
+
+        return dsp.Submit(cReal, cImag, count, MAX_ITERATIONS) ? first : Width;
+    }
+
+    /** @brief Store the DSP part of a row and rebalance the split
      *
-     * Iterates z_{n+1} = z_n^2 + c until the magnitude exceeds 2 or the
-     * maximum iteration count is reached. Returns the number of iterations
-     * performed (useful for coloring).
-     * @param params MandelbrotParameters containing the complex coordinate
-     * @return iteration count (0..MAX_ITERATIONS)
+     * The DSP gets more pixels next row when it finished before the master,
+     * fewer when the master had to wait for it.
+     * @param first First column handled by the DSP
+     * @param y Pixel row
      */
-    static uint16_t calculateMandelbrot(const MandelbrotParameters<RealT> &params)
+    void collectFromDsp(uint16_t first, uint16_t y)
     {
-        uint16_t iteration = 0;
-        RealT zReal = params.real;
-        RealT zImag = params.imag;
-        const RealT two = static_cast<RealT>(2.0);
-        const RealT four = static_cast<RealT>(4.0);
+        if (first >= Width)
+        {
+            return;
+        }
 
-        while (iteration < MAX_ITERATIONS)
+        if (dsp.IsBusy())
         {
-            RealT zRealTemp = zReal * zReal - zImag * zImag + params.real;
-            zImag = two * zReal * zImag + params.imag;
-            zReal = zRealTemp;
+            ++dspWaits;
 
-            if (zReal * zReal + zImag * zImag > four)
+            if (dspShare > DSP_SHARE_STEP)
             {
-                return iteration;
+                dspShare -= DSP_SHARE_STEP;
             }
-            ++iteration;
         }
-        return MAX_ITERATIONS;
-    }
-};
+        else if (static_cast<size_t>(dspShare + DSP_SHARE_STEP) <= ScuDsp::MaxBatch)
+        {
+            dspShare += DSP_SHARE_STEP;
+        }
 
-/** @brief Slave task execution implementation
- *
- * Runs the Mandelbrot iteration calculation for the stored parameters. This
- * implementation is placed after the `MandelbrotRenderer` definition so it
- * can reference the renderer's templated calculate function.
- */
-template <typename RealT>
-void SlaveTask<RealT>::Do()
-{
-    iteration = MandelbrotRenderer<RealT>::calculateMandelbrot(params);
-}
+        uint16_t counts[ScuDsp::MaxBatch];
+        const uint8_t count = dsp.Collect(counts);
 
-/** @brief Program entry point
- *
- * Initializes the SRL core, constructs the Mandelbrot renderer and enters the
- * main loop which progressively renders the fractal and draws it to screen.
- */
-int main()
-{
-    static MandelbrotRenderer<Fxp> *g_renderer = nullptr;
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            completePixel(DspWorker, first + i, y, counts[i]);
+        }
 
-    SRL::Core::Initialize(HighColor(0, 0, 0));
+        computedPixels += count;
+    }
 
-    g_renderer = new MandelbrotRenderer<Fxp>();
+    /** @brief Give the pixels before `end` in a row to the 68000
+     * @param y Pixel row
+     * @param end First column not handed to it
+     * @return First column handled by the 68000, `end` when it got nothing
+     */
+    uint16_t submitToSound(uint16_t y, uint16_t end)
+    {
+        const uint8_t count = static_cast<uint8_t>(std::min<uint16_t>(soundShare, end));
+        const uint16_t first = end - count;
+        const int32_t imag = fxpRaw(rowImag(y));
+        int32_t cReal[SoundCpu::MaxBatch];
+        int32_t cImag[SoundCpu::MaxBatch];
 
-    assert(g_renderer != nullptr && "Failed to create MandelbrotRenderer");
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            cReal[i] = fxpRaw(columnReal(first + i));
+            cImag[i] = imag;
+        }
 
-    // Setup VBlank event
-    SRL::Core::OnVblank += []()
-    { g_renderer->copyToVDP1(); };
-    ;
+        return sound.Submit(cReal, cImag, count, MAX_ITERATIONS) ? first : end;
+    }
 
-    // Main program loop
-    while (true)
+    /** @brief Store the 68000 part of a row, computing what it did not finish
+     *
+     * The 68000 is never waited for: its batch is cancelled, the master
+     * takes the pixels left and the share shrinks, or grows when the batch
+     * was done before the master got there.
+     * @param first First column handed to the 68000
+     * @param end First column after them
+     * @param y Pixel row
+     * @return Iteration units the master spent on the leftovers
+     */
+    uint32_t collectFromSound(uint16_t first, uint16_t end, uint16_t y)
     {
-        if (!g_renderer->isComplete())
+        if (first >= end)
         {
-            // Render the Mandelbrot set
-            g_renderer->render();
+            return 0;
         }
 
-        
-        g_renderer->draw();
-        SRL::Core::Synchronize();
+        const bool finished = !sound.IsBusy();
+        uint16_t counts[SoundCpu::MaxBatch];
+        const uint8_t count = sound.Collect(counts);
+        uint32_t cost = 0;
+
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            completePixel(SoundWorker, first + i, y, counts[i]);
+        }
+
+        const RealT imag = rowImag(y);
+
+        for (uint16_t x = first + count; x < end; ++x)
+        {
+            const uint16_t iteration = iteratePixel(x, imag, MAX_ITERATIONS);
+            completePixel(MasterWorker, x, y, iteration);
+            cost += iteration + 1;
+        }
+
+        if (finished && soundShare < SoundCpu::MaxBatch)
+        {
+            ++soundShare;
+        }
+        else if (!finished && soundShare > 1)
+        {
+            --soundShare;
+        }
+
+        computedPixels += end - first;
+        return cost;
+    }
+
+    /** @brief Palette index of an iteration count */
+    uint8_t colorOf(uint16_t iteration) const
+    {
+        return colorLut[iteration < MAX_ITERATIONS ? iteration : MAX_ITERATIONS];
+    }
+
+    /** @brief Store a pixel result in the iteration buffer and the canvas */
+    void storePixel(uint16_t x, uint16_t y, uint16_t iteration)
+    {
+        iterations[y * Width + x] = iteration;
+        canvas->SetPixel(x, y, colorOf(iteration));
+        markDirty(y, y);
+    }
+
+    /** @brief Store a full resolution result and count it in the worker's histogram
+     *
+     * Preview samples were counted when computed, a recomputed one is taken
+     * back out first so every pixel is counted once.
+     */
+    void completePixel(Worker worker, uint16_t x, uint16_t y, uint16_t iteration)
+    {
+        countPixel(worker, x, y, iteration);
+        storePixel(x, y, iteration);
+    }
+
+    /** @brief The bookkeeping of completePixel(), for a pixel whose canvas byte is drawn otherwise */
+    void countPixel(Worker worker, uint16_t x, uint16_t y, uint16_t iteration)
+    {
+        if (isSample(x, y))
+        {
+            histograms[MasterWorker].Remove(iterations[y * Width + x]);
+        }
+
+        histograms[worker].Add(iteration);
+        ++framePixels;
+    }
+
+    /** @brief Write the fill polygons into the canvas and drop them
+     *
+     * Called before anything reads the canvas or may write under a fill.
+     */
+    void materializeFills()
+    {
+        fills.ForEach([this](const typename Vdp1FillLayer<FILL_POLYGONS>::Fill &fill)
+                      {
+            for (uint16_t row = fill.y; row < fill.y + fill.height; ++row)
+            {
+                canvas->Fill(row * Width + fill.x, fill.width, colorOf(fill.iteration));
+            }
+
+            markDirty(fill.y, fill.y + fill.height - 1); });
+
+        fills.Clear();
+    }
+
+    /** @brief Rebuild the palette mapping from the merged worker histograms */
+    void equalize()
+    {
+        IterationHistogram<MAX_ITERATIONS> merged;
+
+        for (uint8_t i = 0; i < WorkerCount; ++i)
+        {
+            merged.Merge(histograms[i]);
+        }
+
+        // Interior black (entry 0), escaped pixels over the gradient, white (last entry) unused
+        merged.BuildEqualizedLut(colorLut, 1, 254, 0);
+
+        Log::LogPrint<LogLevels::DEBUG>("color: equalized over %d pixels", static_cast<int32_t>(merged.GetTotal()));
+    }
+
+    /** @brief Remap the whole iteration buffer into the canvas with the current mapping */
+    void recolor()
+    {
+        const uint16_t start = FreeRunningTimer::Read();
+        uint8_t *pixels = canvas->GetData();
+        const size_t size = Width * Height;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            pixels[i] = colorOf(iterations[i]);
+        }
+
+        recolorTicks += static_cast<uint16_t>(FreeRunningTimer::Read() - start);
+        invalidate();
+
+        // The canvas now holds the fills too
+        fills.Clear();
+    }
+
+    /** @brief Forget the counts of every worker */
+    void clearHistograms()
+    {
+        for (uint8_t i = 0; i < WorkerCount; ++i)
+        {
+            histograms[i].Clear();
+        }
+    }
+
+    /** @brief Count the pixels of a restored snapshot
+     *
+     * Finished rows are counted whole. Below them only the preview samples
+     * are, as the full pass will recompute them through completePixel().
+     * @param rows Number of finished rows
+     */
+    void rebuildHistograms(uint16_t rows)
+    {
+        clearHistograms();
+        histograms[MasterWorker].AddRange(iterations, rows * Width);
+
+        for (uint16_t y = rows; y < Height; ++y)
+        {
+            for (uint16_t x = 0; x < Width && y % PREVIEW_STEP == 0; x += PREVIEW_STEP)
+            {
+                histograms[MasterWorker].Add(iterations[y * Width + x]);
+            }
+        }
+    }
+
+    /** @brief Extend the range of rows the next upload copies
+     *
+     * The range is read and written as one word. Should VBlank take it
+     * between the read and the write, the write publishes the rows it just
+     * uploaded again with the new ones: uploaded twice, never lost.
+     */
+    void markDirty(uint16_t first, uint16_t last)
+    {
+        const uint32_t rows = dirtyRows;
+        const uint16_t dirtyFirst = static_cast<uint16_t>(rows >> 16);
+        const uint16_t dirtyLast = static_cast<uint16_t>(rows);
+
+        if (dirtyFirst <= dirtyLast)
+        {
+            first = std::min(first, dirtyFirst);
+            last = std::max(last, dirtyLast);
+        }
+
+        dirtyRows = (static_cast<uint32_t>(first) << 16) | last;
+    }
+
+    /** @brief Whether a pixel was computed exactly by the preview pass */
+    static bool isSample(uint16_t x, uint16_t y)
+    {
+        return x % PREVIEW_STEP == 0 && y % PREVIEW_STEP == 0;
+    }
+
+    /** @brief Render one row of the preview pass
+     *
+     * Computes every PREVIEW_STEP-th pixel of the row into the small preview
+     * image, which VDP1 draws enlarged over the whole screen. The samples
+     * are exact pixels of the full resolution image: they also go to the
+     * iteration buffer and are kept by the full pass, unless they reached a
+     * reduced iteration cap.
+     * @return Work done, in iteration units
+     */
+    uint32_t renderPreviewRow()
+    {
+        const RealT imag = rowImag(currentY);
+        uint8_t *row = preview + (currentY / PREVIEW_STEP) * previewWidth;
+        uint32_t cost = 0;
+
+        if (previewIterations < MAX_ITERATIONS)
+        {
+            sampleCap = std::min(sampleCap, previewIterations);
+        }
+
+        for (uint16_t x = 0; x < Width; x += PREVIEW_STEP)
+        {
+            const uint16_t known = knownAt(x, currentY);
+            const uint16_t iteration = known != Unknown
+                                           ? known
+                                           : iteratePixel(x, imag, previewIterations);
+            iterations[currentY * Width + x] = iteration;
+            histograms[MasterWorker].Add(iteration);
+            ++framePixels;
+            row[x / PREVIEW_STEP] = colorOf(iteration);
+            cost += iteration + 1;
+        }
+
+        currentY += PREVIEW_STEP;
+
+        if (currentY >= Height)
+        {
+            // The samples are a fair subset of the image, color the full pass with them
+            countKnownPixels();
+            equalize();
+            expandPreview();
+            previewing = false;
+            currentY = 0;
+            lastPreviewFrames = previewFrames;
+            startStrategy(0);
+        }
+
+        return cost;
+    }
+
+    /** @brief Whether a preview sample can be kept by the full pass
+     *
+     * Under the full cap a sample that reached it is in the set, the
+     * costliest pixel of all, and is kept too. Under a reduced cap it may
+     * still escape and is computed again.
+     */
+    bool isExact(uint16_t x, uint16_t y) const
+    {
+        return (isSample(x, y) && (sampleCap == MAX_ITERATIONS || iterations[y * Width + x] < sampleCap)) ||
+               knownAt(x, y) != Unknown;
+    }
+
+    /** @brief Iteration count of a pixel found by a past view at this spacing or a finer one, Unknown if none */
+    uint16_t knownAt(uint16_t x, uint16_t y) const
+    {
+        return knownBlocks[(y / KNOWN_BLOCK) * knownColumns + x / KNOWN_BLOCK];
+    }
+
+    /** @brief Complex plane rectangle covered by canvas pixels, bounds inclusive */
+    typename RegionIndex<RealT, REGION_NODES>::Rect pixelRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) const
+    {
+        return {columnReal(x), columnReal(x + width - 1), rowImag(y), rowImag(y + height - 1)};
+    }
+
+    /** @brief Distance between neighbouring pixels of the view, what regions are sampled at */
+    RealT pixelSpacing() const
+    {
+        return columnReal(1) - columnReal(0);
+    }
+
+    /** @brief Look every square of a fresh view up in the region index */
+    void findKnownBlocks()
+    {
+        const RealT spacing = pixelSpacing();
+        knownCount = 0;
+
+        for (uint16_t row = 0; row < knownRows; ++row)
+        {
+            const uint16_t y = row * KNOWN_BLOCK;
+            const uint16_t height = std::min<uint16_t>(KNOWN_BLOCK, Height - y);
+
+            for (uint16_t column = 0; column < knownColumns; ++column)
+            {
+                const uint16_t x = column * KNOWN_BLOCK;
+                uint16_t iteration;
+
+                if (regions.Query(pixelRect(x, y, std::min<uint16_t>(KNOWN_BLOCK, Width - x), height), MAX_ITERATIONS, spacing, iteration))
+                {
+                    knownBlocks[row * knownColumns + column] = iteration;
+                    ++knownCount;
+                }
+                else
+                {
+                    knownBlocks[row * knownColumns + column] = Unknown;
+                }
+            }
+        }
+
+        Log::LogPrint<LogLevels::INFO>("regions: %d of %d squares known, %d nodes",
+                                       knownCount,
+                                       knownColumns * knownRows,
+                                       static_cast<int32_t>(regions.GetUsedNodes()));
+    }
+
+    /** @brief Count the known pixels the preview did not sample, they are never computed */
+    void countKnownPixels()
+    {
+        if (knownCount == 0)
+        {
+            return;
+        }
+
+        for (uint16_t y = 0; y < Height; ++y)
+        {
+            for (uint16_t x = 0; x < Width; ++x)
+            {
+                const uint16_t iteration = knownAt(x, y);
+
+                if (iteration != Unknown && !isSample(x, y))
+                {
+                    histograms[MasterWorker].Add(iteration);
+                }
+            }
+        }
+    }
+
+    /** @brief Record the interior squares of the finished image
+     *
+     * A square whose border pixels are all in the set is taken to be in
+     * the set as a whole, the set being connected with no holes. Only the
+     * pixels are checked, not the border between them, so a filament
+     * thinner than the spacing can still cross it: the square is recorded
+     * for this spacing and never answers a view zoomed further in.
+     */
+    void recordInterior()
+    {
+        const RealT spacing = pixelSpacing();
+
+        for (uint16_t y = 0; y + KNOWN_BLOCK <= Height; y += KNOWN_BLOCK)
+        {
+            for (uint16_t x = 0; x + KNOWN_BLOCK <= Width; x += KNOWN_BLOCK)
+            {
+                if (knownAt(x, y) != Unknown)
+                {
+                    continue;
+                }
+
+                bool inside = true;
+
+                for (uint16_t i = 0; i < KNOWN_BLOCK && inside; ++i)
+                {
+                    inside = iterations[y * Width + x + i] == MAX_ITERATIONS &&
+                             iterations[(y + KNOWN_BLOCK - 1) * Width + x + i] == MAX_ITERATIONS &&
+                             iterations[(y + i) * Width + x] == MAX_ITERATIONS &&
+                             iterations[(y + i) * Width + x + KNOWN_BLOCK - 1] == MAX_ITERATIONS;
+                }
+
+                if (inside)
+                {
+                    regions.Insert(pixelRect(x, y, KNOWN_BLOCK, KNOWN_BLOCK), MAX_ITERATIONS, MAX_ITERATIONS, spacing);
+                }
+            }
+        }
+    }
+
+    /** @brief Fold newly completed rows of the image into the pyramid
+     *
+     * Each level keeps the largest count of the 2x2 pixels below it, so the
+     * set and thin filaments, which have the highest counts, survive the
+     * reduction. Rows are folded MipBand at a time as the full pass completes
+     * them, which keeps the cost spread over the frames. The pyramid of the
+     * previous view is kept until the new one has rows to replace it with.
+     * @param rows Leading rows of the image that are final
+     */
+    void updateMips(uint16_t rows)
+    {
+        const uint16_t target = rows >= Height ? Height : rows & ~(MipBand - 1);
+
+        if (!(mipView == view))
+        {
+            if (target == 0)
+            {
+                return;
+            }
+
+            mipView = view;
+            mipRows = 0;
+        }
+
+        if (target <= mipRows)
+        {
+            return;
+        }
+
+        const uint16_t *source = iterations;
+        uint16_t sourceWidth = Width;
+        uint16_t sourceHeight = Height;
+
+        for (uint8_t level = 0; level < MipLevels; ++level)
+        {
+            const uint8_t shift = level + 1;
+            const uint16_t last = std::min<uint16_t>((target + (1 << shift) - 1) >> shift, mipHeights[level]);
+
+            for (uint16_t row = mipRows >> shift; row < last; ++row)
+            {
+                const uint16_t *top = source + 2 * row * sourceWidth;
+                const uint16_t *bottom = 2 * row + 1 < sourceHeight ? top + sourceWidth : top;
+                uint16_t *out = mips[level] + row * mipWidths[level];
+
+                for (uint16_t column = 0; column < mipWidths[level]; ++column)
+                {
+                    const uint16_t left = 2 * column;
+                    const uint16_t right = left + 1 < sourceWidth ? left + 1 : left;
+                    out[column] = std::max(std::max(top[left], top[right]), std::max(bottom[left], bottom[right]));
+                }
+            }
+
+            source = mips[level];
+            sourceWidth = mipWidths[level];
+            sourceHeight = mipHeights[level];
+        }
+
+        mipRows = target;
+    }
+
+    /** @brief Fill the preview of a fresh view from the pyramid
+     *
+     * Samples falling on completed rows of the previous image take the count
+     * of the coarsest level still finer than the preview spacing, so a zoom
+     * out shows the area it came from at once while the rest renders. The
+     * previous color mapping is still in use, the colors match what was on
+     * screen. Only views within a factor of 16 in size are mapped.
+     */
+    void seedPreview()
+    {
+        const RealT spanReal = view.maxReal - view.minReal;
+        const RealT spanImag = view.maxImag - view.minImag;
+        const RealT mipSpanReal = mipView.maxReal - mipView.minReal;
+        const RealT mipSpanImag = mipView.maxImag - mipView.minImag;
+
+        if (mipRows == 0 ||
+            spanReal > 16 * mipSpanReal || mipSpanReal > 16 * spanReal ||
+            spanImag > 16 * mipSpanImag || mipSpanImag > 16 * spanImag ||
+            view.minReal >= mipView.maxReal || view.maxReal <= mipView.minReal ||
+            view.minImag >= mipView.maxImag || view.maxImag <= mipView.minImag)
+        {
+            return;
+        }
+
+        // Pixel of the pyramid's view under a pixel x of this one: offset + x * ratio
+        const RealT stepReal = mipSpanReal / (Width - 1);
+        const RealT stepImag = mipSpanImag / (Height - 1);
+        const RealT offsetReal = (view.minReal - mipView.minReal) / stepReal;
+        const RealT offsetImag = (view.minImag - mipView.minImag) / stepImag;
+        const RealT ratioReal = spanReal / mipSpanReal;
+        const RealT ratioImag = spanImag / mipSpanImag;
+
+        const int32_t spacing = wholePart(PREVIEW_STEP * ratioReal); // Pyramid view pixels between two samples
+        uint8_t level = 0;
+
+        while (level + 1 < MipLevels && (2 << (level + 1)) <= spacing)
+        {
+            ++level;
+        }
+
+        const uint8_t shift = level + 1;
+        uint32_t seeded = 0;
+
+        for (uint16_t y = 0; y < Height; y += PREVIEW_STEP)
+        {
+            const int32_t sourceY = wholePart(offsetImag + y * ratioImag);
+            uint8_t *row = preview + (y / PREVIEW_STEP) * previewWidth;
+
+            for (uint16_t x = 0; x < Width; x += PREVIEW_STEP)
+            {
+                const int32_t sourceX = wholePart(offsetReal + x * ratioReal);
+
+                if (sourceX < 0 || sourceX >= Width || sourceY < 0 || sourceY >= mipRows)
+                {
+                    // Most of what a zoom out uncovers escapes at once
+                    row[x / PREVIEW_STEP] = colorOf(0);
+                }
+                else
+                {
+                    row[x / PREVIEW_STEP] = colorOf(mips[level][(sourceY >> shift) * mipWidths[level] + (sourceX >> shift)]);
+                    ++seeded;
+                }
+            }
+        }
+
+        previewSeeded = true;
+
+        Log::LogPrint<LogLevels::INFO>("mips: %d preview samples seeded from level 1/%d",
+                                       static_cast<int32_t>(seeded),
+                                       2 << level);
+    }
+
+    /** @brief Restart the full resolution pass and its statistics
+     * @param top First row to render, the rows above are complete
+     */
+    void startStrategy(uint16_t top)
+    {
+        flushPipeline();
+        CacheThrough(&computeQueue)->ClearStats();
+        CacheThrough(&colorizeQueue)->ClearStats();
+        uploadQueue.ClearStats();
+        materializeFills();
+        strategy->Reset(top);
+        computedPixels = 0;
+        guessedPixels = 0;
+        filledRects = 0;
+        filledPixels = 0;
+        strategyWork = 0;
+        strategyFrames = 0;
+        recolorTicks = 0;
+        colorizeTicks = 0;
+    }
+
+    /** @brief Start the compute stage unless it is already running */
+    void kickSlave()
+    {
+        if (!tileTask.IsRunning() && !CacheThrough(&computeQueue)->IsEmpty())
+        {
+            SRL::Slave::ExecuteOnSlave(tileTask);
+        }
+    }
+
+    /** @brief Drop the tiles in flight, once the compute stage has stopped */
+    void flushPipeline()
+    {
+        while (tileTask.IsRunning())
+        {
+        }
+
+        CacheThrough(&computeQueue)->Clear();
+        CacheThrough(&colorizeQueue)->Clear();
+
+        for (uint8_t i = 0; i < PIPELINE_DEPTH; ++i)
+        {
+            freeSlots[i] = i;
+        }
+
+        freeCount = PIPELINE_DEPTH;
+    }
+
+    /** @brief Log the occupancy of one pipeline queue */
+    static void logStage(const char *name, const StageStats &stats)
+    {
+        const uint32_t samples = stats.samples > 0 ? stats.samples : 1;
+        const uint32_t average = stats.occupancy * 10 / samples; // In tenths of a tile
+
+        Log::LogPrint<LogLevels::INFO>("pipeline: %s %d tiles, queue %d.%d of %d on average, full %d%%, empty %d%%",
+                                       name,
+                                       static_cast<int32_t>(stats.items),
+                                       static_cast<int32_t>(average / 10),
+                                       static_cast<int32_t>(average % 10),
+                                       PIPELINE_DEPTH,
+                                       static_cast<int32_t>(stats.full * 100 / samples),
+                                       static_cast<int32_t>(stats.empty * 100 / samples));
+    }
+
+    /** @brief Color the finished image and report how the full pass went */
+    void completeImage()
+    {
+        renderComplete = true;
+        equalize();
+        recolor();
+        recordInterior();
+
+        Log::LogPrint<LogLevels::INFO>("render: %s computed %d, guessed %d pixels, %d units in %d frames",
+                                       strategy->GetName(),
+                                       static_cast<int32_t>(computedPixels),
+                                       static_cast<int32_t>(guessedPixels),
+                                       static_cast<int32_t>(strategyWork),
+                                       strategyFrames);
+
+        if (filledRects > 0)
+        {
+            Log::LogPrint<LogLevels::INFO>("fill: %d rectangles of %d pixels drawn as polygons",
+                                           static_cast<int32_t>(filledRects),
+                                           static_cast<int32_t>(filledPixels));
+        }
+
+        Log::LogPrint<LogLevels::INFO>("memory: %s, recolor %d ticks, colorize %d ticks",
+                                       onChip.IsEnabled() ? "on-chip RAM" : "cache only",
+                                       static_cast<int32_t>(recolorTicks),
+                                       static_cast<int32_t>(colorizeTicks));
+
+        if (strategy == &tileOrder || strategy == &pipelined)
+        {
+            const auto report = [](const auto &schedule)
+            {
+                Log::LogPrint<LogLevels::INFO>("tiles: %s order, focus area after %d frames, half the detail after %d, all after %d",
+                                               TileOrderNames[static_cast<uint8_t>(schedule.GetOrder())],
+                                               schedule.GetFocusSteps(),
+                                               schedule.GetDetailSteps(),
+                                               schedule.GetSteps());
+            };
+
+            if (strategy == &tileOrder)
+            {
+                report(tileOrder.GetSchedule());
+            }
+            else
+            {
+                report(pipelined.GetSchedule());
+            }
+        }
+
+        if (strategy == &pipelined)
+        {
+            logStage("compute", CacheThrough(&computeQueue)->GetStats());
+            logStage("colorize", CacheThrough(&colorizeQueue)->GetStats());
+            logStage("upload", uploadQueue.GetStats());
+        }
+
+        Log::LogPrint<LogLevels::INFO>("dsp: %d pixels in %d batches, share %d, master waited %d rows",
+                                       static_cast<int32_t>(dsp.GetPixelCount()),
+                                       static_cast<int32_t>(dsp.GetBatchCount()),
+                                       dspShare,
+                                       static_cast<int32_t>(dspWaits));
+
+        if (sound.IsStarted())
+        {
+            Log::LogPrint<LogLevels::INFO>("sound: %d pixels in %d batches, %d cut short, share %d",
+                                           static_cast<int32_t>(sound.GetPixelCount()),
+                                           static_cast<int32_t>(sound.GetBatchCount()),
+                                           static_cast<int32_t>(sound.GetCancelledCount()),
+                                           soundShare);
+        }
+    }
+
+    /** @brief Replace the canvas with the finished preview
+     *
+     * Each sample fills its PREVIEW_STEP square in the canvas and the
+     * iteration buffer, so the full pass refines the preview row by row
+     * once the enlarged sprite stops being drawn.
+     */
+    void expandPreview()
+    {
+        for (uint16_t y = 0; y < Height; y += PREVIEW_STEP)
+        {
+            const uint16_t rows = std::min<uint16_t>(PREVIEW_STEP, Height - y);
+
+            for (uint16_t x = 0; x < Width; x += PREVIEW_STEP)
+            {
+                const uint16_t iteration = iterations[y * Width + x];
+                const uint16_t columns = std::min<uint16_t>(PREVIEW_STEP, Width - x);
+
+                for (uint16_t dy = 0; dy < rows; ++dy)
+                {
+                    const size_t offset = (y + dy) * Width + x;
+                    std::fill(iterations + offset, iterations + offset + columns, iteration);
+                    canvas->Fill(offset, columns, colorOf(iteration));
+                }
+            }
+        }
+
+        invalidate();
+    }
+
+    /** @brief Largest iteration difference between a pixel and its 4 neighbours */
+    uint16_t neighbourContrast(uint16_t x, uint16_t y) const
+    {
+        const uint16_t *pixel = iterations + y * Width + x;
+        const uint16_t value = *pixel;
+        uint16_t contrast = 0;
+
+        auto compare = [&](uint16_t other)
+        {
+            const uint16_t difference = other > value ? other - value : value - other;
+            contrast = difference > contrast ? difference : contrast;
+        };
+
+        if (x > 0)
+        {
+            compare(pixel[-1]);
+        }
+
+        if (x + 1 < Width)
+        {
+            compare(pixel[1]);
+        }
+
+        if (y > 0)
+        {
+            compare(pixel[-Width]);
+        }
+
+        if (y + 1 < Height)
+        {
+            compare(pixel[Width]);
+        }
+
+        return contrast;
+    }
+
+    /** @brief Prepare the sub-pixel offsets for the current view
+     *
+     * Samples sit at the cell centers of a regular grid one pixel step
+     * wide, centered on the pixel's own coordinate.
+     */
+    void startAntialiasing()
+    {
+        static constexpr double Fractions[2][4] = {{-0.25, 0.25, 0.0, 0.0}, {-0.375, -0.125, 0.125, 0.375}};
+        const RealT stepReal = (view.maxReal - view.minReal) / (Width - 1);
+        const RealT stepImag = (view.maxImag - view.minImag) / (Height - 1);
+
+        for (uint8_t grid = 0; grid < 2; ++grid)
+        {
+            for (uint8_t i = 0; i < 4; ++i)
+            {
+                aaOffsetsReal[grid][i] = stepReal * static_cast<RealT>(Fractions[grid][i]);
+                aaOffsetsImag[grid][i] = stepImag * static_cast<RealT>(Fractions[grid][i]);
+            }
+        }
+
+        aaPixels = 0;
+    }
+
+    /** @brief Supersample one pixel and combine the samples into a palette entry
+     *
+     * The nearest entry to an average only holds for the palette it was
+     * searched in. With PALETTE_ROTATION every entry changes color each
+     * frame, so the pixel instead keeps the entry most samples have, which
+     * cycles along with its neighbours: a coverage vote, not a blend.
+     * @param x Pixel column
+     * @param y Pixel row
+     * @param strong Use the 4x4 grid instead of 2x2
+     * @param cost Receives the iterations spent
+     * @return Palette index nearest to the average color, or the most common one
+     */
+    uint8_t supersample(uint16_t x, uint16_t y, bool strong, uint32_t &cost)
+    {
+        const uint8_t grid = strong ? 1 : 0;
+        const uint8_t size = strong ? 4 : 2;
+        const RealT real = columnReal(x);
+        const RealT imag = rowImag(y);
+        uint16_t red = 0;
+        uint16_t green = 0;
+        uint16_t blue = 0;
+        uint8_t indices[16];
+        uint8_t sample = 0;
+
+        for (uint8_t j = 0; j < size; ++j)
+        {
+            for (uint8_t i = 0; i < size; ++i)
+            {
+                const uint16_t iteration = calculateMandelbrot(MandelbrotParameters<RealT>{
+                                                                   real + aaOffsetsReal[grid][i],
+                                                                   imag + aaOffsetsImag[grid][j],
+                                                                   x,
+                                                                   y},
+                                                               MAX_ITERATIONS,
+                                                               precision);
+                uint8_t r, g, b;
+                Palette::ToRGB(palette->GetColor(colorOf(iteration)), r, g, b);
+                red += r;
+                green += g;
+                blue += b;
+                indices[sample++] = colorOf(iteration);
+                cost += iteration + 1;
+            }
+        }
+
+        if (PALETTE_ROTATION)
+        {
+            uint8_t best = indices[0];
+            uint8_t bestVotes = 0;
+
+            for (uint8_t i = 0; i < sample; ++i)
+            {
+                uint8_t votes = 0;
+
+                for (uint8_t k = 0; k < sample; ++k)
+                {
+                    votes += indices[k] == indices[i] ? 1 : 0;
+                }
+
+                if (votes > bestVotes)
+                {
+                    best = indices[i];
+                    bestVotes = votes;
+                }
+            }
+
+            return best;
+        }
+
+        return palette->FindNearest(red / sample, green / sample, blue / sample);
+    }
+
+    /** @brief Anti-alias one row of the finished image
+     *
+     * Pixels whose neighbours differ by more than AA_THRESHOLD iterations
+     * are replaced by the average color of a 2x2 grid of samples, or 4x4
+     * beyond AA_STRONG_THRESHOLD, see supersample() for the rotating palette. Only the canvas changes, the iteration
+     * buffer keeps the exact pixel values the edges are detected on.
+     * @return Work done, in iteration units
+     */
+    uint32_t antialiasRow()
+    {
+        if (aaRow == 0)
+        {
+            startAntialiasing();
+        }
+
+        const uint16_t y = aaRow;
+        uint32_t cost = Width;
+
+        for (uint16_t x = 0; x < Width; ++x)
+        {
+            const uint16_t contrast = neighbourContrast(x, y);
+
+            if (contrast > AA_THRESHOLD)
+            {
+                canvas->SetPixel(x, y, supersample(x, y, contrast > AA_STRONG_THRESHOLD, cost));
+                ++aaPixels;
+            }
+        }
+
+        markDirty(y, y);
+
+        if (++aaRow >= Height)
+        {
+            Log::LogPrint<LogLevels::INFO>("aa: %d of %d pixels supersampled",
+                                           static_cast<int32_t>(aaPixels),
+                                           static_cast<int32_t>(Width * Height));
+        }
+
+        return cost;
+    }
+
+    /** @brief Save the current view before moving away from it
+     *
+     * A completed view is compressed into the work RAM history. With a RAM
+     * cartridge the raw buffers are also stored there, which for a view
+     * left half rendered keeps the rows done so far for later resumption.
+     */
+    void leave()
+    {
+        materializeFills();
+
+        if (renderComplete)
+        {
+            history.Push(view, iterations, Width * Height);
+        }
+
+        // A partial snapshot is only resumable once the preview is expanded
+        const uint16_t rows = renderComplete ? Height : std::min(strategy->GetCompletedRows(), Height);
+
+        if (!previewing && rows > 0)
+        {
+            cartCache.Store(view,
+                            rows,
+                            canvas->GetData(),
+                            Width * Height,
+                            iterations,
+                            Width * Height * sizeof(uint16_t));
+        }
+    }
+
+    /** @brief Show a view, reusing cached data when possible
+     *
+     * The work RAM history is tried first: its runs are decompressed straight
+     * into the iteration buffer and the canvas. The cartridge cache comes next
+     * and may resume a partial render, whose remaining rows already hold the
+     * expanded preview. Otherwise rendering restarts with the preview pass.
+     * @param next View to show
+     */
+    void enter(const MandelbrotView<RealT> &next)
+    {
+        // Tiles in flight and fills belong to the view being left
+        flushPipeline();
+        fills.Clear();
+        view = next;
+        updateTransform();
+        choosePrecision();
+
+        // The canvas is recolored from the iteration buffer below
+        auto sink = [this](size_t offset, size_t length, uint16_t value)
+        {
+            std::fill(iterations + offset, iterations + offset + length, value);
+        };
+
+        uint16_t rows = 0;
+
+        if (history.Take(next, sink))
+        {
+            rows = Height;
+        }
+        else
+        {
+            // Leaves rows untouched on a miss
+            cartCache.Load(next, rows, canvas->GetData(), iterations);
+        }
+
+        currentY = rows;
+        aaRow = 0;
+        previewing = rows == 0;
+        previewUploaded = 0;
+        previewFrames = 0;
+
+        // Samples of a resumed snapshot may come from a reduced cap, recompute them
+        sampleCap = previewing ? MAX_ITERATIONS : 0;
+        renderComplete = rows >= Height;
+
+        if (previewing)
+        {
+            seedPreview();
+            findKnownBlocks();
+
+            // Keeps the previous mapping until the preview has its own
+            clearHistograms();
+            invalidate();
+        }
+        else
+        {
+            // A resumed snapshot already holds every pixel it has
+            std::fill(knownBlocks, knownBlocks + knownColumns * knownRows, Unknown);
+            knownCount = 0;
+            rebuildHistograms(rows);
+            equalize();
+            recolor();
+            startStrategy(rows);
+            updateMips(rows);
+        }
+    }
+
+public:
+    /** @brief Construct a MandelbrotRenderer
+     *
+     * Allocates palette and canvas resources and sets up the output
+     * backend. The renderer is ready to progressively render
+     * lines after construction.
+     * @param cart Expansion cartridge used as a large cache when present
+     * @param backend Hardware showing the canvas
+     */
+    MandelbrotRenderer(const ExpansionCart &cart, OutputBackend backend = OUTPUT_BACKEND) : canvas(nullptr),
+                           palette(nullptr),
+                           backend(backend),
+                           tiles(nullptr),
+                           paletteId(-1),
+                           layer(nullptr),
+                           previewTiles(nullptr),
+                           preview(nullptr),
+                           previewWidth((WIDTH + PREVIEW_STEP - 1) / PREVIEW_STEP),
+                           previewHeight((HEIGHT + PREVIEW_STEP - 1) / PREVIEW_STEP),
+                           iterations(nullptr),
+                           history(VIEW_HISTORY_BUDGET),
+                           cartCache(cart),
+                           Width(WIDTH),
+                           Height(HEIGHT),
+                           currentY(0),
+                           previewing(true),
+                           renderComplete(false),
+                           dsp(),
+                           sound()
+    {
+        palette = new Palette(256);
+        if (!palette)
+        {
+            Log::LogPrint<LogLevels::FATAL>("palette allocation error");
+            assert(palette != nullptr && "palette allocation error");
+        }
+
+        palette->Init();
+
+        if (SOUND_CPU_WORKER)
+        {
+            sound.Start();
+        }
+
+        // Hot tables of the master in its on-chip RAM, the slave places its own on its first task
+        if (ONCHIP_RAM)
+        {
+            onChip.Enable();
+        }
+
+        colorLut = onChip.Allocate<uint8_t>(MAX_ITERATIONS + 1);
+        colorLut = colorLut != nullptr ? colorLut : colorLutStorage;
+        onChipColumns = onChip.Allocate<int32_t>(Width);
+        columns = &transform.Real(0);
+        updateTransform();
+        choosePrecision();
+
+        if (onChipColumns == nullptr && onChip.IsEnabled())
+        {
+            Log::LogPrint<LogLevels::INFO>("onchip: %d column table does not fit, stays in work RAM",
+                                           static_cast<int32_t>(Width));
+        }
+
+        Log::LogPrint<LogLevels::INFO>("onchip: %d of %d bytes used",
+                                       static_cast<int32_t>(onChip.GetUsed()),
+                                       static_cast<int32_t>(OnChipRam::Size));
+
+        strategies[static_cast<uint8_t>(RenderStrategyKind::Scanline)] = &scanline;
+        strategies[static_cast<uint8_t>(RenderStrategyKind::Progressive)] = &progressive;
+        strategies[static_cast<uint8_t>(RenderStrategyKind::Guessing)] = &guessing;
+        strategies[static_cast<uint8_t>(RenderStrategyKind::Subdivision)] = &subdivision;
+        strategies[static_cast<uint8_t>(RenderStrategyKind::Tiles)] = &tileOrder;
+        strategies[static_cast<uint8_t>(RenderStrategyKind::Pipeline)] = &pipelined;
+        tileOrder.GetSchedule().SetFocus(Width / 2, Height / 2);
+        pipelined.GetSchedule().SetFocus(Width / 2, Height / 2);
+        tileOrder.GetSchedule().SetOrder(TILE_ORDER);
+        pipelined.GetSchedule().SetOrder(TILE_ORDER);
+        tileTask.setBuffers(CacheThrough(&computeQueue),
+                            CacheThrough(&colorizeQueue),
+                            CacheThrough(&staging[0][0]),
+                            CacheThrough(&transform));
+        flushPipeline();
+        strategy = strategies[static_cast<uint8_t>(RENDER_STRATEGY)];
+        strategy->Reset(0);
+
+        // Plain modulo mapping until the first image is equalized
+        for (uint16_t i = 0; i <= MAX_ITERATIONS; ++i)
+        {
+            colorLut[i] = i % 256;
+        }
+
+        canvas = new Canvas(Width, Height, *palette);
+
+        if (canvas == nullptr)
+        {
+            Log::LogPrint<LogLevels::FATAL>("canvas allocation error");
+            assert(canvas != nullptr && "canvas allocation error");
+        }
+
+        if (backend == OutputBackend::Vdp2Bitmap && !Vdp2BitmapLayer::Fits(Width, Height))
+        {
+            Log::LogPrint<LogLevels::WARNING>("vdp2: %dx%d does not fit a bitmap, using VDP1 tiles", Width, Height);
+            this->backend = backend = OutputBackend::Vdp1Sprite;
+        }
+
+        if (backend == OutputBackend::Vdp1Sprite)
+        {
+            tiles = new Vdp1TileSet(Width, Height, palette, Canvas::LoadPalette);
+            paletteId = tiles->GetPaletteId();
+
+            if (paletteId < 0)
+            {
+                Log::LogPrint<LogLevels::FATAL>("canvas textures not loaded");
+                assert(paletteId >= 0 && "palette allocation error");
+            }
+        }
+        else
+        {
+            SRL::Bitmap::BitmapInfo info = canvas->GetInfo();
+            paletteId = Canvas::LoadPalette(&info);
+            assert(paletteId >= 0 && "palette allocation error");
+            layer = new Vdp2BitmapLayer(Width, Height, paletteId);
+        }
+
+        preview = new uint8_t[previewWidth * previewHeight];
+        memset(preview, 0, previewWidth * previewHeight);
+        previewTiles = new Vdp1TileSet(previewWidth, previewHeight, palette, Canvas::LoadPalette, paletteId);
+
+        // 660KB in high resolution, too much to share work RAM H with the canvas
+        iterations = static_cast<uint16_t *>(SRL::Memory::LowWorkRam::Malloc(Width * Height * sizeof(uint16_t)));
+
+        if (iterations == nullptr)
+        {
+            Log::LogPrint<LogLevels::FATAL>("iteration buffer allocation error");
+            assert(iterations != nullptr && "iteration buffer allocation error");
+        }
+
+        knownColumns = (Width + KNOWN_BLOCK - 1) / KNOWN_BLOCK;
+        knownRows = (Height + KNOWN_BLOCK - 1) / KNOWN_BLOCK;
+        knownBlocks = new uint16_t[knownColumns * knownRows];
+        std::fill(knownBlocks, knownBlocks + knownColumns * knownRows, Unknown);
+
+        for (uint8_t level = 0; level < MipLevels; ++level)
+        {
+            mipWidths[level] = (Width + (2 << level) - 1) >> (level + 1);
+            mipHeights[level] = (Height + (2 << level) - 1) >> (level + 1);
+            mips[level] = new uint16_t[mipWidths[level] * mipHeights[level]];
+        }
+
+        Log::LogPrint<LogLevels::INFO>("cache: history %dKB work RAM, cartridge %dKB",
+                                       static_cast<int32_t>(history.GetBudget() / 1024),
+                                       static_cast<int32_t>(cart.GetSize() / 1024));
+
+        tileTask.ResetTask();
+    }
+
+    uint16_t GetWidth() const override { return Width; }
+
+    uint16_t GetHeight() const override { return Height; }
+
+    uint16_t Get(uint16_t x, uint16_t y) const override { return iterations[y * Width + x]; }
+
+    uint16_t GetInterest(uint16_t x, uint16_t y, uint16_t width, uint16_t height) const override
+    {
+        uint16_t interest = 0;
+        const uint16_t right = std::min<uint16_t>(x + width, Width);
+        const uint16_t bottom = std::min<uint16_t>(y + height, Height);
+
+        // Preview samples in the rectangle that differ from their right or lower sample
+        for (uint16_t row = (y + PREVIEW_STEP - 1) / PREVIEW_STEP * PREVIEW_STEP; row < bottom; row += PREVIEW_STEP)
+        {
+            for (uint16_t column = (x + PREVIEW_STEP - 1) / PREVIEW_STEP * PREVIEW_STEP; column < right; column += PREVIEW_STEP)
+            {
+                const uint16_t iteration = iterations[row * Width + column];
+
+                if (column + PREVIEW_STEP < Width && iterations[row * Width + column + PREVIEW_STEP] != iteration)
+                {
+                    ++interest;
+                }
+
+                if (row + PREVIEW_STEP < Height && iterations[(row + PREVIEW_STEP) * Width + column] != iteration)
+                {
+                    ++interest;
+                }
+            }
+        }
+
+        return interest;
+    }
+
+    uint16_t Compute(uint16_t x, uint16_t y, uint32_t &cost) override
+    {
+        if (isExact(x, y))
+        {
+            return iterations[y * Width + x];
+        }
+
+        const uint16_t iteration = iteratePixel(x, rowImag(y), MAX_ITERATIONS);
+        completePixel(MasterWorker, x, y, iteration);
+        ++computedPixels;
+        cost += iteration + 1;
+        return iteration;
+    }
+
+    /** @copydoc IRenderContext::ComputeRow
+     *
+     * Preview samples known to be exact are skipped. With `Fxp` the SCU DSP
+     * computes the end of the row in parallel, and the 68000 a few pixels
+     * before that.
+     */
+    uint32_t ComputeRow(uint16_t y) override
+    {
+        uint16_t dspFirst = Width;
+        uint16_t masterWidth = Width;
+        uint32_t cost = 0;
+        const RealT imag = rowImag(y);
+
+        if (dspUsable())
+        {
+            dspFirst = masterWidth = submitToDsp(y);
+
+            if (sound.IsStarted())
+            {
+                masterWidth = submitToSound(y, dspFirst);
+            }
+        }
+
+        for (uint16_t x = 0; x < masterWidth; x++)
+        {
+            if (isExact(x, y))
+            {
+                continue;
+            }
+
+            const uint16_t iteration = iteratePixel(x, imag, MAX_ITERATIONS);
+            completePixel(MasterWorker, x, y, iteration);
+            ++computedPixels;
+            cost += iteration + 1;
+        }
+
+        if (dspUsable())
+        {
+            cost += collectFromSound(masterWidth, dspFirst, y);
+            collectFromDsp(dspFirst, y);
+        }
+
+        return cost;
+    }
+
+    void Guess(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t iteration) override
+    {
+        if (fillRect(x, y, width, height, iteration))
+        {
+            return;
+        }
+
+        for (uint16_t row = y; row < y + height; ++row)
+        {
+            for (uint16_t column = x; column < x + width; ++column)
+            {
+                if (!isExact(column, row))
+                {
+                    completePixel(MasterWorker, column, row, iteration);
+                    ++guessedPixels;
+                }
+            }
+        }
+
+        if (width >= REGION_MIN_GUESS && height >= REGION_MIN_GUESS)
+        {
+            regions.Insert(pixelRect(x, y, width, height), iteration, MAX_ITERATIONS, pixelSpacing());
+        }
+    }
+
+    /** @brief Guess a rectangle as one fill polygon, leaving the canvas alone
+     *
+     * Only when it is large enough, a fill is left and every exact pixel
+     * inside already has the guessed value, which the polygon hides.
+     * @return false when the rectangle has to be written into the canvas
+     */
+    bool fillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t iteration)
+    {
+        if (fills.IsFull() || static_cast<uint32_t>(width) * height < FILL_MIN_AREA)
+        {
+            return false;
+        }
+
+        for (uint16_t row = y; row < y + height; ++row)
+        {
+            for (uint16_t column = x; column < x + width; ++column)
+            {
+                if (isExact(column, row) && iterations[row * Width + column] != iteration)
+                {
+                    return false;
+                }
+            }
+        }
+
+        for (uint16_t row = y; row < y + height; ++row)
+        {
+            for (uint16_t column = x; column < x + width; ++column)
+            {
+                if (!isExact(column, row))
+                {
+                    countPixel(MasterWorker, column, row, iteration);
+                    iterations[row * Width + column] = iteration;
+                    ++guessedPixels;
+                }
+            }
+        }
+
+        if (width >= REGION_MIN_GUESS && height >= REGION_MIN_GUESS)
+        {
+            regions.Insert(pixelRect(x, y, width, height), iteration, MAX_ITERATIONS, pixelSpacing());
+        }
+
+        fills.Add(x, y, width, height, iteration);
+        ++filledRects;
+        filledPixels += static_cast<uint32_t>(width) * height;
+        return true;
+    }
+
+    void Paint(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t iteration) override
+    {
+        for (uint16_t row = y; row < y + height; ++row)
+        {
+            canvas->Fill(row * Width + x, width, colorOf(iteration));
+        }
+
+        markDirty(y, y + height - 1);
+    }
+
+    bool QueueTile(uint16_t x, uint16_t y, uint16_t width, uint16_t height) override
+    {
+        if (freeCount == 0)
+        {
+            return false;
+        }
+
+        // Never full: a queue holds as many tiles as there are staging buffers
+        CacheThrough(&computeQueue)->Push(PipelineTile{x, y, width, height, freeSlots[--freeCount]});
+        kickSlave();
+        return true;
+    }
+
+    /** @copydoc IRenderContext::CollectTiles
+     *
+     * This is the colorize stage. Exact preview samples are kept, the other
+     * pixels go to the iteration buffer, the slave's histogram and the
+     * canvas, then the tile is queued for upload. Rows are only marked
+     * dirty directly when the upload queue is full.
+     */
+    uint32_t CollectTiles() override
+    {
+        StageQueue<PipelineTile, PIPELINE_DEPTH> *finished = CacheThrough(&colorizeQueue);
+        const uint16_t start = FreeRunningTimer::Read();
+        PipelineTile tile;
+        uint32_t cost = 0;
+
+        while (finished->Pop(tile))
+        {
+            const uint16_t *raw = CacheThrough(staging[tile.slot]);
+
+            for (uint16_t y = tile.y; y < tile.y + tile.height; ++y)
+            {
+                for (uint16_t x = tile.x; x < tile.x + tile.width; ++x)
+                {
+                    const uint16_t iteration = *raw++;
+
+                    if (isExact(x, y))
+                    {
+                        continue;
+                    }
+
+                    uint16_t &pixel = iterations[y * Width + x];
+
+                    if (isSample(x, y))
+                    {
+                        histograms[MasterWorker].Remove(pixel);
+                    }
+
+                    histograms[SlaveWorker].Add(iteration);
+                    pixel = iteration;
+                    canvas->SetPixel(x, y, colorOf(iteration));
+                    ++computedPixels;
+                    ++framePixels;
+                    cost += iteration + 1;
+                }
+            }
+
+            freeSlots[freeCount++] = tile.slot;
+
+            if (!uploadQueue.Push(tile))
+            {
+                markDirty(tile.y, tile.y + tile.height - 1);
+            }
+        }
+
+        colorizeTicks += static_cast<uint16_t>(FreeRunningTimer::Read() - start);
+
+        // The slave stops when the colorize queue is full
+        kickSlave();
+        return cost;
+    }
+
+    uint8_t GetTilesInFlight() const override { return PIPELINE_DEPTH - freeCount; }
+
+    /** @brief Render the Mandelbrot set within a compute budget
+     *
+     * Progressively computes the image until the budget is spent, advancing
+     * internal state so repeated calls complete the full image. A preview
+     * pass comes first (see renderPreviewRow()), then the full resolution
+     * pass run by the selected IRenderStrategy if setQuality() allows it.
+     * Once the image is complete, idle budget goes to the anti-aliasing
+     * stage (see antialiasRow()). The budget is checked between rows.
+     * @param budget Work allowed this call, in iteration units
+     */
+    void render(uint32_t budget)
+    {
+        uint32_t spent = 0;
+
+        if (previewing)
+        {
+            ++previewFrames;
+        }
+        else if (refine && !renderComplete)
+        {
+            ++strategyFrames;
+            CacheThrough(&computeQueue)->Sample();
+            CacheThrough(&colorizeQueue)->Sample();
+        }
+
+        while (!isFinished() && spent < budget)
+        {
+            if (previewing)
+            {
+                spent += renderPreviewRow();
+            }
+            else if (!refine)
+            {
+                break;
+            }
+            else if (!renderComplete)
+            {
+                const uint32_t work = strategy->Step(*this, budget - spent);
+                strategyWork += work;
+                spent += work;
+
+                if (strategy->IsDone())
+                {
+                    completeImage();
+                }
+
+                updateMips(renderComplete ? Height : strategy->GetCompletedRows());
+
+                if (work == 0 && !renderComplete)
+                {
+                    break; // The strategy waits on another CPU, the rest of the frame is the main loop's
+                }
+            }
+            else
+            {
+                spent += antialiasRow();
+            }
+        }
+    }
+
+    /** @brief Choose the order of the full resolution pass
+     *
+     * A full pass under way goes on with the new strategy from the rows the
+     * previous one completed.
+     * @param kind Strategy to use
+     */
+    void setStrategy(RenderStrategyKind kind)
+    {
+        IRenderStrategy *next = strategies[static_cast<uint8_t>(kind)];
+
+        if (next == strategy)
+        {
+            return;
+        }
+
+        const uint16_t rows = std::min(strategy->GetCompletedRows(), Height);
+        strategy = next;
+
+        if (!previewing && !renderComplete)
+        {
+            startStrategy(rows);
+        }
+
+        Log::LogPrint<LogLevels::INFO>("render: strategy %s", strategy->GetName());
+    }
+
+    /** @brief Choose the tile order of the tile and pipeline strategies
+     *
+     * A tile pass under way starts over in the new order from the rows it
+     * completed, the tiles done out of order are computed again.
+     * @param order Tile order to use
+     */
+    void setTileOrder(TileOrder order)
+    {
+        const bool restart = !previewing && !renderComplete && (strategy == &tileOrder || strategy == &pipelined);
+        const uint16_t rows = std::min(strategy->GetCompletedRows(), Height);
+
+        tileOrder.GetSchedule().SetOrder(order);
+        pipelined.GetSchedule().SetOrder(order);
+
+        if (restart)
+        {
+            startStrategy(rows);
+        }
+
+        Log::LogPrint<LogLevels::INFO>("render: tile order %s", TileOrderNames[static_cast<uint8_t>(order)]);
+    }
+
+    /** @brief Get the tile order of the tile and pipeline strategies */
+    TileOrder getTileOrder() const { return tileOrder.GetSchedule().GetOrder(); }
+
+    /** @brief Get the order of the full resolution pass */
+    RenderStrategyKind getStrategy() const
+    {
+        for (uint8_t i = 0; i < static_cast<uint8_t>(RenderStrategyKind::Count); ++i)
+        {
+            if (strategies[i] == strategy)
+            {
+                return static_cast<RenderStrategyKind>(i);
+            }
+        }
+
+        return RENDER_STRATEGY;
+    }
+
+    /** @brief Set the quality the next render() calls use
+     * @param iterationCap Iteration cap of the preview pass, up to MAX_ITERATIONS
+     * @param allowRefinement Whether the full resolution pass may run
+     */
+    void setQuality(uint16_t iterationCap, bool allowRefinement)
+    {
+        previewIterations = std::min(iterationCap, MAX_ITERATIONS);
+        refine = allowRefinement;
+    }
+
+    /** @brief Frames the last finished preview took, once
+     * @return Frame count, 0 when no preview finished since the last call
+     */
+    uint16_t takePreviewFrames()
+    {
+        const uint16_t frames = lastPreviewFrames;
+        lastPreviewFrames = 0;
+        return frames;
+    }
+
+    /** @brief Pixels completed by the preview and full passes since the last call */
+    uint32_t takeFramePixels()
+    {
+        const uint32_t pixels = framePixels;
+        framePixels = 0;
+        return pixels;
+    }
+
+    /** @brief Whether the preview pass of the current view is still running */
+    bool isPreviewing() const { return previewing; }
+
+    /** @brief Copy the changed canvas rows to the output backend
+     *
+     * Called from VBlank. Only rows written since the previous call are
+     * transferred, into the VDP1 tile textures or the VDP2 bitmap. During
+     * the preview pass the new preview rows are transferred instead.
+     */
+    void upload()
+    {
+        if (previewing)
+        {
+            const uint16_t ready = std::min<uint16_t>((currentY + PREVIEW_STEP - 1) / PREVIEW_STEP, previewHeight);
+
+            if (previewSeeded)
+            {
+                // The rows not computed yet show the seed from the pyramid
+                previewTiles->Upload(preview, 0, previewHeight);
+                previewUploaded = ready;
+                previewSeeded = false;
+                return;
+            }
+
+            if (ready > previewUploaded)
+            {
+                previewTiles->Upload(preview, previewUploaded, ready - previewUploaded);
+                previewUploaded = ready;
+            }
+
+            return;
+        }
+
+        // Upload stage of the pipeline, its tiles join the dirty rows
+        PipelineTile tile;
+        uploadQueue.Sample();
+
+        while (uploadQueue.Pop(tile))
+        {
+            markDirty(tile.y, tile.y + tile.height - 1);
+        }
+
+        // The main loop never runs in between, the read and the reset need no lock
+        const uint32_t rows = dirtyRows;
+        const uint16_t first = static_cast<uint16_t>(rows >> 16);
+        const uint16_t last = static_cast<uint16_t>(rows);
+
+        if (canvas == nullptr || first > last)
+        {
+            return;
+        }
+
+        const uint16_t count = last - first + 1;
+        dirtyRows = NoDirtyRows;
+
+        if (backend == OutputBackend::Vdp1Sprite)
+        {
+            tiles->Upload(canvas->GetData(), first, count);
+        }
+        else
+        {
+            layer->Upload(canvas->GetData(), first, count);
+        }
+    }
+
+    /** @brief Mark the whole canvas for the next upload
+     *
+     * Needed after something other than the renderer wrote to the canvas.
+     */
+    void invalidate()
+    {
+        markDirty(0, Height - 1);
+    }
+
+    /** @brief Show the canvas for this frame
+     *
+     * During the preview pass the preview is drawn enlarged to the full
+     * screen, above the VDP2 bitmap if that is the backend. Afterwards the
+     * VDP1 backend submits the sprites of the canvas tiles while the VDP2
+     * bitmap needs no per-frame drawing. The palette rotates with both
+     * when PALETTE_ROTATION is set.
+     */
+    void draw() const
+    {
+        if (previewing)
+        {
+            previewTiles->Draw(PREVIEW_STEP);
+        }
+        else if (backend == OutputBackend::Vdp1Sprite)
+        {
+            tiles->Draw();
+        }
+
+        if (PALETTE_ROTATION)
+        {
+            canvas->RotatePalette(paletteId);
+        }
+
+        // After the rotation, so the polygons match the canvas entries they cover
+        if (!previewing)
+        {
+            fills.Draw([this](uint16_t iteration)
+                       { return canvas->GetShownColor(paletteId, colorOf(iteration)); });
+        }
+    }
+
+    /** @brief Query whether the renderer finished the full image
+     * @return true when all scanlines have been rendered
+     */
+    bool isComplete() const { return renderComplete; }
+
+    /** @brief Query whether the image and its anti-aliasing are both done */
+    bool isFinished() const { return renderComplete && aaRow >= Height; }
+
+    /** @brief Get the view currently shown */
+    const MandelbrotView<RealT> &getView() const { return view; }
+
+    /** @brief Move to a new view
+     *
+     * The current view is remembered for back() and saved to the caches.
+     * If the new view is still cached it is restored instantly, otherwise
+     * progressive rendering restarts from the top.
+     * @param next View to show
+     */
+    void navigate(const MandelbrotView<RealT> &next)
+    {
+        if (next == view)
+        {
+            return;
+        }
+
+        if (backCount == NAVIGATION_DEPTH)
+        {
+            std::move(backStack + 1, backStack + NAVIGATION_DEPTH, backStack);
+            --backCount;
+        }
+
+        backStack[backCount++] = view;
+        leave();
+        enter(next);
+    }
+
+    /** @brief Hand the canvas over to another producer
+     *
+     * Saves the current view to the caches so resume() can bring it back.
+     * A preview pass under way ends, so upload() and draw() show the canvas
+     * the other producer writes instead of the preview.
+     */
+    void suspend()
+    {
+        leave();
+        previewing = false;
+        previewSeeded = false;
+
+        // The slave SH2 goes to the other producer idle
+        flushPipeline();
+    }
+
+    /** @brief Take the canvas back after suspend()
+     *
+     * Restores the current view from the caches, or renders it again.
+     */
+    void resume()
+    {
+        enter(view);
+    }
+
+    /** @brief Raw 8-bit indexed canvas pixels, Width * Height bytes */
+    uint8_t *getCanvasData() { return canvas->GetData(); }
+
+    /** @brief Return to the previous view
+     *
+     * The previous view is restored from the caches when it is still there,
+     * or rendered again otherwise.
+     * @return false when there is no previous view
+     */
+    bool back()
+    {
+        if (backCount == 0)
+        {
+            return false;
+        }
+
+        leave();
+        enter(backStack[--backCount]);
+        return true;
+    }
+
+    /** @brief Calculate iteration count for a point in the complex plane
+     *
+     * Iterates z_{n+1} = z_n^2 + c until the magnitude exceeds 2 or the
+     * maximum iteration count is reached. Returns the number of iterations
+     * performed (useful for coloring). The loop itself lives in
+     * `IterateMandelbrot` so the host tools share it.
+     * @param params MandelbrotParameters containing the complex coordinate
+     * @param maxIterations Iteration cap
+     * @param precision Arithmetic to iterate in, see IterateAt()
+     * @return iteration count (0..maxIterations)
+     */
+    static uint16_t calculateMandelbrot(const MandelbrotParameters<RealT> &params,
+                                        uint16_t maxIterations = MAX_ITERATIONS,
+                                        Precision precision = Precision::Full)
+    {
+        return IterateAt(precision, params.real, params.imag, maxIterations);
+    }
+};
+
+/** @brief Buddhabrot sampling on the slave SH2
+ *
+ * The master sets a session up through the cache-through alias, the slave
+ * starts it on its next run: it clears its density buffer itself, through
+ * its own write-through cache, so none of its cache lines can hold counts
+ * of a previous session. The master only reads the buffer, uncached.
+ */
+class BuddhabrotTask : public ITask
+{
+public:
+    using Sampler = BuddhabrotSampler<Fxp, BUDDHABROT_ITERATIONS>;
+
+    BuddhabrotTask() : session(), started(0) {}
+
+    /** @brief Describe the next session, only while the task is not running
+     * @param density Slave density buffer, width * height counts
+     * @param width Width of the buffer
+     * @param height Height of the buffer
+     * @param bounds Raw 16.16 view bounds: min real, max real, min imaginary, max imaginary
+     * @param budget Work of one run, in iteration units
+     */
+    void setSession(uint16_t *density, uint16_t width, uint16_t height, const int32_t (&bounds)[4], uint32_t budget)
+    {
+        session.density = density;
+        session.width = width;
+        session.height = height;
+
+        for (uint8_t i = 0; i < 4; ++i)
+        {
+            session.bounds[i] = bounds[i];
+        }
+
+        session.budget = budget;
+        ++session.generation;
+    }
+
+    /** @brief Set the work of one run, only while the task is not running */
+    void setBudget(uint32_t budget)
+    {
+        session.budget = budget;
+    }
+
+    /** @brief Sample orbits for one budget */
+    void Do()
+    {
+        const Session current = CacheThrough(this)->session;
+
+        if (current.generation != started)
+        {
+            memset(current.density, 0, current.width * current.height * sizeof(uint16_t));
+            sampler.Start(current.density, current.width, current.height,
+                          current.bounds[0], current.bounds[1], current.bounds[2], current.bounds[3],
+                          0x9E3779B9 ^ current.generation);
+            started = current.generation;
+        }
+
+        sampler.Run(current.budget);
+    }
+
+    /** @brief The slave's sampler, for its statistics, through CacheThrough() */
+    const Sampler &getSampler() const { return sampler; }
+
+protected:
+    /** @brief Written by the master, read by the slave */
+    struct Session
+    {
+        uint16_t *density;
+        uint16_t width;
+        uint16_t height;
+        int32_t bounds[4];
+        uint32_t budget;
+        uint32_t generation;
+    };
+
+    Session session;
+    uint32_t started; ///< Session the sampler runs, slave only
+    Sampler sampler;  ///< Slave only
+};
+
+/** @brief Buddhabrot mode, drawn into the renderer's canvas
+ *
+ * Both SH2 sample orbits of the current view, each into its own 16-bit
+ * density buffer, so they never write the same memory. Every
+ * BUDDHABROT_TONEMAP_FRAMES frames, and more often at first, the master adds
+ * the two buffers up and tone maps them into the canvas palette indices.
+ * Orbits are iterated in `Fxp`, views narrower than its resolution allows
+ * come out blocky.
+ */
+class BuddhabrotMode
+{
+private:
+    BuddhabrotTask::Sampler master;
+    BuddhabrotTask task;
+    uint16_t *densities[2]; ///< Master's, slave's
+    uint8_t *canvas;
+    uint16_t width;
+    uint16_t height;
+    uint16_t frames;
+    bool open;
+
+public:
+    BuddhabrotMode() : master(), task(), densities(), canvas(nullptr), width(0), height(0), frames(0), open(false)
+    {
+    }
+
+    /** @brief Start accumulating a view
+     * @param view View to sample, narrowed to `Fxp`
+     * @param destination Canvas the image is tone mapped into
+     * @param canvasWidth Width of the canvas
+     * @param canvasHeight Height of the canvas
+     * @return false when the density buffers do not fit in memory
+     */
+    bool Open(const MandelbrotView<Fxp48> &view, uint8_t *destination, uint16_t canvasWidth, uint16_t canvasHeight)
+    {
+        const size_t count = static_cast<size_t>(canvasWidth) * canvasHeight;
+        densities[0] = new uint16_t[count];
+        densities[1] = new uint16_t[count];
+
+        if (densities[0] == nullptr || densities[1] == nullptr)
+        {
+            Log::LogPrint<LogLevels::WARNING>("buddhabrot: no room for the density buffers");
+            delete[] densities[0];
+            delete[] densities[1];
+            return false;
+        }
+
+        canvas = destination;
+        width = canvasWidth;
+        height = canvasHeight;
+        frames = 0;
+
+        const int32_t bounds[4] = {view.minReal.RawAt(16), view.maxReal.RawAt(16), view.minImag.RawAt(16), view.maxImag.RawAt(16)};
+
+        // The slave clears its own buffer again, this only keeps the first tone maps clean until it has
+        memset(densities[0], 0, count * sizeof(uint16_t));
+        memset(densities[1], 0, count * sizeof(uint16_t));
+        master.Start(densities[0], width, height, bounds[0], bounds[1], bounds[2], bounds[3], 0x2545F491);
+        CacheThrough(&task)->setSession(densities[1], width, height, bounds, 0);
+
+        memset(canvas, 0, count);
+        open = true;
+
+        Log::LogPrint<LogLevels::INFO>("buddhabrot: %s sampling, %d iterations",
+                                       master.IsMetropolis() ? "metropolis" : "uniform",
+                                       BUDDHABROT_ITERATIONS);
+        return true;
+    }
+
+    bool IsOpen() const { return open; }
+
+    /** @brief Sample for one frame
+     * @param budget Master's work, in iteration units, the slave gets the same per run
+     * @return true when the canvas was updated
+     */
+    bool Update(uint32_t budget)
+    {
+        if (!task.IsRunning())
+        {
+            CacheThrough(&task)->setBudget(budget);
+            SRL::Slave::ExecuteOnSlave(task);
+        }
+
+        master.Run(budget);
+        ++frames;
+
+        // Powers of two first, so the image appears quickly
+        if (frames % BUDDHABROT_TONEMAP_FRAMES != 0 && (frames & (frames - 1)) != 0)
+        {
+            return false;
+        }
+
+        const uint16_t *buffers[2] = {densities[0], CacheThrough(densities[1])};
+        ToneMapDensity(buffers, 2, static_cast<size_t>(width) * height, canvas);
+        return true;
+    }
+
+    /** @brief Stop sampling and free the buffers */
+    void Close()
+    {
+        if (!open)
+        {
+            return;
+        }
+
+        while (task.IsRunning())
+        {
+        }
+
+        const BuddhabrotTask::Sampler &slave = CacheThrough(&task)->getSampler();
+
+        Log::LogPrint<LogLevels::INFO>("buddhabrot: master %d orbits, %d kept, %d points; slave %d orbits, %d kept, %d points",
+                                       static_cast<int32_t>(master.GetSamples()),
+                                       static_cast<int32_t>(master.GetAccepted()),
+                                       static_cast<int32_t>(master.GetDeposits()),
+                                       static_cast<int32_t>(slave.GetSamples()),
+                                       static_cast<int32_t>(slave.GetAccepted()),
+                                       static_cast<int32_t>(slave.GetDeposits()));
+
+        delete[] densities[0];
+        delete[] densities[1];
+        densities[0] = densities[1] = nullptr;
+        open = false;
+    }
+};
+
+/** @brief Pad buttons as an InputLog mask */
+static uint16_t ReadPad(SRL::Input::Digital &pad)
+{
+    using Button = SRL::Input::Digital::Button;
+
+    static constexpr struct
+    {
+        Button button;
+        uint16_t bit;
+    } Buttons[] = {
+        {Button::Left, InputLog::Left},
+        {Button::Right, InputLog::Right},
+        {Button::Up, InputLog::Up},
+        {Button::Down, InputLog::Down},
+        {Button::A, InputLog::A},
+        {Button::B, InputLog::B},
+        {Button::C, InputLog::C},
+        {Button::X, InputLog::X},
+        {Button::Y, InputLog::Y},
+        {Button::Z, InputLog::Z},
+        {Button::L, InputLog::L},
+        {Button::R, InputLog::R},
+        {Button::START, InputLog::Start}};
+
+    uint16_t buttons = 0;
+
+    if (pad.IsConnected())
+    {
+        for (const auto &entry : Buttons)
+        {
+            buttons |= pad.IsHeld(entry.button) ? entry.bit : 0;
+        }
+    }
+
+    return buttons;
+}
+
+/** @brief Read a whole file from the CD
+ * @param name File name on the CD
+ * @param size Receives the file size in bytes
+ * @return File image, nullptr when the file is missing
+ */
+static uint8_t *LoadFile(const char *name, size_t &size)
+{
+    const int32_t id = GFS_NameToId(reinterpret_cast<Sint8 *>(const_cast<char *>(name)));
+    GfsHn file = id >= 0 ? GFS_Open(id) : nullptr;
+
+    if (file == nullptr)
+    {
+        return nullptr;
+    }
+
+    Sint32 sectorSize;
+    Sint32 sectors;
+    Sint32 lastSize;
+    GFS_GetFileSize(file, &sectorSize, &sectors, &lastSize);
+
+    uint8_t *data = new uint8_t[sectors * sectorSize];
+    GFS_Fread(file, sectors, data, sectors * sectorSize);
+    GFS_Close(file);
+
+    size = (sectors - 1) * sectorSize + lastSize;
+    return data;
+}
+
+/** @brief Print a recorded log as hex lines, which `tools/inputlog` turns back into a file */
+template <size_t MaxEvents>
+static void DumpInputLog(const InputRecorder<MaxEvents> &recorder)
+{
+    static constexpr size_t LineBytes = 32;
+    static constexpr char Digits[] = "0123456789ABCDEF";
+
+    const size_t size = InputLog::FileSize(recorder.GetEventCount());
+    uint8_t *data = new uint8_t[size];
+    recorder.Write(data);
+
+    Log::LogPrint<LogLevels::INFO>("input: %d frames, %d events, %d bytes",
+                                   static_cast<int32_t>(recorder.GetFrameCount()),
+                                   static_cast<int32_t>(recorder.GetEventCount()),
+                                   static_cast<int32_t>(size));
+
+    for (size_t offset = 0; offset < size; offset += LineBytes)
+    {
+        char line[LineBytes * 2 + 1];
+        const size_t count = std::min(LineBytes, size - offset);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            line[i * 2] = Digits[data[offset + i] >> 4];
+            line[i * 2 + 1] = Digits[data[offset + i] & 0xF];
+        }
+
+        line[count * 2] = '\0';
+        Log::LogPrint<LogLevels::INFO>("mil %s", line);
+    }
+
+    delete[] data;
+}
+
+/** @brief Log the numbers of a finished replay */
+static void LogReplayStats(const ReplayStats &stats)
+{
+    const uint32_t frames = stats.GetFrames() > 0 ? stats.GetFrames() : 1;
+    const uint32_t latencies = stats.GetLatencies() > 0 ? stats.GetLatencies() : 1;
+
+    Log::LogPrint<LogLevels::INFO>("replay: %d frames in %d fields, %d.%02d fields per frame, max %d, %d late",
+                                   static_cast<int32_t>(stats.GetFrames()),
+                                   static_cast<int32_t>(stats.GetFields()),
+                                   static_cast<int32_t>(stats.GetFields() / frames),
+                                   static_cast<int32_t>(stats.GetFields() * 100 / frames % 100),
+                                   stats.GetMaxFields(),
+                                   static_cast<int32_t>(stats.GetLateFrames()));
+
+    Log::LogPrint<LogLevels::INFO>("replay: latency %d views, %d.%02d fields average, max %d",
+                                   static_cast<int32_t>(stats.GetLatencies()),
+                                   static_cast<int32_t>(stats.GetLatencyFields() / latencies),
+                                   static_cast<int32_t>(stats.GetLatencyFields() * 100 / latencies % 100),
+                                   stats.GetMaxLatency());
+
+    Log::LogPrint<LogLevels::INFO>("replay: %d pixels, %d per frame, max %d",
+                                   static_cast<int32_t>(stats.GetPixels()),
+                                   static_cast<int32_t>(stats.GetPixels() / frames),
+                                   static_cast<int32_t>(stats.GetMaxPixels()));
+}
+
+/** @brief Program entry point
+ *
+ * Initializes the SRL core, constructs the Mandelbrot renderer and enters the
+ * main loop which progressively renders the fractal and draws it to screen.
+ */
+int main()
+{
+    static MandelbrotRenderer<Fxp48> *g_renderer = nullptr;
+
+    SRL::Core::Initialize(HighColor(0, 0, 0));
+
+    // Detect the RAM cartridge once, before anything allocates caches
+    static ExpansionCart cart;
+
+    // Views in 16.48, iterated in the cheapest precision their zoom allows
+    g_renderer = new MandelbrotRenderer<Fxp48>(cart);
+
+    assert(g_renderer != nullptr && "Failed to create MandelbrotRenderer");
+
+    SRL::Input::Digital pad(0);
+
+    // Pad input of the session, live or from a recorded log
+    PadState input;
+    InputMode inputMode = INPUT_MODE;
+    InputRecorder<INPUT_LOG_EVENTS> *recorder = nullptr;
+    InputReplayer replayer;
+    static ReplayStats replayStats(TARGET_FIELDS);
+    uint32_t sessionFields = 0;
+
+    if (inputMode == InputMode::Record)
+    {
+        recorder = new InputRecorder<INPUT_LOG_EVENTS>();
+    }
+    else if (inputMode == InputMode::Replay)
+    {
+        size_t size = 0;
+        const uint8_t *log = LoadFile(INPUT_LOG_FILE, size);
+
+        if (log == nullptr || !replayer.Open(log, size))
+        {
+            Log::LogPrint<LogLevels::WARNING>("replay: %s not found or not a log, using the pad", INPUT_LOG_FILE);
+            inputMode = InputMode::Live;
+        }
+        else
+        {
+            Log::LogPrint<LogLevels::INFO>("replay: %s, %d frames", INPUT_LOG_FILE, static_cast<int32_t>(replayer.GetFrameCount()));
+        }
+    }
+
+    // Kiosk mode playback of the pre-rendered zoom, toggled with START
+    static ZoomPlayer player;
+
+    // Buddhabrot of the current view on both SH2, toggled with Y
+    static BuddhabrotMode buddhabrot;
+
+    // Holds the frame rate by trading preview quality and render time
+    static QualityGovernor governor(TARGET_FIELDS, WIDTH * MAX_ITERATIONS / 4);
+    static volatile uint16_t fieldCount = 0;
+    uint16_t frameStart = 0;
+    uint16_t heldFrames = 0;
+
+    // Setup VBlank event
+    SRL::Core::OnVblank += []()
+    {
+        ++fieldCount;
+        g_renderer->upload();
+    };
+
+    // Main program loop
+    while (true)
+    {
+        if (inputMode == InputMode::Replay && replayer.IsDone())
+        {
+            LogReplayStats(replayStats);
+            inputMode = InputMode::Live;
+        }
+
+        input.Update(inputMode == InputMode::Replay ? replayer.Next() : ReadPad(pad));
+
+        if (inputMode == InputMode::Record)
+        {
+            // L+R, or a full log, ends the recording
+            const bool stop = (input.WasPressed(InputLog::L) && input.IsHeld(InputLog::R)) ||
+                              (input.WasPressed(InputLog::R) && input.IsHeld(InputLog::L));
+
+            if (stop || !recorder->Record(input.GetButtons()))
+            {
+                DumpInputLog(*recorder);
+                inputMode = InputMode::Live;
+            }
+        }
+
+        if (input.WasPressed(InputLog::Start) && !buddhabrot.IsOpen())
+        {
+            if (player.IsOpen())
+            {
+                player.Close();
+                g_renderer->resume();
+            }
+            else
+            {
+                g_renderer->suspend();
+
+                if (!player.Open(ZOOM_STREAM_FILE, WIDTH, HEIGHT))
+                {
+                    g_renderer->resume();
+                }
+            }
+        }
+
+        if (input.WasPressed(InputLog::Y) && !player.IsOpen())
+        {
+            if (buddhabrot.IsOpen())
+            {
+                buddhabrot.Close();
+                g_renderer->resume();
+            }
+            else
+            {
+                g_renderer->suspend();
+
+                if (!buddhabrot.Open(g_renderer->getView(), g_renderer->getCanvasData(), WIDTH, HEIGHT))
+                {
+                    g_renderer->resume();
+                }
+            }
+        }
+
+        if (buddhabrot.IsOpen())
+        {
+            if (buddhabrot.Update(governor.GetBudget()))
+            {
+                g_renderer->invalidate();
+            }
+
+            g_renderer->draw();
+            SRL::Core::Synchronize();
+            sessionFields += static_cast<uint16_t>(fieldCount - frameStart);
+            frameStart = fieldCount;
+            continue;
+        }
+
+        if (player.IsOpen())
+        {
+            if (player.Update(g_renderer->getCanvasData()))
+            {
+                g_renderer->invalidate();
+            }
+
+            g_renderer->draw();
+            SRL::Core::Synchronize();
+            sessionFields += static_cast<uint16_t>(fieldCount - frameStart);
+            frameStart = fieldCount;
+            continue;
+        }
+
+        // D-pad pans (repeating while held), A zooms in, C zooms out, B goes back to the previous view,
+        // Z cycles the render strategies, X the tile order of the tile strategies
+        bool moving = false;
+
+        const MandelbrotView<Fxp48> &view = g_renderer->getView();
+        const bool held = input.IsHeld(InputLog::Left | InputLog::Right | InputLog::Up | InputLog::Down);
+
+        heldFrames = held ? heldFrames + 1 : 0;
+
+        const bool repeat = heldFrames >= REPEAT_DELAY && (heldFrames - REPEAT_DELAY) % REPEAT_INTERVAL == 0;
+
+        if (input.WasPressed(InputLog::Z))
+        {
+            const uint8_t next = (static_cast<uint8_t>(g_renderer->getStrategy()) + 1) %
+                                 static_cast<uint8_t>(RenderStrategyKind::Count);
+            g_renderer->setStrategy(static_cast<RenderStrategyKind>(next));
+        }
+
+        if (input.WasPressed(InputLog::X))
+        {
+            const uint8_t next = (static_cast<uint8_t>(g_renderer->getTileOrder()) + 1) %
+                                 static_cast<uint8_t>(TileOrder::Count);
+            g_renderer->setTileOrder(static_cast<TileOrder>(next));
+        }
+
+        if (input.WasPressed(InputLog::B))
+        {
+            moving = g_renderer->back();
+        }
+        else if (input.WasPressed(InputLog::A))
+        {
+            g_renderer->navigate(view.Zoomed(true));
+            moving = true;
+        }
+        else if (input.WasPressed(InputLog::C))
+        {
+            g_renderer->navigate(view.Zoomed(false));
+            moving = true;
+        }
+        else if (input.WasPressed(InputLog::Left | InputLog::Right | InputLog::Up | InputLog::Down) || repeat)
+        {
+            const int8_t dx = input.IsHeld(InputLog::Right) ? 1 : (input.IsHeld(InputLog::Left) ? -1 : 0);
+            const int8_t dy = input.IsHeld(InputLog::Down) ? 1 : (input.IsHeld(InputLog::Up) ? -1 : 0);
+            g_renderer->navigate(view.Panned(dx, dy));
+            moving = true;
+        }
+
+        if (moving)
+        {
+            // Latency runs until the new view is covered on screen
+            replayStats.ViewRequested(sessionFields);
+        }
+
+        // A held direction keeps the governor in motion mode between repeats
+        moving = moving || held;
+
+        g_renderer->setQuality(governor.GetPreviewIterations(MAX_ITERATIONS), governor.AllowRefinement());
+
+        if (!g_renderer->isFinished())
+        {
+            // Render the Mandelbrot set
+            g_renderer->render(governor.GetBudget());
+        }
+
+        const uint16_t previewFrames = g_renderer->takePreviewFrames();
+
+        if (previewFrames > 0)
+        {
+            governor.PreviewDone(previewFrames);
+        }
+
+        g_renderer->draw();
+        SRL::Core::Synchronize();
+
+        const uint16_t now = fieldCount;
+        const uint16_t fields = now - frameStart;
+        governor.FrameDone(fields, moving);
+        frameStart = now;
+        sessionFields += fields;
+
+        const uint32_t pixels = g_renderer->takeFramePixels();
+
+        if (inputMode == InputMode::Replay)
+        {
+            replayStats.FrameDone(fields, pixels);
+
+            // Covered by its preview, or by an image restored from a cache
+            if (!g_renderer->isPreviewing())
+            {
+                replayStats.ViewShown(sessionFields);
+            }
+        }
     }
 
     return 0;
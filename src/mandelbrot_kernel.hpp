@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+/** @brief Iterate the Mandelbrot recurrence for one point, visiting its orbit
+ *
+ * Iterates z_{n+1} = z_n^2 + c, starting from z_1 = c, until the magnitude
+ * exceeds 2 or the iteration cap is reached. Only relies on arithmetic and
+ * comparison operators of RealT, so it is shared by the Saturn renderer
+ * (Fxp) and the host tools (double).
+ * @param cReal Real component of c
+ * @param cImag Imaginary component of c
+ * @param maxIterations Iteration cap
+ * @param visit Called with every z_{n+1} that did not escape
+ * @return iteration count (0..maxIterations)
+ */
+template <typename RealT, typename Visit>
+inline uint16_t IterateMandelbrot(const RealT &cReal, const RealT &cImag, uint16_t maxIterations, Visit &&visit)
+{
+    uint16_t iteration = 0;
+    RealT zReal = cReal;
+    RealT zImag = cImag;
+    const RealT two = static_cast<RealT>(2.0);
+    const RealT four = static_cast<RealT>(4.0);
+
+    while (iteration < maxIterations)
+    {
+        RealT zRealTemp = zReal * zReal - zImag * zImag + cReal;
+        zImag = two * zReal * zImag + cImag;
+        zReal = zRealTemp;
+
+        if (zReal * zReal + zImag * zImag > four)
+        {
+            return iteration;
+        }
+
+        visit(zReal, zImag);
+        ++iteration;
+    }
+    return maxIterations;
+}
+
+/** @brief Iterate the Mandelbrot recurrence for one point
+ *
+ * The plain escape time, the orbit visitor compiles away.
+ * @param cReal Real component of c
+ * @param cImag Imaginary component of c
+ * @param maxIterations Iteration cap
+ * @return iteration count (0..maxIterations)
+ */
+template <typename RealT>
+inline uint16_t IterateMandelbrot(const RealT &cReal, const RealT &cImag, uint16_t maxIterations)
+{
+    return IterateMandelbrot(cReal, cImag, maxIterations, [](const RealT &, const RealT &) {});
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Half of the SH2 cache used as zero wait state RAM
+ *
+ * In two-way mode (CCR.TW) the SH2 keeps caching with ways 2 and 3 and
+ * exposes the data arrays of ways 0 and 1 as 2KB of on-chip RAM at
+ * 0xC0000000-0xC00007FF, per the SH7604 hardware manual. The upper half of
+ * the data array window belongs to the ways still caching, writing there
+ * would corrupt cached lines. Each CPU has its own
+ * cache, so each one has to switch its own CCR and gets its own 2KB at the
+ * same address: data placed there is private to the CPU that wrote it.
+ *
+ * Allocation is a bump pointer with no release, meant for a few tables that
+ * live as long as the program. Allocate() returns nullptr when the request
+ * does not fit or the mode is off, and the caller keeps its work RAM copy.
+ */
+class OnChipRam
+{
+private:
+    static constexpr uintptr_t CcrAddress = 0xFFFFFE92;
+    static constexpr uintptr_t RamAddress = 0xC0000000; ///< Data arrays of ways 0 and 1
+    static constexpr uint8_t CacheEnable = 0x01;
+    static constexpr uint8_t TwoWay = 0x08;
+    static constexpr uint8_t Purge = 0x10;
+
+    size_t used;
+    bool enabled;
+
+    static volatile uint8_t &ccr()
+    {
+        return *reinterpret_cast<volatile uint8_t *>(CcrAddress);
+    }
+
+public:
+    static constexpr size_t Size = 2048;
+
+    OnChipRam() : used(0), enabled(false)
+    {
+    }
+
+    /** @brief Switch the cache of the calling CPU to two-way mode
+     *
+     * The cache is disabled while the mode changes and purged, so nothing
+     * cached before is lost: the SH2 cache is write-through.
+     */
+    void Enable()
+    {
+        const uint8_t mode = ccr() & ~(CacheEnable | Purge);
+        ccr() = mode;
+        ccr() = mode | TwoWay | Purge;
+        ccr() = mode | TwoWay | CacheEnable;
+        enabled = true;
+    }
+
+    bool IsEnabled() const { return enabled; }
+
+    /** @brief Reserve room for `count` objects, aligned to 4 bytes
+     * @return Address in on-chip RAM, nullptr when it does not fit
+     */
+    template <typename T>
+    T *Allocate(size_t count)
+    {
+        const size_t size = (count * sizeof(T) + 3) & ~static_cast<size_t>(3);
+
+        if (!enabled || used + size > Size)
+        {
+            return nullptr;
+        }
+
+        T *address = reinterpret_cast<T *>(RamAddress + used);
+        used += size;
+        return address;
+    }
+
+    /** @brief Bytes handed out so far */
+    size_t GetUsed() const { return used; }
+};
+
+/** @brief SH2 free-running timer, for measuring short stretches of code
+ *
+ * Reads the 16-bit counter the system already runs, so results are in its
+ * ticks and only meant for comparisons. Spans longer than the counter
+ * period wrap around.
+ */
+class FreeRunningTimer
+{
+private:
+    static constexpr uintptr_t FrcHighAddress = 0xFFFFFE12;
+    static constexpr uintptr_t FrcLowAddress = 0xFFFFFE13;
+
+public:
+    /** @brief Current counter value, the high byte is read first as the hardware requires */
+    static uint16_t Read()
+    {
+        const uint8_t high = *reinterpret_cast<volatile uint8_t *>(FrcHighAddress);
+        const uint8_t low = *reinterpret_cast<volatile uint8_t *>(FrcLowAddress);
+        return static_cast<uint16_t>(high << 8 | low);
+    }
+};
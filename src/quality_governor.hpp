@@ -0,0 +1,130 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace SRL::Logger;
+
+/** @brief Adaptive quality control holding a target frame rate
+ *
+ * Fed once per frame with the number of display fields the frame took and
+ * whether the pad moved the view, it steers three knobs of the renderer:
+ * - the per-frame compute budget, in iteration units: grown by 1/16 on every
+ *   frame that met the target, cut by a quarter on every late frame
+ * - the iteration cap of the preview pass, halved (down to a quarter) when
+ *   previews take longer than `PreviewFrames` while the view is moving,
+ *   raised again when they finish in half that time
+ * - the resolution: while the view moves only the preview pass runs, the
+ *   full resolution pass waits until the pad has been idle for `IdleFrames`
+ *
+ * When the pad is idle the iteration cap goes back to full quality.
+ */
+class QualityGovernor
+{
+private:
+    static constexpr uint32_t MinBudget = 1024;          ///< Keeps rendering moving on very slow frames
+    static constexpr uint32_t MaxBudget = 4 * 1024 * 1024;
+    static constexpr uint8_t MaxIterationShift = 2;      ///< Preview cap down to a quarter
+    static constexpr uint16_t IdleFrames = 30;           ///< Frames without input before refining
+    static constexpr uint16_t PreviewFrames = 8;         ///< Preview time aimed for while moving
+
+    uint8_t targetFields;
+    uint32_t budget;
+    uint8_t iterationShift;
+    uint16_t idleFrames;
+    uint32_t frames;
+    uint32_t lateFrames;
+
+public:
+    /** @brief Construct a governor
+     * @param targetFields Display fields per frame aimed for (1 for 60 fps, 2 for 30 fps)
+     * @param initialBudget Compute budget of the first frame
+     */
+    QualityGovernor(uint8_t targetFields, uint32_t initialBudget) : targetFields(targetFields > 0 ? targetFields : 1),
+                                                                    budget(initialBudget),
+                                                                    iterationShift(0),
+                                                                    idleFrames(IdleFrames),
+                                                                    frames(0),
+                                                                    lateFrames(0)
+    {
+    }
+
+    /** @brief Account for a finished frame
+     * @param fields Display fields the frame took
+     * @param moving Whether the view was changed by input this frame
+     */
+    void FrameDone(uint16_t fields, bool moving)
+    {
+        ++frames;
+
+        if (fields > targetFields)
+        {
+            ++lateFrames;
+            budget -= budget / 4;
+            budget = budget < MinBudget ? MinBudget : budget;
+        }
+        else if (budget < MaxBudget)
+        {
+            budget += budget / 16 + 1;
+        }
+
+        if (moving)
+        {
+            idleFrames = 0;
+        }
+        else if (idleFrames < IdleFrames)
+        {
+            if (++idleFrames == IdleFrames)
+            {
+                iterationShift = 0;
+                Log::LogPrint<LogLevels::INFO>("governor: idle, full quality, budget %d, %d/%d frames late",
+                                               static_cast<int32_t>(budget),
+                                               static_cast<int32_t>(lateFrames),
+                                               static_cast<int32_t>(frames));
+            }
+        }
+    }
+
+    /** @brief Account for a finished preview pass
+     * @param previewFrames Frames the preview pass took
+     */
+    void PreviewDone(uint16_t previewFrames)
+    {
+        if (!IsMoving())
+        {
+            return;
+        }
+
+        if (previewFrames > PreviewFrames && iterationShift < MaxIterationShift)
+        {
+            ++iterationShift;
+            Log::LogPrint<LogLevels::INFO>("governor: preview took %d frames, cap 1/%d", previewFrames, 1 << iterationShift);
+        }
+        else if (previewFrames <= PreviewFrames / 2 && iterationShift > 0)
+        {
+            --iterationShift;
+            Log::LogPrint<LogLevels::INFO>("governor: preview took %d frames, cap 1/%d", previewFrames, 1 << iterationShift);
+        }
+    }
+
+    /** @brief Whether input changed the view recently */
+    bool IsMoving() const { return idleFrames < IdleFrames; }
+
+    /** @brief Compute budget for the next frame, in iteration units */
+    uint32_t GetBudget() const { return budget; }
+
+    /** @brief Iteration cap for the preview pass
+     * @param maxIterations Full quality cap
+     */
+    uint16_t GetPreviewIterations(uint16_t maxIterations) const
+    {
+        const uint16_t cap = maxIterations >> iterationShift;
+        return cap > 0 ? cap : 1;
+    }
+
+    /** @brief Whether the full resolution pass may run */
+    bool AllowRefinement() const { return !IsMoving(); }
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Quadtree of complex plane regions with a known iteration count
+ *
+ * Records rectangles found to be inside the set, or to escape uniformly
+ * after a given number of iterations, together with the iteration cap they
+ * were computed under and the pixel spacing they were sampled at. It
+ * outlives the views, so zooming or panning around the same area finds the
+ * regions again instead of iterating them.
+ *
+ * A region comes from pixels, not from a proof: detail thinner than the
+ * spacing it was sampled at can hide inside. Lookups are therefore only
+ * answered at the same spacing or a coarser one, compared by tree level:
+ * the level whose node size is the largest one not above the spacing. A
+ * pan keeps the level and a zoom in by two always moves to the next one.
+ *
+ * The tree covers the square [-extent, extent) on both axes and is split
+ * down to `MaxDepth` levels. A leaf is either unknown or uniform. Inserting
+ * marks the leaves fully inside the rectangle and splits the ones it only
+ * partly covers, down to a quarter of the rectangle's shorter side, so what
+ * is stored is never larger than what was found and each rectangle takes
+ * a bounded number of nodes.
+ * Nodes come from a fixed pool; once it is used up rectangles are only
+ * recorded down to the leaves that already exist.
+ * @tparam RealT Coordinate type
+ * @tparam MaxNodes Size of the node pool
+ * @tparam MaxDepth Deepest level, each one halves the node size
+ */
+template <typename RealT, size_t MaxNodes = 4096, uint8_t MaxDepth = 24>
+class RegionIndex
+{
+public:
+    /** @brief Axis-aligned rectangle of the complex plane, bounds inclusive */
+    struct Rect
+    {
+        RealT minReal;
+        RealT maxReal;
+        RealT minImag;
+        RealT maxImag;
+    };
+
+private:
+    static_assert(MaxNodes <= 0x10000, "node indices are 16-bit");
+
+    static constexpr uint16_t NoChildren = 0;
+
+    /** @brief Node of the tree, children are allocated four at a time */
+    struct Node
+    {
+        uint16_t children; ///< Index of the first child, NoChildren for a leaf
+        uint16_t iteration;
+        uint16_t cap;      ///< Cap the iteration count was computed with, 0 when unknown
+        uint8_t pitch;     ///< Level of the pixel spacing it was sampled at, finer levels are deeper
+    };
+
+    Node nodes[MaxNodes];
+    size_t used;
+    RealT sizes[MaxDepth + 1]; ///< Node size at each level
+    RealT origin;              ///< Lowest coordinate of the root on both axes
+
+    bool allocate(Node &node)
+    {
+        if (used + 4 > MaxNodes)
+        {
+            return false;
+        }
+
+        node.children = static_cast<uint16_t>(used);
+
+        for (uint8_t i = 0; i < 4; ++i)
+        {
+            nodes[used + i] = Node{NoChildren, node.iteration, node.cap, node.pitch};
+        }
+
+        used += 4;
+        return true;
+    }
+
+    void insert(uint16_t index, const RealT &real, const RealT &imag, uint8_t depth, uint8_t limit, const Rect &rect, uint16_t iteration, uint16_t cap, uint8_t pitch)
+    {
+        Node &node = nodes[index];
+        const RealT &size = sizes[depth];
+
+        if (real > rect.maxReal || real + size <= rect.minReal || imag > rect.maxImag || imag + size <= rect.minImag)
+        {
+            return; // Disjoint
+        }
+
+        if (real >= rect.minReal && real + size <= rect.maxReal && imag >= rect.minImag && imag + size <= rect.maxImag)
+        {
+            node.children = NoChildren; // Its former children stay allocated but unreachable
+            node.iteration = iteration;
+            node.cap = cap;
+            node.pitch = pitch;
+            return;
+        }
+
+        if (node.children == NoChildren && (depth == limit || (node.cap == cap && node.iteration == iteration && node.pitch >= pitch) || !allocate(node)))
+        {
+            return;
+        }
+
+        const RealT &half = sizes[depth + 1];
+        const uint16_t first = node.children;
+        insert(first, real, imag, depth + 1, limit, rect, iteration, cap, pitch);
+        insert(first + 1, real + half, imag, depth + 1, limit, rect, iteration, cap, pitch);
+        insert(first + 2, real, imag + half, depth + 1, limit, rect, iteration, cap, pitch);
+        insert(first + 3, real + half, imag + half, depth + 1, limit, rect, iteration, cap, pitch);
+    }
+
+    /** @brief Tree level of a pixel spacing, the first one whose nodes are not larger */
+    uint8_t level(const RealT &spacing) const
+    {
+        uint8_t result = 0;
+
+        while (result < MaxDepth && sizes[result] > spacing)
+        {
+            ++result;
+        }
+
+        return result;
+    }
+
+    /** @brief Whether the part of the rectangle inside a node is uniform
+     * @param value Holds the iteration count found so far, 0xFFFF for none yet
+     */
+    bool covered(uint16_t index, const RealT &real, const RealT &imag, uint8_t depth, const Rect &rect, uint16_t cap, uint8_t pitch, uint16_t &value) const
+    {
+        const Node &node = nodes[index];
+        const RealT &size = sizes[depth];
+
+        if (real > rect.maxReal || real + size <= rect.minReal || imag > rect.maxImag || imag + size <= rect.minImag)
+        {
+            return true; // Nothing of the rectangle here
+        }
+
+        if (node.children == NoChildren)
+        {
+            if (node.cap == 0 || cap > node.cap || pitch > node.pitch)
+            {
+                return false;
+            }
+
+            // Escaping before the new cap still escapes at the same count, anything else reaches it
+            const uint16_t result = node.iteration < cap ? node.iteration : cap;
+
+            if (value != 0xFFFF && value != result)
+            {
+                return false;
+            }
+
+            value = result;
+            return true;
+        }
+
+        const RealT &half = sizes[depth + 1];
+        const uint16_t first = node.children;
+
+        return covered(first, real, imag, depth + 1, rect, cap, pitch, value) &&
+               covered(first + 1, real + half, imag, depth + 1, rect, cap, pitch, value) &&
+               covered(first + 2, real, imag + half, depth + 1, rect, cap, pitch, value) &&
+               covered(first + 3, real + half, imag + half, depth + 1, rect, cap, pitch, value);
+    }
+
+public:
+    /** @brief Build an empty index
+     * @param extent Half the width of the covered square, centered on 0
+     */
+    explicit RegionIndex(const RealT &extent) : nodes(), used(0), origin(-extent)
+    {
+        sizes[0] = extent + extent;
+
+        for (uint8_t depth = 0; depth < MaxDepth; ++depth)
+        {
+            sizes[depth + 1] = sizes[depth] / static_cast<RealT>(2.0);
+        }
+
+        Clear();
+    }
+
+    /** @brief Forget every region */
+    void Clear()
+    {
+        nodes[0] = Node{NoChildren, 0, 0, 0};
+        used = 1;
+    }
+
+    /** @brief Record a rectangle whose points all have the same iteration count
+     * @param rect Rectangle, bounds inclusive
+     * @param iteration Iteration count of every point, `cap` for the interior
+     * @param cap Iteration cap it was computed with
+     * @param spacing Distance between the pixels it was sampled at
+     */
+    void Insert(const Rect &rect, uint16_t iteration, uint16_t cap, const RealT &spacing)
+    {
+        // Edges are followed with nodes down to a quarter of the shorter side, not to MaxDepth
+        const RealT width = rect.maxReal - rect.minReal;
+        const RealT height = rect.maxImag - rect.minImag;
+        const uint8_t limit = level(width < height ? width : height);
+        insert(0, origin, origin, 0, limit + 2 < MaxDepth ? limit + 2 : MaxDepth, rect, iteration, cap, level(spacing));
+    }
+
+    /** @brief Look up a rectangle
+     * @param rect Rectangle, bounds inclusive
+     * @param cap Iteration cap of the caller, answered from regions computed with this cap or a higher one
+     * @param spacing Distance between the caller's pixels, answered from regions sampled this finely or finer
+     * @param iteration Receives the iteration count of every point
+     * @return true when the whole rectangle is known and uniform
+     */
+    bool Query(const Rect &rect, uint16_t cap, const RealT &spacing, uint16_t &iteration) const
+    {
+        uint16_t value = 0xFFFF;
+        const RealT end = origin + sizes[0];
+
+        if (rect.minReal < origin || rect.maxReal >= end || rect.minImag < origin || rect.maxImag >= end)
+        {
+            return false;
+        }
+
+        if (!covered(0, origin, origin, 0, rect, cap, level(spacing), value) || value == 0xFFFF)
+        {
+            return false;
+        }
+
+        iteration = value;
+        return true;
+    }
+
+    /** @brief Nodes taken from the pool */
+    size_t GetUsedNodes() const { return used; }
+};
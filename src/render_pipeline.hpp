@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Uncached alias of a work RAM address
+ *
+ * Both SH2 have their own cache and neither sees the lines of the other.
+ * Data shared between them is read and written through the cache-through
+ * mirror of its address, 0x20000000 above the cached one.
+ */
+template <typename T>
+T *CacheThrough(T *pointer)
+{
+    return reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(pointer) | 0x20000000);
+}
+
+/** @brief A rectangle of the canvas moving through the pipeline stages */
+struct PipelineTile
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint8_t slot; ///< Staging buffer holding its raw iteration counts
+};
+
+/** @brief How full a queue was, sampled once per frame
+ *
+ * A queue that is often full is waiting on the stage that reads it, one
+ * that is often empty has a reader waiting on the stage that writes it.
+ */
+struct StageStats
+{
+    uint32_t samples = 0;
+    uint32_t occupancy = 0; ///< Sum of the sampled sizes
+    uint32_t full = 0;      ///< Samples where the queue was full
+    uint32_t empty = 0;     ///< Samples where the queue was empty
+    uint32_t items = 0;     ///< Items that went through
+
+    void Clear()
+    {
+        *this = StageStats();
+    }
+};
+
+/** @brief Bounded single producer, single consumer queue between two stages
+ *
+ * The producer only moves `tail` and the consumer only moves `head`, so no
+ * lock is needed between the master and the slave SH2, or between the main
+ * loop and the VBlank interrupt. Queues shared by the two processors are
+ * used through CacheThrough().
+ * @tparam T Item type
+ * @tparam Capacity Number of items, one slot is kept free to tell full from empty
+ */
+template <typename T, uint8_t Capacity>
+class StageQueue
+{
+private:
+    static constexpr uint8_t Size = Capacity + 1;
+
+    T items[Size];
+    volatile uint8_t head = 0;
+    volatile uint8_t tail = 0;
+    StageStats stats; ///< Updated by the consumer and by Sample()
+
+public:
+    /** @brief Add an item at the end
+     * @return false when the queue is full
+     */
+    bool Push(const T &item)
+    {
+        const uint8_t next = (tail + 1) % Size;
+
+        if (next == head)
+        {
+            return false;
+        }
+
+        items[tail] = item;
+        tail = next;
+        return true;
+    }
+
+    /** @brief Take the first item
+     * @return false when the queue is empty
+     */
+    bool Pop(T &item)
+    {
+        if (head == tail)
+        {
+            return false;
+        }
+
+        item = items[head];
+        head = (head + 1) % Size;
+        ++stats.items;
+        return true;
+    }
+
+    /** @brief Number of items waiting */
+    uint8_t GetCount() const
+    {
+        return (tail + Size - head) % Size;
+    }
+
+    bool IsEmpty() const { return head == tail; }
+
+    bool IsFull() const { return (tail + 1) % Size == head; }
+
+    /** @brief Drop every item, only when neither side is using the queue */
+    void Clear()
+    {
+        head = tail;
+    }
+
+    /** @brief Record the current occupancy */
+    void Sample()
+    {
+        const uint8_t count = GetCount();
+        ++stats.samples;
+        stats.occupancy += count;
+        stats.full += count == Capacity ? 1 : 0;
+        stats.empty += count == 0 ? 1 : 0;
+    }
+
+    const StageStats &GetStats() const { return stats; }
+
+    void ClearStats()
+    {
+        stats.Clear();
+    }
+};
@@ -0,0 +1,942 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Pixel services a render strategy works with
+ *
+ * Implemented by the renderer. Strategies only decide in which order pixels
+ * are computed and which ones can be guessed; the renderer owns the
+ * buffers, the workers and the statistics.
+ */
+class IRenderContext
+{
+public:
+    virtual ~IRenderContext() {}
+
+    /** @brief Canvas width in pixels */
+    virtual uint16_t GetWidth() const = 0;
+
+    /** @brief Canvas height in pixels */
+    virtual uint16_t GetHeight() const = 0;
+
+    /** @brief Compute and store one pixel
+     *
+     * Preview samples that are already exact are returned without being
+     * computed again.
+     * @param x Pixel column
+     * @param y Pixel row
+     * @param cost Incremented by the work done, in iteration units
+     * @return Iteration count of the pixel
+     */
+    virtual uint16_t Compute(uint16_t x, uint16_t y, uint32_t &cost) = 0;
+
+    /** @brief Compute and store a whole row with every available worker
+     * @param y Pixel row
+     * @return Work done, in iteration units
+     */
+    virtual uint32_t ComputeRow(uint16_t y) = 0;
+
+    /** @brief Store a guessed value for a rectangle without computing it
+     *
+     * Exact preview samples inside the rectangle are kept.
+     */
+    virtual void Guess(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t iteration) = 0;
+
+    /** @brief Show a provisional value for a block, display only
+     *
+     * Nothing is stored as a result, the pixels are computed later.
+     */
+    virtual void Paint(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t iteration) = 0;
+
+    /** @brief Iteration count of a pixel the strategy already computed or guessed */
+    virtual uint16_t Get(uint16_t x, uint16_t y) const = 0;
+
+    /** @brief Hand a rectangle to the compute stage of the pipeline
+     *
+     * The slave SH2 iterates it in the background; it is stored once
+     * CollectTiles() colorizes it.
+     * @return false when the stage has no room left
+     */
+    virtual bool QueueTile(uint16_t x, uint16_t y, uint16_t width, uint16_t height) = 0;
+
+    /** @brief Store and colorize the rectangles the compute stage finished
+     * @return Work they took, in iteration units
+     */
+    virtual uint32_t CollectTiles() = 0;
+
+    /** @brief Rectangles queued and not collected yet */
+    virtual uint8_t GetTilesInFlight() const = 0;
+
+    /** @brief How much detail the preview shows in a rectangle
+     * @return Neighbouring preview samples that differ, a boundary density
+     */
+    virtual uint16_t GetInterest(uint16_t x, uint16_t y, uint16_t width, uint16_t height) const = 0;
+};
+
+/** @brief Available render strategies */
+enum class RenderStrategyKind : uint8_t
+{
+    Scanline,
+    Progressive,
+    Guessing,
+    Subdivision,
+    Tiles,
+    Pipeline,
+    Count
+};
+
+/** @brief Order in which the full resolution pass computes pixels
+ *
+ * A strategy is a resumable state machine: Step() does work until the budget
+ * is spent, at a granularity of one row, block or tile line, and picks up
+ * where it stopped on the next call. It covers the rows from the one given
+ * to Reset() down to the bottom, the rows above being restored already.
+ */
+class IRenderStrategy
+{
+public:
+    virtual ~IRenderStrategy() {}
+
+    /** @brief Name used in the statistics */
+    virtual const char *GetName() const = 0;
+
+    /** @brief Start over on a new image
+     * @param top First row to render, the rows above are complete
+     */
+    virtual void Reset(uint16_t top) = 0;
+
+    /** @brief Render within a budget
+     * @param context Pixel services
+     * @param budget Work allowed, in iteration units
+     * @return Work done, 0 to give the rest of the frame back while waiting on another CPU
+     */
+    virtual uint32_t Step(IRenderContext &context, uint32_t budget) = 0;
+
+    /** @brief Whether every pixel has been computed or guessed */
+    virtual bool IsDone() const = 0;
+
+    /** @brief Number of leading rows that are complete, for resumable snapshots */
+    virtual uint16_t GetCompletedRows() const = 0;
+};
+
+/** @brief Order in which the tile strategies take their tiles */
+enum class TileOrder : uint8_t
+{
+    RowMajor, ///< Top to bottom, left to right
+    Spiral,   ///< Square spiral out of the focus point
+    Interest, ///< Most detailed tiles of the preview first, spiral order among equals
+    Count
+};
+
+static constexpr const char *TileOrderNames[] = {"row-major", "spiral", "interest"};
+
+/** @brief Tiles of a canvas for the given tile size */
+constexpr size_t TileCount(uint16_t width, uint16_t height, uint16_t tileSize)
+{
+    return static_cast<size_t>((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize);
+}
+
+/** @brief Tile order of the tile strategies, and how soon it shows what matters
+ *
+ * Built on the first step of a pass, once the preview is in the iteration
+ * buffer, over the rows from the top given to Reset(). Whatever the order,
+ * two moments are recorded in steps (frames) of the pass:
+ * - the focus area, the tiles within a quarter of the canvas of the focus
+ *   point on both axes, is complete;
+ * - half of the preview detail (GetInterest() summed over the tiles) is.
+ * Either counts as a usable image; the strategies report tiles in the
+ * order they complete them through Finish().
+ * @tparam TileSize Tile width and height in pixels
+ * @tparam MaxTiles Tiles of the largest canvas
+ */
+template <uint16_t TileSize, size_t MaxTiles>
+class TileSchedule
+{
+private:
+    uint16_t order[MaxTiles];  ///< Tile indices, row-major over the grid, in render order
+    uint8_t scores[MaxTiles];  ///< Interest of each tile index, capped
+    size_t count = 0;
+    uint16_t columns = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint16_t top = 0;
+    bool built = false;
+
+    TileOrder kind = TileOrder::RowMajor;
+    uint16_t focusX = 0;
+    uint16_t focusY = 0;
+
+    size_t finished = 0;        ///< Leading tiles of the order that are complete
+    size_t focusLeft = 0;       ///< Focus area tiles not complete yet
+    uint32_t interest = 0;      ///< Total score
+    uint32_t finishedInterest = 0;
+    uint16_t steps = 0;
+    uint16_t focusSteps = 0;    ///< Steps until the focus area was complete, 0 while it is not
+    uint16_t detailSteps = 0;   ///< Steps until half the interest was complete, 0 while it is not
+
+    /** @brief Whether a tile index lies in the focus area */
+    bool inFocus(uint16_t index) const
+    {
+        const int32_t x = (index % columns) * TileSize;
+        const int32_t y = top + (index / columns) * TileSize;
+        const int32_t reachX = width / 4;
+        const int32_t reachY = height / 4;
+
+        return x < focusX + reachX && x + TileSize > focusX - reachX &&
+               y < focusY + reachY && y + TileSize > focusY - reachY;
+    }
+
+    /** @brief Square spiral of the grid around the focus tile, skipping the cells outside it */
+    void spiral(uint16_t *out, uint16_t rows) const
+    {
+        int32_t x = focusX / TileSize < columns ? focusX / TileSize : columns - 1;
+        int32_t y = focusY < top ? 0 : (focusY - top) / TileSize;
+        y = y < rows ? y : rows - 1;
+
+        static constexpr int8_t dx[4] = {1, 0, -1, 0};
+        static constexpr int8_t dy[4] = {0, 1, 0, -1};
+        size_t emitted = 0;
+        uint16_t length = 1;
+        uint8_t direction = 0;
+
+        auto emit = [&]()
+        {
+            if (x >= 0 && x < columns && y >= 0 && y < rows && static_cast<size_t>(y * columns + x) < count)
+            {
+                out[emitted++] = static_cast<uint16_t>(y * columns + x);
+            }
+        };
+
+        emit();
+
+        while (emitted < count)
+        {
+            for (uint8_t leg = 0; leg < 2; ++leg)
+            {
+                for (uint16_t i = 0; i < length; ++i)
+                {
+                    x += dx[direction];
+                    y += dy[direction];
+                    emit();
+                }
+
+                direction = (direction + 1) % 4;
+            }
+
+            ++length;
+        }
+    }
+
+public:
+    void SetOrder(TileOrder next) { kind = next; }
+
+    TileOrder GetOrder() const { return kind; }
+
+    /** @brief Canvas pixel the spiral starts from and the focus area is centered on */
+    void SetFocus(uint16_t x, uint16_t y)
+    {
+        focusX = x;
+        focusY = y;
+    }
+
+    /** @brief Start over, the order is built on the next Build() */
+    void Reset(uint16_t first)
+    {
+        top = first;
+        built = false;
+        count = 0;
+    }
+
+    bool IsBuilt() const { return built; }
+
+    /** @brief Lay out the tiles below the top row and order them */
+    void Build(IRenderContext &context)
+    {
+        width = context.GetWidth();
+        height = context.GetHeight();
+        columns = (width + TileSize - 1) / TileSize;
+        const uint16_t rows = top < height ? (height - top + TileSize - 1) / TileSize : 0;
+
+        count = static_cast<size_t>(columns) * rows;
+        count = count < MaxTiles ? count : MaxTiles;
+        finished = 0;
+        focusLeft = 0;
+        interest = 0;
+        finishedInterest = 0;
+        steps = 0;
+        focusSteps = 0;
+        detailSteps = 0;
+        built = true;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint16_t x;
+            uint16_t y;
+            uint16_t w;
+            uint16_t h;
+            GetRect(static_cast<uint16_t>(i), x, y, w, h);
+
+            const uint16_t score = context.GetInterest(x, y, w, h);
+            scores[i] = static_cast<uint8_t>(score < 0xFF ? score : 0xFF);
+            interest += scores[i];
+            focusLeft += inFocus(static_cast<uint16_t>(i)) ? 1 : 0;
+        }
+
+        if (kind == TileOrder::RowMajor)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                order[i] = static_cast<uint16_t>(i);
+            }
+
+            return;
+        }
+
+        spiral(order, rows);
+
+        if (kind == TileOrder::Interest)
+        {
+            // Counting sort on the score, highest first, stable so equal scores keep the spiral order
+            uint16_t starts[0x100] = {};
+            uint16_t sorted[MaxTiles];
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                ++starts[scores[order[i]]];
+            }
+
+            uint16_t position = 0;
+
+            for (int16_t score = 0xFF; score >= 0; --score)
+            {
+                const uint16_t tiles = starts[score];
+                starts[score] = position;
+                position += tiles;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                sorted[starts[scores[order[i]]]++] = order[i];
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                order[i] = sorted[i];
+            }
+        }
+    }
+
+    /** @brief Tiles of the pass */
+    size_t GetCount() const { return count; }
+
+    /** @brief Canvas rectangle of a tile index, clipped to the canvas */
+    void GetRect(uint16_t index, uint16_t &x, uint16_t &y, uint16_t &w, uint16_t &h) const
+    {
+        x = (index % columns) * TileSize;
+        y = top + (index / columns) * TileSize;
+        w = width - x < TileSize ? width - x : TileSize;
+        h = height - y < TileSize ? height - y : TileSize;
+    }
+
+    /** @brief Canvas rectangle of the tile at a position of the order */
+    void GetTile(size_t position, uint16_t &x, uint16_t &y, uint16_t &w, uint16_t &h) const
+    {
+        GetRect(order[position], x, y, w, h);
+    }
+
+    /** @brief Count a step of the pass, the unit of the usable image times */
+    void CountStep() { ++steps; }
+
+    /** @brief The tiles of the order up to `position` excluded are complete */
+    void Finish(size_t position)
+    {
+        for (; finished < position && finished < count; ++finished)
+        {
+            const uint16_t index = order[finished];
+            finishedInterest += scores[index];
+
+            if (inFocus(index) && --focusLeft == 0)
+            {
+                focusSteps = steps;
+            }
+
+            if (detailSteps == 0 && interest > 0 && 2 * finishedInterest >= interest)
+            {
+                detailSteps = steps;
+            }
+        }
+    }
+
+    /** @brief Steps until the focus area was complete, 0 before */
+    uint16_t GetFocusSteps() const { return focusSteps; }
+
+    /** @brief Steps until half of the preview detail was complete, 0 before or without detail */
+    uint16_t GetDetailSteps() const { return detailSteps; }
+
+    /** @brief Steps so far */
+    uint16_t GetSteps() const { return steps; }
+
+    /** @brief Leading rows complete, only ever past the top in row-major order */
+    uint16_t GetCompletedRows() const
+    {
+        if (kind != TileOrder::RowMajor || columns == 0)
+        {
+            return top;
+        }
+
+        return top + static_cast<uint16_t>(finished / columns) * TileSize;
+    }
+};
+
+/** @brief Row-major scan, each row shared between all workers */
+class ScanlineStrategy : public IRenderStrategy
+{
+private:
+    uint16_t row = 0;
+    bool done = false;
+
+public:
+    const char *GetName() const override { return "scanline"; }
+
+    void Reset(uint16_t top) override
+    {
+        row = top;
+        done = false;
+    }
+
+    uint32_t Step(IRenderContext &context, uint32_t budget) override
+    {
+        uint32_t spent = 0;
+
+        while (row < context.GetHeight() && spent < budget)
+        {
+            spent += context.ComputeRow(row++);
+        }
+
+        done = row >= context.GetHeight();
+        return spent;
+    }
+
+    bool IsDone() const override { return done; }
+
+    uint16_t GetCompletedRows() const override { return row; }
+};
+
+/** @brief Interlaced passes on finer and finer grids
+ *
+ * Each pass computes the pixels of a grid `step` pixels apart that coarser
+ * passes did not, and paints the block they stand for, so the whole screen
+ * sharpens at once instead of top to bottom.
+ * @tparam FirstStep Grid of the first pass, a power of two
+ */
+template <uint8_t FirstStep>
+class ProgressiveStrategy : public IRenderStrategy
+{
+private:
+    uint16_t top = 0;
+    uint16_t row = 0;
+    uint8_t step = FirstStep;
+    bool done = false;
+
+public:
+    const char *GetName() const override { return "progressive"; }
+
+    void Reset(uint16_t first) override
+    {
+        top = first;
+        step = FirstStep;
+        row = top + (step - top % step) % step;
+        done = false;
+    }
+
+    uint32_t Step(IRenderContext &context, uint32_t budget) override
+    {
+        const uint16_t width = context.GetWidth();
+        const uint16_t height = context.GetHeight();
+        uint32_t spent = 0;
+
+        while (!done && spent < budget)
+        {
+            if (row >= height)
+            {
+                if (step == 1)
+                {
+                    done = true;
+                    break;
+                }
+
+                step /= 2;
+                row = top + (step - top % step) % step;
+                continue;
+            }
+
+            const uint8_t coarse = step * 2;
+
+            for (uint16_t x = 0; x < width; x += step)
+            {
+                // Done by the previous pass, except on the first one whose coarser grid is the preview
+                if (step < FirstStep && x % coarse == 0 && row % coarse == 0)
+                {
+                    continue;
+                }
+
+                const uint16_t iteration = context.Compute(x, row, spent);
+
+                if (step > 1)
+                {
+                    const uint16_t w = width - x < step ? width - x : step;
+                    const uint16_t h = height - row < step ? height - row : step;
+                    context.Paint(x, row, w, h, iteration);
+                }
+            }
+
+            row += step;
+        }
+
+        return spent;
+    }
+
+    bool IsDone() const override { return done; }
+
+    uint16_t GetCompletedRows() const override { return done ? 0xFFFF : top; }
+};
+
+/** @brief Solid guessing on a 2x2 grid
+ *
+ * The first pass computes every even pixel. The second visits the others
+ * and guesses a pixel when the computed pixels around it (left and right,
+ * above and below, or the four diagonals) all agree, computing it otherwise.
+ * Large flat bands then cost a quarter of their pixels.
+ */
+class GuessingStrategy : public IRenderStrategy
+{
+private:
+    uint16_t top = 0;
+    uint16_t row = 0;
+    bool secondPass = false;
+    bool done = false;
+
+    /** @brief Whether a neighbour was computed in the first pass */
+    bool inGrid(IRenderContext &context, int32_t x, int32_t y) const
+    {
+        return x >= 0 && y >= top && x < context.GetWidth() && y < context.GetHeight() && x % 2 == 0 && y % 2 == 0;
+    }
+
+    uint16_t resolve(IRenderContext &context, uint16_t x, uint16_t y, uint32_t &spent)
+    {
+        int32_t dx[4];
+        int32_t dy[4];
+        uint8_t count = 0;
+
+        if (y % 2 == 0)
+        {
+            dx[0] = -1, dy[0] = 0, dx[1] = 1, dy[1] = 0, count = 2;
+        }
+        else if (x % 2 == 0)
+        {
+            dx[0] = 0, dy[0] = -1, dx[1] = 0, dy[1] = 1, count = 2;
+        }
+        else
+        {
+            dx[0] = -1, dy[0] = -1, dx[1] = 1, dy[1] = -1, dx[2] = -1, dy[2] = 1, dx[3] = 1, dy[3] = 1, count = 4;
+        }
+
+        bool agree = true;
+        uint16_t value = 0;
+
+        for (uint8_t i = 0; i < count && agree; ++i)
+        {
+            const int32_t nx = x + dx[i];
+            const int32_t ny = y + dy[i];
+
+            if (!inGrid(context, nx, ny))
+            {
+                agree = false;
+                break;
+            }
+
+            const uint16_t neighbour = context.Get(nx, ny);
+            agree = i == 0 || neighbour == value;
+            value = neighbour;
+        }
+
+        if (agree)
+        {
+            context.Guess(x, y, 1, 1, value);
+            ++spent;
+            return value;
+        }
+
+        return context.Compute(x, y, spent);
+    }
+
+public:
+    const char *GetName() const override { return "guessing"; }
+
+    void Reset(uint16_t first) override
+    {
+        top = first;
+        row = top + top % 2;
+        secondPass = false;
+        done = false;
+    }
+
+    uint32_t Step(IRenderContext &context, uint32_t budget) override
+    {
+        const uint16_t width = context.GetWidth();
+        const uint16_t height = context.GetHeight();
+        uint32_t spent = 0;
+
+        while (!done && spent < budget)
+        {
+            if (row >= height)
+            {
+                if (secondPass)
+                {
+                    done = true;
+                    break;
+                }
+
+                secondPass = true;
+                row = top;
+                continue;
+            }
+
+            if (!secondPass)
+            {
+                for (uint16_t x = 0; x < width; x += 2)
+                {
+                    context.Compute(x, row, spent);
+                }
+
+                row += 2;
+                continue;
+            }
+
+            for (uint16_t x = 0; x < width; ++x)
+            {
+                if (x % 2 != 0 || row % 2 != 0)
+                {
+                    resolve(context, x, row, spent);
+                }
+            }
+
+            ++row;
+        }
+
+        return spent;
+    }
+
+    bool IsDone() const override { return done; }
+
+    uint16_t GetCompletedRows() const override { return done ? 0xFFFF : top; }
+};
+
+/** @brief Recursive rectangle subdivision (Mariani-Silver)
+ *
+ * The border of a rectangle is computed first. When it has a single
+ * iteration count the inside is filled with it, otherwise the rectangle is
+ * cut in four by a computed cross and each quarter is checked the same way.
+ * Rectangles below `MinSize` are computed pixel by pixel.
+ */
+class SubdivisionStrategy : public IRenderStrategy
+{
+private:
+    static constexpr uint16_t MinSize = 6;
+    static constexpr uint8_t StackSize = 64;
+
+    /** @brief Rectangle whose border is computed, bounds inclusive */
+    struct Rect
+    {
+        uint16_t left;
+        uint16_t top;
+        uint16_t right;
+        uint16_t bottom;
+    };
+
+    Rect stack[StackSize];
+    uint8_t depth = 0;
+    uint16_t top = 0;
+    bool started = false;
+    bool done = false;
+
+    /** @brief Whether every border pixel has the value of the top left corner */
+    static bool uniform(IRenderContext &context, const Rect &rect)
+    {
+        const uint16_t value = context.Get(rect.left, rect.top);
+
+        for (uint16_t x = rect.left; x <= rect.right; ++x)
+        {
+            if (context.Get(x, rect.top) != value || context.Get(x, rect.bottom) != value)
+            {
+                return false;
+            }
+        }
+
+        for (uint16_t y = rect.top; y <= rect.bottom; ++y)
+        {
+            if (context.Get(rect.left, y) != value || context.Get(rect.right, y) != value)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void computeRow(IRenderContext &context, uint16_t y, uint16_t left, uint16_t right, uint32_t &spent)
+    {
+        for (uint16_t x = left; x <= right; ++x)
+        {
+            context.Compute(x, y, spent);
+        }
+    }
+
+    void computeColumn(IRenderContext &context, uint16_t x, uint16_t topRow, uint16_t bottomRow, uint32_t &spent)
+    {
+        for (uint16_t y = topRow; y <= bottomRow; ++y)
+        {
+            context.Compute(x, y, spent);
+        }
+    }
+
+    /** @brief Handle one rectangle whose border is known */
+    void process(IRenderContext &context, const Rect &rect, uint32_t &spent)
+    {
+        if (rect.right - rect.left < 2 || rect.bottom - rect.top < 2)
+        {
+            return; // No inside
+        }
+
+        if (uniform(context, rect))
+        {
+            context.Guess(rect.left + 1, rect.top + 1, rect.right - rect.left - 1, rect.bottom - rect.top - 1, context.Get(rect.left, rect.top));
+            spent += rect.right - rect.left + rect.bottom - rect.top;
+            return;
+        }
+
+        if (rect.right - rect.left < MinSize || rect.bottom - rect.top < MinSize || depth + 4 > StackSize)
+        {
+            for (uint16_t y = rect.top + 1; y < rect.bottom; ++y)
+            {
+                computeRow(context, y, rect.left + 1, rect.right - 1, spent);
+            }
+
+            return;
+        }
+
+        const uint16_t midX = (rect.left + rect.right) / 2;
+        const uint16_t midY = (rect.top + rect.bottom) / 2;
+        computeRow(context, midY, rect.left + 1, rect.right - 1, spent);
+        computeColumn(context, midX, rect.top + 1, midY - 1, spent);
+        computeColumn(context, midX, midY + 1, rect.bottom - 1, spent);
+
+        // Bottom right first out of the stack last, so the screen fills from the top
+        stack[depth++] = Rect{midX, midY, rect.right, rect.bottom};
+        stack[depth++] = Rect{rect.left, midY, midX, rect.bottom};
+        stack[depth++] = Rect{midX, rect.top, rect.right, midY};
+        stack[depth++] = Rect{rect.left, rect.top, midX, midY};
+    }
+
+public:
+    const char *GetName() const override { return "subdivision"; }
+
+    void Reset(uint16_t first) override
+    {
+        top = first;
+        depth = 0;
+        started = false;
+        done = false;
+    }
+
+    uint32_t Step(IRenderContext &context, uint32_t budget) override
+    {
+        const uint16_t right = context.GetWidth() - 1;
+        const uint16_t bottom = context.GetHeight() - 1;
+        uint32_t spent = 0;
+
+        if (!started)
+        {
+            started = true;
+
+            if (top > bottom)
+            {
+                done = true;
+                return 0;
+            }
+
+            // Outer border of the region
+            computeRow(context, top, 0, right, spent);
+            computeRow(context, bottom, 0, right, spent);
+            computeColumn(context, 0, top, bottom, spent);
+            computeColumn(context, right, top, bottom, spent);
+            stack[depth++] = Rect{0, top, right, bottom};
+        }
+
+        while (depth > 0 && spent < budget)
+        {
+            const Rect rect = stack[--depth];
+            process(context, rect, spent);
+        }
+
+        done = depth == 0;
+        return spent;
+    }
+
+    bool IsDone() const override { return done; }
+
+    uint16_t GetCompletedRows() const override { return done ? 0xFFFF : top; }
+};
+
+/** @brief Square tiles in the order of a TileSchedule, each scanned line by line
+ * @tparam TileSize Tile width and height in pixels
+ * @tparam MaxTiles Tiles of the largest canvas
+ */
+template <uint16_t TileSize, size_t MaxTiles>
+class TileStrategy : public IRenderStrategy
+{
+private:
+    TileSchedule<TileSize, MaxTiles> schedule;
+    size_t position = 0; ///< Tile of the order being computed
+    uint16_t line = 0;   ///< Line inside the current tile
+    bool done = false;
+
+public:
+    const char *GetName() const override { return "tiles"; }
+
+    void Reset(uint16_t first) override
+    {
+        schedule.Reset(first);
+        position = 0;
+        line = 0;
+        done = false;
+    }
+
+    uint32_t Step(IRenderContext &context, uint32_t budget) override
+    {
+        uint32_t spent = 0;
+
+        if (!schedule.IsBuilt())
+        {
+            schedule.Build(context);
+            done = schedule.GetCount() == 0;
+        }
+
+        schedule.CountStep();
+
+        while (!done && spent < budget)
+        {
+            uint16_t x;
+            uint16_t y;
+            uint16_t width;
+            uint16_t height;
+            schedule.GetTile(position, x, y, width, height);
+
+            for (uint16_t column = x; column < x + width; ++column)
+            {
+                context.Compute(column, y + line, spent);
+            }
+
+            if (++line < height)
+            {
+                continue;
+            }
+
+            line = 0;
+            schedule.Finish(++position);
+            done = position >= schedule.GetCount();
+        }
+
+        return spent;
+    }
+
+    bool IsDone() const override { return done; }
+
+    uint16_t GetCompletedRows() const override { return done ? 0xFFFF : schedule.GetCompletedRows(); }
+
+    TileSchedule<TileSize, MaxTiles> &GetSchedule() { return schedule; }
+
+    const TileSchedule<TileSize, MaxTiles> &GetSchedule() const { return schedule; }
+};
+
+/** @brief Tiles computed by the slave SH2 and colorized by the master
+ *
+ * Tiles are queued in the order of a TileSchedule as long as the compute
+ * stage takes them, and the ones it finished are collected. The stage
+ * works through its queue in order, so the tiles collected are always the
+ * leading ones of the schedule. The step returns early when nothing
+ * finished, leaving the frame to the master while the slave works.
+ * @tparam TileSize Tile width and height in pixels
+ * @tparam MaxTiles Tiles of the largest canvas
+ */
+template <uint16_t TileSize, size_t MaxTiles>
+class PipelineStrategy : public IRenderStrategy
+{
+private:
+    TileSchedule<TileSize, MaxTiles> schedule;
+    size_t queued = 0; ///< Tiles of the order handed to the compute stage
+    bool done = false;
+
+public:
+    const char *GetName() const override { return "pipeline"; }
+
+    void Reset(uint16_t first) override
+    {
+        schedule.Reset(first);
+        queued = 0;
+        done = false;
+    }
+
+    uint32_t Step(IRenderContext &context, uint32_t budget) override
+    {
+        uint32_t spent = 0;
+
+        if (!schedule.IsBuilt())
+        {
+            schedule.Build(context);
+            done = schedule.GetCount() == 0;
+        }
+
+        schedule.CountStep();
+
+        while (!done && spent < budget)
+        {
+            while (queued < schedule.GetCount())
+            {
+                uint16_t x;
+                uint16_t y;
+                uint16_t width;
+                uint16_t height;
+                schedule.GetTile(queued, x, y, width, height);
+
+                if (!context.QueueTile(x, y, width, height))
+                {
+                    break;
+                }
+
+                ++queued;
+            }
+
+            const uint32_t work = context.CollectTiles();
+            spent += work;
+            schedule.Finish(queued - context.GetTilesInFlight());
+            done = queued >= schedule.GetCount() && context.GetTilesInFlight() == 0;
+
+            if (work == 0)
+            {
+                break; // Compute stage behind, come back next frame
+            }
+        }
+
+        return spent;
+    }
+
+    bool IsDone() const override { return done; }
+
+    uint16_t GetCompletedRows() const override { return done ? 0xFFFF : schedule.GetCompletedRows(); }
+
+    TileSchedule<TileSize, MaxTiles> &GetSchedule() { return schedule; }
+
+    const TileSchedule<TileSize, MaxTiles> &GetSchedule() const { return schedule; }
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+
+#include "scu_dsp_program.hpp"
+
+using namespace SRL::Logger;
+
+/** @brief SCU DSP as a third Mandelbrot worker
+ *
+ * Loads `ScuDsp::Program` into the DSP program RAM once and then runs it on
+ * batches of up to `ScuDsp::MaxBatch` pixels. The DSP data RAM is the
+ * mailbox: Submit() writes the c values and batch parameters and starts the
+ * program, Collect() waits for the end of the program and reads the
+ * iteration counts back from bank 0. Both SH2 keep running while the DSP
+ * works, so the caller polls IsBusy() between its own pixels.
+ *
+ * The DSP only iterates 16.16 values, so it is only useful with `Fxp`.
+ */
+class ScuDspWorker
+{
+private:
+    static constexpr uintptr_t ProgramControlAddress = 0x25FE0080; ///< PPAF
+    static constexpr uintptr_t ProgramDataAddress = 0x25FE0084;    ///< PPD
+    static constexpr uintptr_t DataAddressAddress = 0x25FE0088;    ///< PDA
+    static constexpr uintptr_t DataDataAddress = 0x25FE008C;       ///< PDD
+
+    static constexpr uint32_t LoadEnable = 0x8000; ///< PPAF: set the program counter
+    static constexpr uint32_t Execute = 0x10000;   ///< PPAF: start, reads back as running
+
+    uint32_t image[4][ScuDsp::BankSize];
+    uint8_t pending;   ///< Pixels of the batch in flight, 0 when idle
+    uint32_t batches;
+    uint32_t pixels;
+
+    static volatile uint32_t &reg(uintptr_t address)
+    {
+        return *reinterpret_cast<volatile uint32_t *>(address);
+    }
+
+    /** @brief Point the data RAM port at a bank word, auto-incremented on access */
+    static void selectData(uint8_t bank, uint8_t word)
+    {
+        reg(DataAddressAddress) = (static_cast<uint32_t>(bank) << 6) | word;
+    }
+
+    /** @brief Write consecutive words of one bank */
+    void upload(uint8_t bank, uint8_t first, uint8_t count) const
+    {
+        selectData(bank, first);
+
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            reg(DataDataAddress) = image[bank][first + i];
+        }
+    }
+
+public:
+    /** @brief Stop the DSP and load the Mandelbrot program */
+    ScuDspWorker() : image(), pending(0), batches(0), pixels(0)
+    {
+        reg(ProgramControlAddress) = 0;
+        reg(ProgramControlAddress) = LoadEnable;
+
+        for (size_t i = 0; i < ScuDsp::Program.size; ++i)
+        {
+            reg(ProgramDataAddress) = ScuDsp::Program.code[i];
+        }
+
+        Log::LogPrint<LogLevels::INFO>("dsp: %d program words loaded", static_cast<int32_t>(ScuDsp::Program.size));
+    }
+
+    ScuDspWorker(const ScuDspWorker &) = delete;
+    ScuDspWorker &operator=(const ScuDspWorker &) = delete;
+
+    /** @brief Whether the program is still running */
+    bool IsBusy() const
+    {
+        return (reg(ProgramControlAddress) & Execute) != 0;
+    }
+
+    /** @brief Start a batch
+     * @param cReal Raw 16.16 real parts, one per pixel
+     * @param cImag Raw 16.16 imaginary parts, one per pixel
+     * @param count Number of pixels, 1..ScuDsp::MaxBatch
+     * @param maxIterations Iteration cap
+     * @return false when a batch is still pending or count is out of range
+     */
+    bool Submit(const int32_t *cReal, const int32_t *cImag, uint8_t count, uint16_t maxIterations)
+    {
+        if (pending != 0 || count == 0 || count > ScuDsp::MaxBatch)
+        {
+            return false;
+        }
+
+        ScuDsp::PrepareBatch(cReal, cImag, count, maxIterations, image);
+        upload(0, 0, count);
+        upload(1, 0, count);
+        upload(2, ScuDsp::Slot::Limit, ScuDsp::Slot::Remaining - ScuDsp::Slot::Limit + 1);
+        upload(3, 0, 1);
+
+        reg(ProgramControlAddress) = LoadEnable;
+        reg(ProgramControlAddress) = Execute;
+        pending = count;
+        return true;
+    }
+
+    /** @brief Wait for the pending batch and read its iteration counts
+     * @param out Receives one count per submitted pixel
+     * @return Number of counts written, 0 when nothing was pending
+     */
+    uint8_t Collect(uint16_t *out)
+    {
+        const uint8_t count = pending;
+
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        while (IsBusy())
+        {
+        }
+
+        selectData(0, 0);
+
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            out[i] = static_cast<uint16_t>(reg(DataDataAddress));
+        }
+
+        pending = 0;
+        ++batches;
+        pixels += count;
+        return count;
+    }
+
+    /** @brief Batches completed since construction */
+    uint32_t GetBatchCount() const { return batches; }
+
+    /** @brief Pixels computed by the DSP since construction */
+    uint32_t GetPixelCount() const { return pixels; }
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief SCU DSP Mandelbrot microprogram
+ *
+ * Iterates a batch of 16.16 fixed-point pixels with the DSP multiplier and
+ * data RAM. The program is assembled at compile time from the helpers below
+ * so the Saturn loader (`ScuDspWorker`) and the host simulator
+ * (`tools/dspsim.cxx`) share the very same words.
+ *
+ * Data RAM layout (4 banks of 64 32-bit words):
+ * - bank 0: real part of c for each pixel in, iteration count out
+ * - bank 1: imaginary part of c for each pixel
+ * - bank 2: per-pixel work variables and batch parameters (see Slot)
+ * - bank 3: word 0 holds 65536, CT3 never moves
+ *
+ * The program only uses timing-safe patterns: ALL/ALH are read in
+ * instructions without an ALU operation, MOV ALU,A is paired with its ALU
+ * operation, a bank is never read by two buses in one instruction and every
+ * jump is followed by a NOP, so it does not depend on delay slot behaviour.
+ * It does rely on reads using the CTn value from before a D1 write to CTn
+ * in the same instruction, and on MUL reflecting RX/RY written by the
+ * previous instruction.
+ */
+namespace ScuDsp
+{
+    static constexpr size_t ProgramSize = 256; ///< Program RAM words
+    static constexpr size_t BankSize = 64;     ///< Data RAM words per bank
+    static constexpr size_t MaxBatch = 64;     ///< Pixels per batch
+
+    /** @brief Bank 2 word assignment */
+    namespace Slot
+    {
+        static constexpr uint8_t ZReal = 0;
+        static constexpr uint8_t ZImag = 1;
+        static constexpr uint8_t ZReal2 = 2;   ///< zReal * zReal
+        static constexpr uint8_t ZImag2 = 3;   ///< zImag * zImag
+        static constexpr uint8_t Iteration = 4;
+        static constexpr uint8_t Cross = 5;    ///< (2 * zReal) * zImag
+        static constexpr uint8_t Limit = 8;    ///< 4.0 + 1 LSB, escape when |z|^2 reaches it
+        static constexpr uint8_t MaxIterations = 9;
+        static constexpr uint8_t Remaining = 10; ///< Pixels left in the batch
+    }
+
+    /** @brief ALU operations */
+    enum Alu : uint32_t
+    {
+        NOP = 0x0,
+        AND = 0x1,
+        OR = 0x2,
+        XOR = 0x3,
+        ADD = 0x4,
+        SUB = 0x5,
+        AD2 = 0x6,
+        SR = 0x8,
+        RR = 0x9,
+        SL = 0xA,
+        RL = 0xB,
+        RL8 = 0xF
+    };
+
+    /** @brief Data RAM read sources of the X, Y and D1 buses */
+    enum Src : uint32_t
+    {
+        M0 = 0,
+        M1,
+        M2,
+        M3,
+        MC0, ///< Read and increment CT0
+        MC1,
+        MC2,
+        MC3,
+        ALL = 9, ///< D1 bus only: ALU bits 31..0
+        ALH = 10 ///< D1 bus only: ALU bits 47..32
+    };
+
+    /** @brief D1 bus and MVI destinations */
+    enum Dst : uint32_t
+    {
+        DMC0 = 0x0, ///< Write and increment CT0
+        DMC1 = 0x1,
+        DMC2 = 0x2,
+        DMC3 = 0x3,
+        RX = 0x4,
+        PL = 0x5,
+        RA0 = 0x6,
+        WA0 = 0x7,
+        LOP = 0xA,
+        TOP = 0xB,
+        CT0 = 0xC,
+        CT1 = 0xD,
+        CT2 = 0xE,
+        CT3 = 0xF
+    };
+
+    /** @brief Jump conditions: bit 6 conditional, bit 5 polarity, bits 3..0 T0/C/S/Z */
+    enum Cond : uint32_t
+    {
+        Always = 0x00,
+        NZ = 0x41,
+        NS = 0x42,
+        NZS = 0x43,
+        Z = 0x61,
+        S = 0x62,
+        ZS = 0x63
+    };
+
+    // Operation command fields
+    constexpr uint32_t Op(Alu alu) { return static_cast<uint32_t>(alu) << 26; }
+    constexpr uint32_t MovX(Src s) { return (0x4u << 23) | (static_cast<uint32_t>(s) << 20); }
+    constexpr uint32_t MovMulP() { return 0x2u << 23; }
+    constexpr uint32_t MovP(Src s) { return (0x3u << 23) | (static_cast<uint32_t>(s) << 20); }
+    constexpr uint32_t MovY(Src s) { return (0x4u << 17) | (static_cast<uint32_t>(s) << 14); }
+    constexpr uint32_t ClrA() { return 0x1u << 17; }
+    constexpr uint32_t MovAluA() { return 0x2u << 17; }
+    constexpr uint32_t MovA(Src s) { return (0x3u << 17) | (static_cast<uint32_t>(s) << 14); }
+    constexpr uint32_t MovImm(int8_t imm, Dst d) { return (0x1u << 12) | (static_cast<uint32_t>(d) << 8) | static_cast<uint8_t>(imm); }
+    constexpr uint32_t Mov(Src s, Dst d) { return (0x3u << 12) | (static_cast<uint32_t>(d) << 8) | static_cast<uint32_t>(s); }
+
+    // Other commands
+    constexpr uint32_t Mvi(int32_t imm, Dst d) { return (0x2u << 30) | (static_cast<uint32_t>(d) << 26) | (static_cast<uint32_t>(imm) & 0x1FFFFFF); }
+    constexpr uint32_t Jmp(Cond cond, uint8_t target) { return (0xDu << 28) | (static_cast<uint32_t>(cond) << 19) | target; }
+    static constexpr uint32_t End = 0xF0000000;
+
+    /** @brief Two-pass compile-time assembler
+     *
+     * The first pass records label addresses, the second one resolves the
+     * forward jumps against them.
+     */
+    struct Assembler
+    {
+        enum Label : uint8_t
+        {
+            Pixel,
+            Loop,
+            Done,
+            LabelCount
+        };
+
+        uint32_t code[ProgramSize] = {};
+        size_t size = 0;
+        uint8_t labels[LabelCount] = {};
+
+        constexpr void Emit(uint32_t word) { code[size++] = word; }
+        constexpr void Mark(Label label) { labels[label] = static_cast<uint8_t>(size); }
+        constexpr void Jump(Cond cond, Label label)
+        {
+            Emit(Jmp(cond, labels[label]));
+            Emit(Op(NOP));
+        }
+
+        /** @brief 16.16 multiply of RX by RY into ACL/ALL
+         *
+         * The 48-bit product is split: ALH is shifted up by multiplying it by
+         * 65536 (bank 3 word 0), the upper half of ALL is brought down with
+         * two 8-bit rotations and a mask. Result is product bits 47..16, the
+         * same truncation as the SH2 Fxp multiply.
+         * @param d1 D1 bus command issued during the multiply (bank 0-2 only)
+         */
+        constexpr void Multiply(uint32_t d1 = 0)
+        {
+            Emit(Op(NOP) | MovMulP() | ClrA() | d1);
+            Emit(Op(AD2) | MovAluA());
+            Emit(Op(NOP) | MovY(M3) | Mov(ALH, RX));
+            Emit(Op(RL8) | MovAluA());
+            Emit(Op(RL8) | MovAluA());
+            Emit(Mvi(0xFFFF, PL));
+            Emit(Op(AND) | MovMulP() | MovAluA());
+            Emit(Op(ADD) | MovAluA());
+        }
+
+        /** @brief Square a bank value into ALL, leaving CT2 at `store` */
+        constexpr void Square(Src s, uint8_t store)
+        {
+            Emit(Op(NOP) | MovX(s));
+            Emit(Op(NOP) | MovY(s));
+            Multiply(MovImm(static_cast<int8_t>(store), CT2));
+        }
+
+        /** @brief Point CT2 at a bank 2 word */
+        constexpr void Select(uint8_t slot)
+        {
+            Emit(Op(NOP) | MovImm(static_cast<int8_t>(slot), CT2));
+        }
+    };
+
+    /** @brief Assemble the program
+     * @param labels Label addresses from a previous pass
+     */
+    constexpr Assembler Assemble(const uint8_t (&labels)[Assembler::LabelCount])
+    {
+        Assembler a;
+
+        for (size_t i = 0; i < Assembler::LabelCount; ++i)
+        {
+            a.labels[i] = labels[i];
+        }
+
+        // Batch setup
+        a.Emit(Op(NOP) | MovImm(0, CT0));
+        a.Emit(Op(NOP) | MovImm(0, CT1));
+        a.Emit(Op(NOP) | MovImm(0, CT3));
+
+        // Per pixel: z = c, squares of z, iteration = 0
+        a.Mark(Assembler::Pixel);
+        a.Select(Slot::ZReal);
+        a.Emit(Op(NOP) | Mov(M0, DMC2));
+        a.Emit(Op(NOP) | Mov(M1, DMC2));
+        a.Square(M0, Slot::ZReal2);
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+        a.Square(M1, Slot::ZImag2);
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+        a.Emit(Op(NOP) | MovImm(0, DMC2));
+
+        a.Mark(Assembler::Loop);
+
+        // Stop at the iteration cap: iteration - max >= 0
+        a.Select(Slot::Iteration);
+        a.Emit(Op(NOP) | MovA(M2) | MovImm(Slot::MaxIterations, CT2));
+        a.Emit(Op(NOP) | MovP(M2));
+        a.Emit(Op(SUB));
+        a.Jump(NS, Assembler::Done);
+
+        // Cross term (2 * zReal) * zImag, doubled first like the Fxp kernel
+        a.Select(Slot::ZReal);
+        a.Emit(Op(NOP) | MovP(M2));
+        a.Emit(Op(NOP) | MovA(M2) | MovImm(Slot::ZImag, CT2));
+        a.Emit(Op(ADD) | MovAluA());
+        a.Emit(Op(NOP) | MovY(M2) | Mov(ALL, RX));
+        a.Multiply(MovImm(Slot::Cross, CT2));
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+
+        // zReal = zReal2 - zImag2 + cReal
+        a.Select(Slot::ZReal2);
+        a.Emit(Op(NOP) | MovA(M2) | MovImm(Slot::ZImag2, CT2));
+        a.Emit(Op(NOP) | MovP(M2));
+        a.Emit(Op(SUB) | MovP(M0) | MovAluA());
+        a.Emit(Op(ADD) | MovAluA() | MovImm(Slot::ZReal, CT2));
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+
+        // zImag = cross + cImag
+        a.Select(Slot::Cross);
+        a.Emit(Op(NOP) | MovP(M1) | MovA(M2));
+        a.Emit(Op(ADD) | MovAluA() | MovImm(Slot::ZImag, CT2));
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+
+        // Squares of the new z, kept for the next iteration
+        a.Select(Slot::ZReal);
+        a.Square(M2, Slot::ZReal2);
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+        a.Select(Slot::ZImag);
+        a.Square(M2, Slot::ZImag2);
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+
+        // Escape when zReal2 + zImag2 > 4.0, that is sum - (4.0 + 1 LSB) >= 0
+        a.Select(Slot::ZReal2);
+        a.Emit(Op(NOP) | MovP(M2));
+        a.Emit(Op(ADD) | MovAluA() | MovImm(Slot::Limit, CT2));
+        a.Emit(Op(NOP) | MovP(M2));
+        a.Emit(Op(SUB));
+        a.Jump(NS, Assembler::Done);
+
+        // ++iteration
+        a.Select(Slot::Iteration);
+        a.Emit(Op(NOP) | MovA(M2));
+        a.Emit(Mvi(1, PL));
+        a.Emit(Op(ADD) | MovAluA());
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+        a.Jump(Always, Assembler::Loop);
+
+        // Store the count over cReal, advance to the next pixel
+        a.Mark(Assembler::Done);
+        a.Select(Slot::Iteration);
+        a.Emit(Op(NOP) | Mov(M2, DMC0));
+        a.Emit(Op(NOP) | MovP(MC1));
+        a.Select(Slot::Remaining);
+        a.Emit(Op(NOP) | MovA(M2));
+        a.Emit(Mvi(1, PL));
+        a.Emit(Op(SUB) | MovAluA());
+        a.Emit(Op(NOP) | Mov(ALL, DMC2));
+        a.Jump(NZ, Assembler::Pixel);
+        a.Emit(End);
+
+        return a;
+    }
+
+    /** @brief Fill a data RAM image for one batch
+     *
+     * Only the words the program reads are written.
+     * @param cReal Raw 16.16 real parts, one per pixel
+     * @param cImag Raw 16.16 imaginary parts, one per pixel
+     * @param count Number of pixels, 1..MaxBatch
+     * @param maxIterations Iteration cap
+     * @param ram Data RAM image, indexed [bank][word]
+     */
+    inline void PrepareBatch(const int32_t *cReal, const int32_t *cImag, size_t count, uint16_t maxIterations, uint32_t (&ram)[4][BankSize])
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            ram[0][i] = static_cast<uint32_t>(cReal[i]);
+            ram[1][i] = static_cast<uint32_t>(cImag[i]);
+        }
+
+        ram[2][Slot::Limit] = 0x40001;
+        ram[2][Slot::MaxIterations] = maxIterations;
+        ram[2][Slot::Remaining] = static_cast<uint32_t>(count);
+        ram[3][0] = 0x10000;
+    }
+
+    static constexpr uint8_t NoLabels[Assembler::LabelCount] = {};
+    static constexpr Assembler Layout = Assemble(NoLabels);
+    static constexpr Assembler Program = Assemble(Layout.labels);
+
+    static_assert(Program.size <= ProgramSize, "DSP program does not fit program RAM");
+}
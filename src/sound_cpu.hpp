@@ -0,0 +1,194 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+
+#include "m68k_program.hpp"
+
+using namespace SRL::Logger;
+
+/** @brief Sound CPU (MC68EC000) as a fourth Mandelbrot worker
+ *
+ * Without the SGL sound driver the 68000 and its sound RAM sit idle. Start()
+ * holds the 68000 in reset through the SMPC, copies `SoundCpu::Program` and
+ * its reset vectors into sound RAM and releases it; the program then waits
+ * on the mailbox for batches of up to `SoundCpu::MaxBatch` pixels.
+ *
+ * The 68000 iterates about a hundred times slower than an SH2, so a batch
+ * is not waited for: Collect() cancels whatever is left of it, which the
+ * program notices within one iteration, and returns how many counts were
+ * stored so the caller computes the rest itself.
+ *
+ * Sound RAM is on a 16-bit bus, it is only accessed with 16-bit words.
+ * Like the SCU DSP, the program only iterates 16.16 values.
+ */
+class SoundCpuWorker
+{
+private:
+    static constexpr uintptr_t SoundRamAddress = 0x25A00000; ///< 68000 address 0, cache-through
+    static constexpr uintptr_t CommandAddress = 0x2010001F;  ///< SMPC COMREG
+    static constexpr uintptr_t StatusFlagAddress = 0x20100063; ///< SMPC SF
+
+    static constexpr uint8_t SoundOn = 0x06;  ///< SMPC SNDON: release the 68000 from reset
+    static constexpr uint8_t SoundOff = 0x07; ///< SMPC SNDOFF: hold it in reset
+
+    uint8_t pending;   ///< Pixels of the batch in flight, 0 when idle
+    bool started;
+    uint32_t batches;
+    uint32_t pixels;
+    uint32_t cancelled; ///< Batches cut short by Collect()
+
+    static volatile uint16_t &word(uint32_t address)
+    {
+        return *reinterpret_cast<volatile uint16_t *>(SoundRamAddress + address);
+    }
+
+    static volatile uint16_t &slot(uint16_t index)
+    {
+        return word(SoundCpu::MailboxAddress + 2 * index);
+    }
+
+    /** @brief Issue an SMPC command and wait for it to complete */
+    static void smpc(uint8_t command)
+    {
+        volatile uint8_t &status = *reinterpret_cast<volatile uint8_t *>(StatusFlagAddress);
+
+        while ((status & 1) != 0)
+        {
+        }
+
+        status = 1;
+        *reinterpret_cast<volatile uint8_t *>(CommandAddress) = command;
+
+        while ((status & 1) != 0)
+        {
+        }
+    }
+
+public:
+    SoundCpuWorker() : pending(0), started(false), batches(0), pixels(0), cancelled(0)
+    {
+    }
+
+    SoundCpuWorker(const SoundCpuWorker &) = delete;
+    SoundCpuWorker &operator=(const SoundCpuWorker &) = delete;
+
+    /** @brief Load the program and start the 68000
+     *
+     * Only valid while no sound driver owns the 68000 (`SRL_USE_SGL_SOUND_DRIVER = 0`).
+     */
+    void Start()
+    {
+        smpc(SoundOff);
+
+        const uint32_t vectors[2] = {SoundCpu::StackTop, SoundCpu::ProgramAddress};
+
+        for (uint8_t i = 0; i < 2; ++i)
+        {
+            word(4 * i) = static_cast<uint16_t>(vectors[i] >> 16);
+            word(4 * i + 2) = static_cast<uint16_t>(vectors[i]);
+        }
+
+        for (size_t i = 0; i < SoundCpu::Program.size; ++i)
+        {
+            word(SoundCpu::ProgramAddress + 2 * i) = SoundCpu::Program.code[i];
+        }
+
+        for (uint16_t i = 0; i < SoundCpu::Slot::Results; ++i)
+        {
+            slot(i) = 0;
+        }
+
+        smpc(SoundOn);
+        started = true;
+        Log::LogPrint<LogLevels::INFO>("sound: %d program words loaded", static_cast<int32_t>(SoundCpu::Program.size));
+    }
+
+    /** @brief Whether Start() was called */
+    bool IsStarted() const { return started; }
+
+    /** @brief Whether the batch in flight still has pixels to go */
+    bool IsBusy() const
+    {
+        return slot(SoundCpu::Slot::Command) != 0;
+    }
+
+    /** @brief Start a batch
+     * @param cReal Raw 16.16 real parts, one per pixel
+     * @param cImag Raw 16.16 imaginary parts, one per pixel
+     * @param count Number of pixels, 1..SoundCpu::MaxBatch
+     * @param maxIterations Iteration cap
+     * @return false when not started, a batch is still pending or count is out of range
+     */
+    bool Submit(const int32_t *cReal, const int32_t *cImag, uint8_t count, uint16_t maxIterations)
+    {
+        if (!started || pending != 0 || count == 0 || count > SoundCpu::MaxBatch)
+        {
+            return false;
+        }
+
+        uint16_t mailbox[SoundCpu::Slot::Words];
+        SoundCpu::PrepareBatch(cReal, cImag, count, maxIterations, mailbox);
+
+        for (uint16_t i = 0; i < 2 * count; ++i)
+        {
+            slot(SoundCpu::Slot::CReal + i) = mailbox[SoundCpu::Slot::CReal + i];
+            slot(SoundCpu::Slot::CImag + i) = mailbox[SoundCpu::Slot::CImag + i];
+        }
+
+        for (uint16_t i = SoundCpu::Slot::Cancel; i <= SoundCpu::Slot::Done; ++i)
+        {
+            slot(i) = mailbox[i];
+        }
+
+        slot(SoundCpu::Slot::Command) = 1;
+        pending = count;
+        return true;
+    }
+
+    /** @brief End the pending batch and read the counts it stored
+     * @param out Receives the counts of the first pixels of the batch
+     * @return Number of counts written, the caller computes the pixels after them
+     */
+    uint8_t Collect(uint16_t *out)
+    {
+        if (pending == 0)
+        {
+            return 0;
+        }
+
+        if (IsBusy())
+        {
+            slot(SoundCpu::Slot::Cancel) = 1;
+
+            while (IsBusy())
+            {
+            }
+        }
+
+        const uint8_t done = static_cast<uint8_t>(slot(SoundCpu::Slot::Done));
+
+        for (uint8_t i = 0; i < done; ++i)
+        {
+            out[i] = slot(SoundCpu::Slot::Results + i);
+        }
+
+        cancelled += done < pending ? 1 : 0;
+        pending = 0;
+        ++batches;
+        pixels += done;
+        return done;
+    }
+
+    /** @brief Batches collected since Start() */
+    uint32_t GetBatchCount() const { return batches; }
+
+    /** @brief Batches the 68000 did not finish */
+    uint32_t GetCancelledCount() const { return cancelled; }
+
+    /** @brief Pixels computed by the 68000 since Start() */
+    uint32_t GetPixelCount() const { return pixels; }
+};
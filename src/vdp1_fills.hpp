@@ -0,0 +1,102 @@
+#pragma once
+
+#include <srl.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace SRL::Math::Types;
+
+/** @brief Uniform canvas rectangles shown as VDP1 flat-color polygons
+ *
+ * A rectangle a strategy proved uniform costs one polygon command per
+ * frame instead of CPU writes into the canvas and a DMA of its rows. The
+ * canvas under a fill is left stale and the polygon covers it, so whoever
+ * needs the real pixels (the caches, a restarted strategy) has the fills
+ * written into the canvas first, see ForEach().
+ *
+ * Polygons take an RGB color, looked up from the palette when drawn so they
+ * follow the equalized mapping and the palette rotation like the canvas.
+ * @tparam MaxFills Fills kept, a full layer takes no more
+ */
+template <size_t MaxFills>
+class Vdp1FillLayer
+{
+public:
+    /** @brief Canvas rectangle of a single iteration count */
+    struct Fill
+    {
+        uint16_t x;
+        uint16_t y;
+        uint16_t width;
+        uint16_t height;
+        uint16_t iteration;
+    };
+
+private:
+    Fill fills[MaxFills > 0 ? MaxFills : 1];
+    size_t count;
+    uint16_t canvasWidth;
+    uint16_t canvasHeight;
+
+public:
+    /** @param width Canvas width, drawn centered on the screen like the canvas sprites
+     * @param height Canvas height
+     */
+    Vdp1FillLayer(uint16_t width, uint16_t height) : fills(), count(0), canvasWidth(width), canvasHeight(height)
+    {
+    }
+
+    /** @brief Whether no fill can be added */
+    bool IsFull() const { return count >= MaxFills; }
+
+    /** @brief Add a rectangle
+     * @return false when the layer is full
+     */
+    bool Add(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t iteration)
+    {
+        if (IsFull())
+        {
+            return false;
+        }
+
+        fills[count++] = Fill{x, y, width, height, iteration};
+        return true;
+    }
+
+    /** @brief Drop every fill */
+    void Clear() { count = 0; }
+
+    size_t GetCount() const { return count; }
+
+    /** @brief Visit every fill, to write them into the canvas before a Clear() */
+    template <typename Visit>
+    void ForEach(Visit &&visit) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            visit(fills[i]);
+        }
+    }
+
+    /** @brief Submit one polygon per fill, in front of the canvas sprites
+     * @param colorOf Screen color of an iteration count
+     */
+    template <typename ColorOf>
+    void Draw(ColorOf &&colorOf) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Fill &fill = fills[i];
+
+            // Screen origin at its center, polygon corners are inclusive
+            const int16_t left = fill.x - canvasWidth / 2;
+            const int16_t top = fill.y - canvasHeight / 2;
+            const int16_t right = left + fill.width - 1;
+            const int16_t bottom = top + fill.height - 1;
+            const Vector2D points[4] = {Vector2D(left, top), Vector2D(right, top), Vector2D(right, bottom), Vector2D(left, bottom)};
+
+            SRL::Scene2D::DrawPolygon(points, true, colorOf(fill.iteration), 490.0);
+        }
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace SRL::Logger;
+using namespace SRL::Math::Types;
+
+/** @brief Canvas shown as a grid of VDP1 sprites
+ *
+ * A VDP1 texture is at most 504 pixels wide (a multiple of 8) and 255
+ * lines high, so a canvas larger than that, such as 704x480 in high
+ * resolution mode, is split into equal tiles, each with its own texture and
+ * sprite. All tiles share one CRAM palette. A canvas that fits a single
+ * texture gets exactly one tile, drawn like the original full screen sprite.
+ * Tile sets can also be drawn enlarged, which is how the low resolution
+ * preview covers the screen.
+ */
+class Vdp1TileSet
+{
+public:
+    static constexpr uint16_t MaxTileWidth = 504;
+    static constexpr uint16_t MaxTileHeight = 255;
+    static constexpr uint8_t MaxTiles = 16;
+
+private:
+    /** @brief Blank bitmap used to allocate one tile texture */
+    class TileBitmap : public SRL::Bitmap::IBitmap
+    {
+    private:
+        uint8_t *data;
+        SRL::Bitmap::BitmapInfo info;
+
+    public:
+        TileBitmap(uint8_t *data, uint16_t width, uint16_t height, SRL::Bitmap::Palette *palette)
+            : data(data), info(width, height, palette)
+        {
+        }
+
+        uint8_t *GetData() override { return data; }
+        SRL::Bitmap::BitmapInfo GetInfo() const override { return info; }
+    };
+
+    uint16_t width;
+    uint16_t height;
+    uint16_t tileWidth;
+    uint16_t tileHeight;
+    uint8_t columns;
+    uint8_t rows;
+    int32_t textures[MaxTiles];
+    int32_t paletteId;
+
+public:
+    /** @brief Split a canvas into tiles and allocate their textures
+     * @param width Canvas width in pixels
+     * @param height Canvas height in pixels
+     * @param palette Palette of the canvas
+     * @param loadPalette Loads the palette into CRAM, called for the first tile only
+     * @param sharedPaletteId CRAM bank already holding the palette, -1 to load it
+     */
+    Vdp1TileSet(uint16_t width,
+                uint16_t height,
+                SRL::Bitmap::Palette *palette,
+                int16_t (*loadPalette)(SRL::Bitmap::BitmapInfo *),
+                int32_t sharedPaletteId = -1)
+        : width(width),
+          height(height),
+          tileWidth(0),
+          tileHeight(0),
+          columns((width + MaxTileWidth - 1) / MaxTileWidth),
+          rows((height + MaxTileHeight - 1) / MaxTileHeight),
+          textures(),
+          paletteId(sharedPaletteId)
+    {
+        tileWidth = ((width + columns - 1) / columns + 7) & ~7;
+        tileHeight = (height + rows - 1) / rows;
+
+        if (columns * rows > MaxTiles)
+        {
+            Log::LogPrint<LogLevels::FATAL>("vdp1: %dx%d needs too many tiles", width, height);
+            columns = 0;
+            rows = 0;
+            return;
+        }
+
+        uint8_t *blank = new uint8_t[tileWidth * tileHeight];
+        memset(blank, 0, tileWidth * tileHeight);
+
+        for (uint8_t i = 0; i < columns * rows; ++i)
+        {
+            TileBitmap bitmap(blank, tileWidth, tileHeight, palette);
+            textures[i] = SRL::VDP1::TryLoadTexture(&bitmap, paletteId < 0 ? loadPalette : nullptr);
+
+            if (textures[i] < 0)
+            {
+                Log::LogPrint<LogLevels::FATAL>("vdp1: tile %d not loaded", i);
+                continue;
+            }
+
+            if (paletteId < 0)
+            {
+                paletteId = SRL::VDP1::Metadata[textures[i]].PaletteId;
+            }
+            else
+            {
+                SRL::VDP1::Metadata[textures[i]].PaletteId = paletteId;
+            }
+        }
+
+        delete[] blank;
+
+        Log::LogPrint<LogLevels::INFO>("vdp1: %dx%d canvas in %d tiles of %dx%d",
+                                       width, height, columns * rows, tileWidth, tileHeight);
+    }
+
+    Vdp1TileSet(const Vdp1TileSet &) = delete;
+    Vdp1TileSet &operator=(const Vdp1TileSet &) = delete;
+
+    /** @brief CRAM bank shared by all tiles, -1 when loading failed */
+    int32_t GetPaletteId() const { return paletteId; }
+
+    /** @brief Copy canvas rows into the tile textures via DMA
+     *
+     * With a single column the texture has the canvas layout and the rows
+     * of each tile go in one transfer, otherwise every tile line is a
+     * transfer of its own.
+     * @param pixels Canvas of `width` bytes per row
+     * @param first First row to copy
+     * @param count Number of rows
+     */
+    void Upload(const uint8_t *pixels, uint16_t first, uint16_t count) const
+    {
+        const uint16_t last = first + count < height ? first + count : height;
+
+        for (uint8_t row = 0; row < rows; ++row)
+        {
+            const uint16_t top = row * tileHeight;
+            const uint16_t begin = first > top ? first : top;
+            const uint16_t end = last < top + tileHeight ? last : top + tileHeight;
+
+            for (uint8_t column = 0; column < columns && begin < end; ++column)
+            {
+                const int32_t texture = textures[row * columns + column];
+                const uint16_t left = column * tileWidth;
+                const uint16_t span = width - left < tileWidth ? width - left : tileWidth;
+
+                if (texture < 0)
+                {
+                    continue;
+                }
+
+                uint8_t *destination = SRL::VDP1::Textures[texture].GetData();
+
+                if (columns == 1 && span == tileWidth)
+                {
+                    slDMACopy(const_cast<uint8_t *>(pixels + begin * width),
+                              destination + (begin - top) * tileWidth,
+                              (end - begin) * tileWidth);
+                    slDMAWait();
+                    continue;
+                }
+
+                for (uint16_t y = begin; y < end; ++y)
+                {
+                    slDMACopy(const_cast<uint8_t *>(pixels + y * width + left),
+                              destination + (y - top) * tileWidth,
+                              span);
+                    slDMAWait();
+                }
+            }
+        }
+
+        Log::LogPrint<LogLevels::TESTING>("copyToVDP1");
+    }
+
+    /** @brief Draw every tile as a sprite at its place on screen
+     * @param scale Enlargement factor, the tile set then covers width * scale pixels
+     */
+    void Draw(uint8_t scale = 1) const
+    {
+        for (uint8_t row = 0; row < rows; ++row)
+        {
+            for (uint8_t column = 0; column < columns; ++column)
+            {
+                const int32_t texture = textures[row * columns + column];
+
+                if (texture < 0)
+                {
+                    continue;
+                }
+
+                // Sprites are positioned by their center, the screen origin is its center
+                const int16_t x = (column * tileWidth * 2 + tileWidth - width) * scale / 2;
+                const int16_t y = (row * tileHeight * 2 + tileHeight - height) * scale / 2;
+
+                if (scale == 1)
+                {
+                    SRL::Scene2D::DrawSprite(texture, Vector3D(x, y, 500.0));
+                }
+                else
+                {
+                    SRL::Scene2D::DrawSprite(texture, Vector3D(x, y, 500.0), Vector2D(scale, scale));
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace SRL::Logger;
+
+/** @brief Which hardware shows the canvas */
+enum class OutputBackend : uint8_t
+{
+    Vdp1Sprite, ///< Canvas uploaded to a VDP1 texture and drawn as a sprite every frame
+    Vdp2Bitmap  ///< Canvas uploaded to a VDP2 bitmap screen that persists on its own
+};
+
+/** @brief 8bpp VDP2 bitmap screen on NBG1
+ *
+ * The bitmap sits at the start of VRAM A0 with a 512 byte pitch and uses a
+ * 256 color CRAM bank as its palette. Once a row is written it stays on
+ * screen with no per-frame work, so VDP1 is left free for overlays and
+ * previews, which are drawn above the bitmap. NBG0 stays enabled for the
+ * SGL text layer.
+ */
+class Vdp2BitmapLayer
+{
+private:
+    static constexpr uintptr_t VramAddress = 0x25E00000; ///< VRAM A0, cache-through
+    static constexpr uint16_t Pitch = 512;                ///< Bytes per bitmap line
+    static constexpr uint16_t Lines = 256;
+    static constexpr uint16_t Priority = 2;               ///< Below the default sprite priority
+
+    uint16_t width;
+    uint16_t height;
+
+    static uint8_t *line(uint16_t y)
+    {
+        return reinterpret_cast<uint8_t *>(VramAddress) + y * Pitch;
+    }
+
+public:
+    /** @brief Set up and clear the bitmap screen
+     * @param width Visible width in pixels, up to 512
+     * @param height Visible height in pixels, up to 256
+     * @param paletteId 256 color CRAM bank holding the palette
+     */
+    Vdp2BitmapLayer(uint16_t width, uint16_t height, int32_t paletteId) : width(width), height(height)
+    {
+        if (!Fits(width, height))
+        {
+            Log::LogPrint<LogLevels::FATAL>("vdp2: %dx%d does not fit the 512x256 bitmap", width, height);
+        }
+
+        for (uint16_t y = 0; y < Lines; ++y)
+        {
+            memset(line(y), 0, Pitch);
+        }
+
+        slBitMapNbg1(COL_TYPE_256, BM_512x256, reinterpret_cast<void *>(VramAddress));
+        slBMPaletteNbg1(static_cast<Uint16>(paletteId));
+        slScrPosNbg1(0, 0);
+        slPriorityNbg1(Priority);
+        slScrAutoDisp(NBG0ON | NBG1ON);
+
+        Log::LogPrint<LogLevels::INFO>("vdp2: NBG1 bitmap %dx%d, palette %d", width, height, paletteId);
+    }
+
+    /** @brief Whether an image fits the bitmap
+     *
+     * High resolution canvases do not: a 1024 pixel pitch at 8bpp would take
+     * the whole of VDP2 VRAM.
+     */
+    static constexpr bool Fits(uint16_t width, uint16_t height)
+    {
+        return width <= Pitch && height <= Lines;
+    }
+
+    Vdp2BitmapLayer(const Vdp2BitmapLayer &) = delete;
+    Vdp2BitmapLayer &operator=(const Vdp2BitmapLayer &) = delete;
+
+    /** @brief Copy rows of an 8bpp image into the bitmap
+     *
+     * Each row is one DMA transfer since the bitmap pitch is wider than the
+     * image.
+     * @param pixels Image of `width` bytes per row
+     * @param first First row to copy
+     * @param count Number of rows, clipped to the visible height
+     */
+    void Upload(const uint8_t *pixels, uint16_t first, uint16_t count) const
+    {
+        const uint16_t last = first + count < height ? first + count : height;
+
+        for (uint16_t y = first; y < last; ++y)
+        {
+            slDMACopy(const_cast<uint8_t *>(pixels + y * width), line(y), width);
+            slDMAWait();
+        }
+    }
+};
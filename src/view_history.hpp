@@ -0,0 +1,249 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace SRL::Logger;
+
+/** @brief Bounded LRU cache of compressed iteration buffers
+ *
+ * Keeps recently completed views so navigating back to them does not need a
+ * re-render. Each entry stores the view bounds and the iteration buffer
+ * compressed with a run-length encoding of equal iterations, which suits the
+ * large flat areas of Mandelbrot images well.
+ *
+ * All entries share a fixed memory budget: when a push does not fit, the
+ * least recently used entries are evicted first.
+ *
+ * Encoded stream is a sequence of 3 byte runs: [length 1..255][value lo][value hi].
+ * Byte granularity keeps the decoder free of unaligned 16-bit accesses on SH2.
+ * @tparam ViewT View descriptor type, must be copyable and comparable with ==
+ * @tparam MaxEntries Maximum number of views kept regardless of the budget
+ */
+template <typename ViewT, size_t MaxEntries = 16>
+class ViewHistory
+{
+private:
+    static constexpr size_t RunBytes = 3;
+    static constexpr uint16_t MaxRun = 255;
+
+    /** @brief One stored view */
+    struct Entry
+    {
+        ViewT view;      ///< View bounds the buffer was rendered for
+        uint8_t *data;   ///< RLE stream
+        size_t size;     ///< Size of the RLE stream in bytes
+        size_t rawSize;  ///< Size of the uncompressed iteration buffer in bytes
+    };
+
+    Entry entries[MaxEntries]; ///< Index 0 is the least recently used entry
+    size_t count;
+    size_t budget;
+    size_t used;
+
+    /** @brief Free the entry at index and close the gap */
+    void remove(size_t index)
+    {
+        used -= entries[index].size;
+        delete[] entries[index].data;
+
+        for (size_t i = index; i + 1 < count; ++i)
+        {
+            entries[i] = entries[i + 1];
+        }
+
+        --count;
+    }
+
+    /** @brief Find the most recent entry matching a view
+     * @return Entry index or -1 when the view is not stored
+     */
+    int32_t find(const ViewT &view) const
+    {
+        for (int32_t i = static_cast<int32_t>(count) - 1; i >= 0; --i)
+        {
+            if (entries[i].view == view)
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    /** @brief Measure the encoded size of a buffer without writing it */
+    static size_t measure(const uint16_t *buffer, size_t length)
+    {
+        size_t size = 0;
+
+        for (size_t i = 0; i < length;)
+        {
+            const uint16_t value = buffer[i];
+            uint16_t run = 1;
+
+            while (i + run < length && run < MaxRun && buffer[i + run] == value)
+            {
+                ++run;
+            }
+
+            size += RunBytes;
+            i += run;
+        }
+
+        return size;
+    }
+
+    /** @brief Encode a buffer into a stream of exactly measure() bytes */
+    static void encode(const uint16_t *buffer, size_t length, uint8_t *out)
+    {
+        for (size_t i = 0; i < length;)
+        {
+            const uint16_t value = buffer[i];
+            uint16_t run = 1;
+
+            while (i + run < length && run < MaxRun && buffer[i + run] == value)
+            {
+                ++run;
+            }
+
+            *out++ = static_cast<uint8_t>(run);
+            *out++ = static_cast<uint8_t>(value & 0xFF);
+            *out++ = static_cast<uint8_t>(value >> 8);
+            i += run;
+        }
+    }
+
+    /** @brief Decode an entry, handing each run to the sink
+     * @param sink Callable as sink(offset, length, value)
+     */
+    template <typename Sink>
+    static void decode(const Entry &entry, Sink &&sink)
+    {
+        size_t offset = 0;
+        const uint8_t *in = entry.data;
+        const uint8_t *end = entry.data + entry.size;
+
+        while (in < end)
+        {
+            const uint16_t run = in[0];
+            const uint16_t value = static_cast<uint16_t>(in[1] | (in[2] << 8));
+            sink(offset, run, value);
+            offset += run;
+            in += RunBytes;
+        }
+    }
+
+public:
+    /** @brief Construct an empty history
+     * @param budgetBytes Total memory the compressed streams may use
+     */
+    explicit ViewHistory(size_t budgetBytes) : entries(), count(0), budget(budgetBytes), used(0) {}
+
+    /** @brief Release every stored stream */
+    ~ViewHistory()
+    {
+        Clear();
+    }
+
+    ViewHistory(const ViewHistory &) = delete;
+    ViewHistory &operator=(const ViewHistory &) = delete;
+
+    /** @brief Drop all entries */
+    void Clear()
+    {
+        while (count > 0)
+        {
+            remove(count - 1);
+        }
+    }
+
+    /** @brief Compress and push a completed view as the most recent entry
+     *
+     * A previous entry for the same view is replaced. Least recently used
+     * entries are evicted until the new stream fits into the budget.
+     * @param view View bounds the buffer belongs to
+     * @param iterations Iteration buffer to compress
+     * @param length Number of pixels in the buffer
+     * @return true when the view was stored
+     */
+    bool Push(const ViewT &view, const uint16_t *iterations, size_t length)
+    {
+        const int32_t existing = find(view);
+
+        if (existing >= 0)
+        {
+            remove(existing);
+        }
+
+        const size_t size = measure(iterations, length);
+
+        if (size > budget)
+        {
+            Log::LogPrint<LogLevels::WARNING>("history: view needs %d bytes, budget is %d",
+                                              static_cast<int32_t>(size),
+                                              static_cast<int32_t>(budget));
+            return false;
+        }
+
+        while (count > 0 && (used + size > budget || count == MaxEntries))
+        {
+            Log::LogPrint<LogLevels::DEBUG>("history: evict %d bytes", static_cast<int32_t>(entries[0].size));
+            remove(0);
+        }
+
+        uint8_t *data = new uint8_t[size];
+
+        if (data == nullptr)
+        {
+            Log::LogPrint<LogLevels::WARNING>("history: allocation of %d bytes failed", static_cast<int32_t>(size));
+            return false;
+        }
+
+        encode(iterations, length, data);
+
+        entries[count] = Entry{view, data, size, length * sizeof(uint16_t)};
+        ++count;
+        used += size;
+
+        Log::LogPrint<LogLevels::INFO>("history: push %d -> %d bytes (%d%%), %d views, %d/%d bytes",
+                                       static_cast<int32_t>(entries[count - 1].rawSize),
+                                       static_cast<int32_t>(size),
+                                       static_cast<int32_t>((size * 100) / entries[count - 1].rawSize),
+                                       static_cast<int32_t>(count),
+                                       static_cast<int32_t>(used),
+                                       static_cast<int32_t>(budget));
+        return true;
+    }
+
+    /** @brief Take a view out of the history if it is stored
+     * @param view View bounds to look for
+     * @param sink Callable as sink(offset, length, value) for each run
+     * @return true when the view was found and decompressed
+     */
+    template <typename Sink>
+    bool Take(const ViewT &view, Sink &&sink)
+    {
+        const int32_t index = find(view);
+
+        if (index < 0)
+        {
+            return false;
+        }
+
+        decode(entries[index], sink);
+        remove(index);
+        return true;
+    }
+
+    /** @brief Number of stored views */
+    size_t GetCount() const { return count; }
+
+    /** @brief Bytes currently used by compressed streams */
+    size_t GetUsedBytes() const { return used; }
+
+    /** @brief Total memory budget in bytes */
+    size_t GetBudget() const { return budget; }
+};
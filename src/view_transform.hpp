@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Mapping from canvas pixels to the complex plane
+ *
+ * Mapping a pixel as `min + x * (max - min) / (Width - 1)` costs a division
+ * per coordinate, two per pixel when done in the inner loop. The real part
+ * only depends on the column, so it is computed once per view into a table;
+ * the imaginary part only depends on the row and is computed once per row
+ * by the caller. Both use the very same expression as before, so results
+ * stay bit-identical to the per-pixel form.
+ *
+ * The canvas size is a template parameter: the table has a fixed size and
+ * the step divisors are compile-time constants.
+ * @tparam RealT Coordinate type
+ * @tparam Width Canvas width in pixels
+ * @tparam Height Canvas height in pixels
+ */
+template <typename RealT, uint16_t Width, uint16_t Height>
+class ViewTransform
+{
+private:
+    static_assert(Width > 1 && Height > 1, "canvas needs at least two pixels per axis");
+
+    static constexpr int ColumnSteps = Width - 1;
+    static constexpr int RowSteps = Height - 1;
+
+    RealT columns[Width];
+    RealT minImag;
+    RealT spanImag;
+
+public:
+    ViewTransform() : columns(), minImag(), spanImag()
+    {
+    }
+
+    /** @brief Map the canvas onto new bounds
+     *
+     * Fills the column table, Width divisions per view.
+     * @param minReal Real coordinate of the left column
+     * @param maxReal Real coordinate of the right column
+     * @param minImag Imaginary coordinate of the top row
+     * @param maxImag Imaginary coordinate of the bottom row
+     */
+    void Set(const RealT &minReal, const RealT &maxReal, const RealT &minImag, const RealT &maxImag)
+    {
+        const RealT spanReal = maxReal - minReal;
+
+        for (uint16_t x = 0; x < Width; ++x)
+        {
+            columns[x] = minReal + x * spanReal / ColumnSteps;
+        }
+
+        this->minImag = minImag;
+        spanImag = maxImag - minImag;
+    }
+
+    /** @brief Real coordinate of a column, a table lookup */
+    const RealT &Real(uint16_t x) const
+    {
+        return columns[x];
+    }
+
+    /** @brief Imaginary coordinate of a row, meant to be called once per row */
+    RealT Imag(uint16_t y) const
+    {
+        return minImag + y * spanImag / RowSteps;
+    }
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <srl.hpp>
+#include <srl_log.hpp> // Logging system
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "zoom_stream_format.hpp"
+
+using namespace SRL::Logger;
+
+/** @brief Streaming player for pre-rendered zoom sequences
+ *
+ * Plays a `ZoomStream` file from the CD into an 8-bit indexed buffer. Two
+ * frame buffers are used: while one frame is being decoded and displayed,
+ * the next one is transferred from the CD with non-blocking GFS reads, so
+ * the drive never waits on the decoder and the other way around. The
+ * sequence loops when it reaches the end.
+ *
+ * Streams may be an integer fraction of the destination size: a 2x CD drive
+ * reads about 300KB/s, which only leaves room for compressed 160x112
+ * frames, pixel-doubled on decode. A frame has to arrive while the one
+ * before it is shown, so the encoder sets the fields per frame from the
+ * largest frame of the stream.
+ */
+class ZoomPlayer
+{
+private:
+    static constexpr uint8_t BufferCount = 2;
+
+    GfsHn file;
+    ZoomStream::Header header;
+    uint16_t *frameSectors;   ///< Sectors used by each frame
+    int32_t streamSectors;    ///< Sectors used by all frames
+    uint8_t *buffers[BufferCount];
+    bool ready[BufferCount];  ///< Buffer holds a complete frame waiting for display
+    uint8_t *pixels;          ///< Decoded frame before upscaling, when scale > 1
+    uint16_t width;           ///< Destination width
+    uint16_t scale;           ///< Destination size / stream size
+
+    int8_t reading;        ///< Buffer the pending read goes to, -1 when idle
+    uint8_t display;       ///< Buffer holding the next frame to show
+    uint16_t nextRead;     ///< Frame the next read fetches
+    uint16_t fields;       ///< Fields the current frame has been displayed
+    uint32_t framesShown;
+    uint32_t framesLate;   ///< Frames that were not read in time for their slot
+
+    /** @brief Seek to the first frame and start the CD read-ahead */
+    void rewind()
+    {
+        GFS_Seek(file, header.headerSectors, GFS_SEEK_SET);
+        GFS_NwCdRead(file, streamSectors);
+        nextRead = 0;
+    }
+
+    /** @brief Start reading the next frame into a free buffer
+     *
+     * Buffers are filled in display order: the display buffer first when it
+     * is empty, the other one while the display buffer waits to be shown.
+     */
+    void startRead()
+    {
+        const uint8_t target = (display + (ready[display] ? 1 : 0)) % BufferCount;
+
+        if (reading >= 0 || ready[target])
+        {
+            return;
+        }
+
+        if (nextRead >= header.frameCount)
+        {
+            rewind();
+        }
+
+        const int32_t sectors = frameSectors[nextRead];
+
+        if (GFS_NwFread(file, sectors, buffers[target], sectors * ZoomStream::SectorSize) < 0)
+        {
+            Log::LogPrint<LogLevels::WARNING>("zoom: read of frame %d failed", nextRead);
+            return;
+        }
+
+        reading = target;
+        ++nextRead;
+    }
+
+    /** @brief Replicate each decoded pixel into a scale x scale block */
+    void upscale(uint8_t *destination) const
+    {
+        const uint8_t *in = pixels;
+
+        for (uint16_t y = 0; y < header.height; ++y)
+        {
+            uint8_t *row = destination + y * scale * width;
+
+            for (uint16_t x = 0; x < header.width; ++x)
+            {
+                memset(row + x * scale, *in++, scale);
+            }
+
+            for (uint16_t copy = 1; copy < scale; ++copy)
+            {
+                memcpy(row + copy * width, row, width);
+            }
+        }
+    }
+
+public:
+    /** @brief Construct an idle player */
+    ZoomPlayer() : file(nullptr),
+                   header(),
+                   frameSectors(nullptr),
+                   streamSectors(0),
+                   buffers(),
+                   ready(),
+                   pixels(nullptr),
+                   width(0),
+                   scale(1),
+                   reading(-1),
+                   display(0),
+                   nextRead(0),
+                   fields(0),
+                   framesShown(0),
+                   framesLate(0)
+    {
+    }
+
+    /** @brief Close the stream and free the buffers */
+    ~ZoomPlayer()
+    {
+        Close();
+    }
+
+    ZoomPlayer(const ZoomPlayer &) = delete;
+    ZoomPlayer &operator=(const ZoomPlayer &) = delete;
+
+    /** @brief Open a stream and start buffering its first frames
+     *
+     * Reads the header and sector table with a blocking read, allocates the
+     * two frame buffers and starts the CD read-ahead.
+     * @param name File name on the CD
+     * @param destinationWidth Width of the buffer frames are decoded into
+     * @param destinationHeight Height of the buffer frames are decoded into
+     * @return false when the file is missing or does not scale to the destination
+     */
+    bool Open(const char *name, uint16_t destinationWidth, uint16_t destinationHeight)
+    {
+        Close();
+
+        const int32_t id = GFS_NameToId(reinterpret_cast<Sint8 *>(const_cast<char *>(name)));
+
+        if (id < 0 || (file = GFS_Open(id)) == nullptr)
+        {
+            Log::LogPrint<LogLevels::WARNING>("zoom: %s not found", name);
+            return false;
+        }
+
+        uint8_t *table = new uint8_t[ZoomStream::SectorSize];
+        GFS_Fread(file, 1, table, ZoomStream::SectorSize);
+
+        const bool valid = ZoomStream::ParseHeader(table, header) &&
+                           header.width > 0 && destinationWidth % header.width == 0 &&
+                           header.height * (destinationWidth / header.width) == destinationHeight;
+
+        if (!valid)
+        {
+            Log::LogPrint<LogLevels::WARNING>("zoom: %s does not scale to %dx%d", name, destinationWidth, destinationHeight);
+            delete[] table;
+            Close();
+            return false;
+        }
+
+        width = destinationWidth;
+        scale = destinationWidth / header.width;
+
+        if (header.headerSectors > 1)
+        {
+            // The sector table continues past the first sector
+            delete[] table;
+            table = new uint8_t[header.headerSectors * ZoomStream::SectorSize];
+            GFS_Seek(file, 0, GFS_SEEK_SET);
+            GFS_Fread(file, header.headerSectors, table, header.headerSectors * ZoomStream::SectorSize);
+        }
+
+        frameSectors = new uint16_t[header.frameCount];
+        streamSectors = 0;
+
+        for (uint16_t i = 0; i < header.frameCount; ++i)
+        {
+            frameSectors[i] = ZoomStream::Read16(table + ZoomStream::HeaderSize + i * sizeof(uint16_t));
+            streamSectors += frameSectors[i];
+        }
+
+        delete[] table;
+
+        for (uint8_t i = 0; i < BufferCount; ++i)
+        {
+            buffers[i] = new uint8_t[header.maxFrameSectors * ZoomStream::SectorSize];
+            ready[i] = false;
+        }
+
+        if (scale > 1)
+        {
+            pixels = new uint8_t[header.width * header.height];
+        }
+
+        // Frames are transferred by SCU DMA, a whole frame per service call
+        GFS_SetTmode(file, GFS_TMODE_SCU);
+        GFS_SetTransPara(file, header.maxFrameSectors);
+
+        reading = -1;
+        display = 0;
+        fields = 0;
+        framesShown = 0;
+        framesLate = 0;
+        rewind();
+        startRead();
+
+        Log::LogPrint<LogLevels::INFO>("zoom: %s, %d frames, %d fields per frame, %d sector buffers",
+                                       name,
+                                       header.frameCount,
+                                       header.fieldsPerFrame,
+                                       header.maxFrameSectors);
+        return true;
+    }
+
+    /** @brief Stop playback and release the file and buffers */
+    void Close()
+    {
+        if (file != nullptr)
+        {
+            GFS_NwStop(file);
+            GFS_Close(file);
+            file = nullptr;
+
+            Log::LogPrint<LogLevels::INFO>("zoom: %d frames shown, %d late", framesShown, framesLate);
+        }
+
+        for (uint8_t i = 0; i < BufferCount; ++i)
+        {
+            delete[] buffers[i];
+            buffers[i] = nullptr;
+        }
+
+        delete[] pixels;
+        pixels = nullptr;
+
+        delete[] frameSectors;
+        frameSectors = nullptr;
+    }
+
+    /** @brief Whether a stream is open */
+    bool IsOpen() const { return file != nullptr; }
+
+    /** @brief Service the stream once per displayed field
+     *
+     * Advances the pending CD transfer, decodes the next frame into the
+     * destination when the current one has been shown long enough and
+     * queues the read of the following frame.
+     * @param destination Palette index buffer of the size given to Open()
+     * @return true when a new frame was decoded into the destination
+     */
+    bool Update(uint8_t *destination)
+    {
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        if (reading >= 0)
+        {
+            GFS_NwExecOne(file);
+
+            if (GFS_NwIsComplete(file))
+            {
+                ready[reading] = true;
+                reading = -1;
+            }
+        }
+
+        startRead();
+
+        if (++fields < header.fieldsPerFrame)
+        {
+            return false;
+        }
+
+        if (!ready[display])
+        {
+            ++framesLate;
+            return false;
+        }
+
+        const uint8_t *frame = buffers[display];
+        const uint32_t size = ZoomStream::Read32(frame);
+
+        uint8_t *decoded = scale > 1 ? pixels : destination;
+
+        if (!ZoomStream::DecodeFrame(frame + ZoomStream::FrameHeaderSize, size, decoded, header.width * header.height))
+        {
+            Log::LogPrint<LogLevels::WARNING>("zoom: corrupted frame");
+        }
+
+        if (scale > 1)
+        {
+            upscale(destination);
+        }
+
+        ready[display] = false;
+        display = (display + 1) % BufferCount;
+        fields = 0;
+        ++framesShown;
+
+        startRead();
+        return true;
+    }
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** @brief Pre-rendered zoom stream format
+ *
+ * Shared by the Saturn player (`ZoomPlayer`) and the host encoder
+ * (`tools/zoomenc.cxx`). All multi-byte fields are big-endian and read byte
+ * by byte, so the layout does not depend on the host or on alignment.
+ *
+ * File layout, every block starting on a CD sector boundary:
+ * - header sector(s): `ZoomStream::Header` followed by one 16-bit sector
+ *   count per frame, padded to whole sectors
+ * - frames: 32-bit payload size followed by the PackBits encoded palette
+ *   indices of one frame, padded to whole sectors
+ */
+namespace ZoomStream
+{
+    static constexpr size_t SectorSize = 2048;
+    static constexpr uint8_t Magic[4] = {'M', 'Z', 'S', '1'};
+    static constexpr size_t HeaderSize = 16;      ///< Bytes before the sector table
+    static constexpr size_t FrameHeaderSize = 4;  ///< Payload size before each frame
+
+    /** @brief Stream description stored at the start of the file */
+    struct Header
+    {
+        uint16_t width;           ///< Frame width in pixels
+        uint16_t height;          ///< Frame height in pixels
+        uint16_t frameCount;      ///< Number of frames
+        uint16_t fieldsPerFrame;  ///< Display fields each frame stays on screen
+        uint16_t headerSectors;   ///< Sectors used by the header and sector table
+        uint16_t maxFrameSectors; ///< Largest frame in sectors, sizes the read buffers
+    };
+
+    /** @brief Number of sectors needed for a byte count */
+    inline constexpr size_t ToSectors(size_t bytes)
+    {
+        return (bytes + SectorSize - 1) / SectorSize;
+    }
+
+    inline uint16_t Read16(const uint8_t *in)
+    {
+        return static_cast<uint16_t>((in[0] << 8) | in[1]);
+    }
+
+    inline uint32_t Read32(const uint8_t *in)
+    {
+        return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+               (static_cast<uint32_t>(in[2]) << 8) | in[3];
+    }
+
+    inline void Write16(uint8_t *out, uint16_t value)
+    {
+        out[0] = static_cast<uint8_t>(value >> 8);
+        out[1] = static_cast<uint8_t>(value);
+    }
+
+    inline void Write32(uint8_t *out, uint32_t value)
+    {
+        out[0] = static_cast<uint8_t>(value >> 24);
+        out[1] = static_cast<uint8_t>(value >> 16);
+        out[2] = static_cast<uint8_t>(value >> 8);
+        out[3] = static_cast<uint8_t>(value);
+    }
+
+    /** @brief Parse the fixed part of the header
+     * @param in First HeaderSize bytes of the file
+     * @param header Receives the parsed fields
+     * @return false when the magic does not match
+     */
+    inline bool ParseHeader(const uint8_t *in, Header &header)
+    {
+        for (size_t i = 0; i < sizeof(Magic); ++i)
+        {
+            if (in[i] != Magic[i])
+            {
+                return false;
+            }
+        }
+
+        header.width = Read16(in + 4);
+        header.height = Read16(in + 6);
+        header.frameCount = Read16(in + 8);
+        header.fieldsPerFrame = Read16(in + 10);
+        header.headerSectors = Read16(in + 12);
+        header.maxFrameSectors = Read16(in + 14);
+        return true;
+    }
+
+    /** @brief Serialize the fixed part of the header into HeaderSize bytes */
+    inline void WriteHeader(uint8_t *out, const Header &header)
+    {
+        for (size_t i = 0; i < sizeof(Magic); ++i)
+        {
+            out[i] = Magic[i];
+        }
+
+        Write16(out + 4, header.width);
+        Write16(out + 6, header.height);
+        Write16(out + 8, header.frameCount);
+        Write16(out + 10, header.fieldsPerFrame);
+        Write16(out + 12, header.headerSectors);
+        Write16(out + 14, header.maxFrameSectors);
+    }
+
+    /** @brief PackBits encode a frame of palette indices
+     *
+     * Control byte c < 0x80 is followed by c + 1 literal bytes, c >= 0x80
+     * repeats the next byte c - 0x80 + 2 times.
+     * @param in Palette indices
+     * @param length Number of pixels
+     * @param out Destination, needs length + length / 128 + 1 bytes at worst
+     * @return Number of bytes written
+     */
+    inline size_t EncodeFrame(const uint8_t *in, size_t length, uint8_t *out)
+    {
+        size_t written = 0;
+        size_t i = 0;
+
+        while (i < length)
+        {
+            size_t run = 1;
+
+            while (i + run < length && run < 129 && in[i + run] == in[i])
+            {
+                ++run;
+            }
+
+            if (run >= 2)
+            {
+                out[written++] = static_cast<uint8_t>(0x80 + run - 2);
+                out[written++] = in[i];
+                i += run;
+                continue;
+            }
+
+            // Collect literals until a run of at least 3 starts
+            size_t literals = 1;
+
+            while (i + literals < length && literals < 128)
+            {
+                const size_t next = i + literals;
+
+                if (next + 2 < length && in[next] == in[next + 1] && in[next] == in[next + 2])
+                {
+                    break;
+                }
+
+                ++literals;
+            }
+
+            out[written++] = static_cast<uint8_t>(literals - 1);
+
+            for (size_t j = 0; j < literals; ++j)
+            {
+                out[written++] = in[i + j];
+            }
+
+            i += literals;
+        }
+
+        return written;
+    }
+
+    /** @brief Decode a PackBits frame
+     * @param in Encoded payload
+     * @param size Payload size in bytes
+     * @param out Destination palette indices
+     * @param length Number of pixels in the destination
+     * @return false when the payload is malformed or does not fill the frame
+     */
+    inline bool DecodeFrame(const uint8_t *in, size_t size, uint8_t *out, size_t length)
+    {
+        const uint8_t *end = in + size;
+        size_t written = 0;
+
+        while (in < end)
+        {
+            const uint8_t control = *in++;
+
+            if (control < 0x80)
+            {
+                const size_t count = static_cast<size_t>(control) + 1;
+
+                if (written + count > length || in + count > end)
+                {
+                    return false;
+                }
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    out[written++] = *in++;
+                }
+            }
+            else
+            {
+                const size_t count = static_cast<size_t>(control) - 0x80 + 2;
+
+                if (written + count > length || in >= end)
+                {
+                    return false;
+                }
+
+                const uint8_t value = *in++;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    out[written++] = value;
+                }
+            }
+        }
+
+        return written == length;
+    }
+}
@@ -0,0 +1,505 @@
+// Batch renderer for offline pipelines.
+//
+// Reads a job file of views and renders them all with the shared Mandelbrot
+// kernel. The tiles of every job go through one ThreadPool loop, so the
+// cores go from the last tiles of a job straight to the next job. Finished
+// images are colored and written as binary PPM by a separate I/O thread
+// while the pool goes on computing.
+//
+// Job file, one job per line, '#' starts a comment:
+//   MIN_RE MAX_RE MIN_IM MAX_IM WIDTHxHEIGHT ITERATIONS TYPE PALETTE OUTPUT
+// TYPE is fxp (16.16 as the Saturn computes it), double, dd (double-double)
+// or auto (double, or double-double for pixel steps too fine for it).
+// PALETTE is saturn (the renderer's default palette), gray or fire.
+//
+// Usage:
+//   batchrender [--tile N] [--threads N] JOBFILE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "double_double.hpp"
+#include "host_fxp.hpp"
+#include "mandelbrot_kernel.hpp"
+#include "thread_pool.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum class RealType
+    {
+        Fxp,
+        Double,
+        DoubleDouble,
+        Auto
+    };
+
+    enum class PaletteKind
+    {
+        Saturn,
+        Gray,
+        Fire
+    };
+
+    struct Job
+    {
+        DoubleDouble minReal;
+        DoubleDouble maxReal;
+        DoubleDouble minImag;
+        DoubleDouble maxImag;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint16_t iterations = 0;
+        RealType type = RealType::Auto;
+        PaletteKind palette = PaletteKind::Saturn;
+        std::string output;
+    };
+
+    /** @brief Progress of a job while its tiles are spread over the pool */
+    struct JobState
+    {
+        std::vector<uint8_t> pixels; ///< Palette indices, allocated by the first tile started
+        std::once_flag allocated;
+        std::atomic<size_t> remaining{0};     ///< Tiles not finished yet
+        std::atomic<uint64_t> computeNanoseconds{0}; ///< Summed over the threads
+        std::atomic<uint64_t> iterations{0};
+        Clock::time_point started;
+        Clock::time_point finished;
+        double writeSeconds = 0.0;
+        bool written = false;
+        RealType used = RealType::Double; ///< Type auto resolved to
+    };
+
+    constexpr const char *RealTypeNames[] = {"fxp", "double", "dd", "auto"};
+    constexpr const char *PaletteNames[] = {"saturn", "gray", "fire"};
+
+    template <size_t Count>
+    bool lookup(const std::string &name, const char *const (&names)[Count], int &found)
+    {
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (name == names[i])
+            {
+                found = static_cast<int>(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool parseJob(const std::string &text, Job &job)
+    {
+        std::istringstream fields(text);
+        std::string minReal;
+        std::string maxReal;
+        std::string minImag;
+        std::string maxImag;
+        std::string size;
+        int iterations = 0;
+        std::string type;
+        std::string palette;
+        std::string rest;
+        int typeIndex;
+        int paletteIndex;
+
+        if (!(fields >> minReal >> maxReal >> minImag >> maxImag >> size >> iterations >> type >> palette >> job.output) ||
+            (fields >> rest) ||
+            !DoubleDouble::Parse(minReal.c_str(), job.minReal) || !DoubleDouble::Parse(maxReal.c_str(), job.maxReal) ||
+            !DoubleDouble::Parse(minImag.c_str(), job.minImag) || !DoubleDouble::Parse(maxImag.c_str(), job.maxImag) ||
+            std::sscanf(size.c_str(), "%ux%u", &job.width, &job.height) != 2 ||
+            !lookup(type, RealTypeNames, typeIndex) || !lookup(palette, PaletteNames, paletteIndex))
+        {
+            return false;
+        }
+
+        job.iterations = static_cast<uint16_t>(iterations);
+        job.type = static_cast<RealType>(typeIndex);
+        job.palette = static_cast<PaletteKind>(paletteIndex);
+
+        return iterations > 0 && iterations <= 0xFFFF &&
+               job.width > 1 && job.height > 1 && job.width <= 65536 && job.height <= 65536 &&
+               job.minReal < job.maxReal && job.minImag < job.maxImag;
+    }
+
+    bool readJobs(const char *path, std::vector<Job> &jobs)
+    {
+        FILE *file = std::fopen(path, "r");
+
+        if (file == nullptr)
+        {
+            std::perror(path);
+            return false;
+        }
+
+        char buffer[1024];
+        int line = 0;
+        bool valid = true;
+
+        while (std::fgets(buffer, sizeof(buffer), file) != nullptr)
+        {
+            ++line;
+            std::string text = buffer;
+            text = text.substr(0, text.find('#'));
+
+            if (text.find_first_not_of(" \t\r\n") == std::string::npos)
+            {
+                continue;
+            }
+
+            Job job;
+
+            if (!parseJob(text, job))
+            {
+                std::fprintf(stderr, "%s:%d: not a valid job\n", path, line);
+                valid = false;
+                continue;
+            }
+
+            jobs.push_back(job);
+        }
+
+        std::fclose(file);
+        return valid;
+    }
+
+    /** @brief RGB of a palette index */
+    void colorOf(PaletteKind palette, uint8_t index, uint8_t *rgb)
+    {
+        switch (palette)
+        {
+        case PaletteKind::Saturn:
+            // Palette::Palette() in src/main.cxx, 5 bits per channel
+            rgb[0] = static_cast<uint8_t>(index == 255 ? 0xF8 : index & 0xF8);
+            rgb[1] = static_cast<uint8_t>(index == 255 ? 0xF8 : (index * 2) & 0xF8);
+            rgb[2] = static_cast<uint8_t>(index == 255 ? 0xF8 : (index * 4) & 0xF8);
+            break;
+
+        case PaletteKind::Gray:
+            rgb[0] = rgb[1] = rgb[2] = index;
+            break;
+
+        case PaletteKind::Fire:
+            rgb[0] = static_cast<uint8_t>(std::min(255, index * 3));
+            rgb[1] = static_cast<uint8_t>(std::min(255, std::max(0, index * 3 - 255)));
+            rgb[2] = static_cast<uint8_t>(std::max(0, index * 3 - 510));
+            break;
+        }
+    }
+
+    /** @brief Finished images, written one after the other off the compute threads
+     *
+     * A finished image holds its full buffer until it is written, so when
+     * writing falls behind, WaitForRoom() holds the compute threads back
+     * rather than letting images pile up in memory.
+     */
+    class Writer
+    {
+    private:
+        static constexpr size_t MaxWaiting = 2; ///< Finished images queued before compute waits
+
+        std::vector<Job> &jobs;
+        std::vector<std::unique_ptr<JobState>> &states;
+        std::deque<size_t> queue;
+        std::mutex lock;
+        std::condition_variable ready;
+        std::condition_variable room;
+        bool closing = false;
+        std::thread thread;
+
+        void write(size_t index)
+        {
+            const Job &job = jobs[index];
+            JobState &state = *states[index];
+            const auto start = Clock::now();
+            FILE *file = std::fopen(job.output.c_str(), "wb");
+
+            if (file != nullptr)
+            {
+                std::vector<uint8_t> row(static_cast<size_t>(job.width) * 3);
+                bool written = std::fprintf(file, "P6\n%u %u\n255\n", job.width, job.height) > 0;
+
+                for (uint32_t y = 0; y < job.height && written; ++y)
+                {
+                    for (uint32_t x = 0; x < job.width; ++x)
+                    {
+                        colorOf(job.palette, state.pixels[static_cast<size_t>(y) * job.width + x], &row[x * 3]);
+                    }
+
+                    written = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+                }
+
+                state.written = std::fclose(file) == 0 && written;
+            }
+
+            // The image is on disk or lost, either way its memory goes back
+            std::vector<uint8_t>().swap(state.pixels);
+            state.writeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        void run()
+        {
+            for (;;)
+            {
+                size_t index;
+
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    ready.wait(guard, [&]() { return closing || !queue.empty(); });
+
+                    if (queue.empty())
+                    {
+                        return;
+                    }
+
+                    index = queue.front();
+                    queue.pop_front();
+                }
+
+                room.notify_all();
+                write(index);
+            }
+        }
+
+    public:
+        Writer(std::vector<Job> &jobList, std::vector<std::unique_ptr<JobState>> &stateList)
+            : jobs(jobList), states(stateList), thread(&Writer::run, this)
+        {
+        }
+
+        /** @brief Queue a finished job */
+        void Submit(size_t index)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                queue.push_back(index);
+            }
+
+            ready.notify_one();
+        }
+
+        /** @brief Wait until fewer than MaxWaiting images are queued, call before computing a tile */
+        void WaitForRoom()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            room.wait(guard, [&]() { return queue.size() < MaxWaiting; });
+        }
+
+        /** @brief Write what is queued and stop */
+        void Finish()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                closing = true;
+            }
+
+            ready.notify_one();
+            thread.join();
+        }
+    };
+
+    template <typename RealT>
+    RealT toReal(const DoubleDouble &value)
+    {
+        return static_cast<RealT>(value);
+    }
+
+    template <>
+    HostFxp toReal<HostFxp>(const DoubleDouble &value)
+    {
+        return HostFxp(value.High());
+    }
+
+    /** @brief Render one tile of a job into its palette indices
+     * @return Iterations done
+     */
+    template <typename RealT>
+    uint64_t renderTile(const Job &job, JobState &state, uint32_t left, uint32_t top, uint32_t width, uint32_t height)
+    {
+        const DoubleDouble stepReal = (job.maxReal - job.minReal) / DoubleDouble(static_cast<double>(job.width - 1));
+        const DoubleDouble stepImag = (job.maxImag - job.minImag) / DoubleDouble(static_cast<double>(job.height - 1));
+        uint64_t iterations = 0;
+
+        for (uint32_t y = top; y < top + height; ++y)
+        {
+            const RealT imag = toReal<RealT>(job.minImag + stepImag * DoubleDouble(static_cast<double>(y)));
+            uint8_t *row = state.pixels.data() + static_cast<size_t>(y) * job.width;
+
+            for (uint32_t x = left; x < left + width; ++x)
+            {
+                const uint16_t count = IterateMandelbrot(toReal<RealT>(job.minReal + stepReal * DoubleDouble(static_cast<double>(x))),
+                                                         imag,
+                                                         job.iterations);
+                row[x] = static_cast<uint8_t>(count % 256);
+                iterations += count + 1;
+            }
+        }
+
+        return iterations;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int tileSize = 64;
+    int threads = 0;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--tile" && i + 1 < argc)
+        {
+            tileSize = std::atoi(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (path == nullptr && arg[0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            path = nullptr;
+            break;
+        }
+    }
+
+    std::vector<Job> jobs;
+
+    if (path == nullptr || tileSize < 8 || tileSize > 4096 || threads < 0)
+    {
+        std::fprintf(stderr, "usage: batchrender [--tile N] [--threads N] JOBFILE\n");
+        return 1;
+    }
+
+    if (!readJobs(path, jobs))
+    {
+        return 1;
+    }
+
+    // Tiles of all jobs in one loop, job after job: firstTile[j] is the loop index of job j's first tile
+    std::vector<std::unique_ptr<JobState>> states;
+    std::vector<size_t> firstTile(1, 0);
+    uint64_t totalPixels = 0;
+
+    for (Job &job : jobs)
+    {
+        const size_t tiles = static_cast<size_t>((job.width + tileSize - 1) / tileSize) * ((job.height + tileSize - 1) / tileSize);
+        states.emplace_back(new JobState());
+        states.back()->remaining = tiles;
+        firstTile.push_back(firstTile.back() + tiles);
+        totalPixels += static_cast<uint64_t>(job.width) * job.height;
+
+        const bool deep = ((job.maxReal - job.minReal) / DoubleDouble(static_cast<double>(job.width - 1))).High() < DoubleDoubleStep;
+        states.back()->used = job.type != RealType::Auto ? job.type : (deep ? RealType::DoubleDouble : RealType::Double);
+    }
+
+    ThreadPool pool(static_cast<unsigned>(threads));
+    Writer writer(jobs, states);
+    const auto start = Clock::now();
+
+    std::printf("%zu jobs, %zu tiles of %d, %u threads\n", jobs.size(), firstTile.back(), tileSize, pool.GetSize());
+
+    pool.ForEach(firstTile.back(), [&](size_t item, unsigned)
+                 {
+                     const size_t index = static_cast<size_t>(std::upper_bound(firstTile.begin(), firstTile.end(), item) - firstTile.begin()) - 1;
+                     const Job &job = jobs[index];
+                     JobState &state = *states[index];
+                     const size_t tile = item - firstTile[index];
+                     const uint32_t columns = (job.width + tileSize - 1) / tileSize;
+                     const uint32_t left = static_cast<uint32_t>(tile % columns) * tileSize;
+                     const uint32_t top = static_cast<uint32_t>(tile / columns) * tileSize;
+                     const uint32_t width = std::min<uint32_t>(tileSize, job.width - left);
+                     const uint32_t height = std::min<uint32_t>(tileSize, job.height - top);
+
+                     // No new image is started, nor any tile computed, while the writer is behind
+                     writer.WaitForRoom();
+
+                     std::call_once(state.allocated, [&]()
+                                    {
+                                        state.started = Clock::now();
+                                        state.pixels.resize(static_cast<size_t>(job.width) * job.height);
+                                    });
+
+                     const auto tileStart = Clock::now();
+                     uint64_t iterations = 0;
+
+                     switch (state.used)
+                     {
+                     case RealType::Fxp:
+                         iterations = renderTile<HostFxp>(job, state, left, top, width, height);
+                         break;
+
+                     case RealType::DoubleDouble:
+                         iterations = renderTile<DoubleDouble>(job, state, left, top, width, height);
+                         break;
+
+                     default:
+                         iterations = renderTile<double>(job, state, left, top, width, height);
+                         break;
+                     }
+
+                     state.iterations += iterations;
+                     state.computeNanoseconds += static_cast<uint64_t>(
+                         std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tileStart).count());
+
+                     if (--state.remaining == 0)
+                     {
+                         state.finished = Clock::now();
+                         writer.Submit(index);
+                     }
+                 });
+
+    const auto computed = Clock::now();
+    writer.Finish();
+    const auto end = Clock::now();
+
+    int failures = 0;
+    uint64_t totalIterations = 0;
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const Job &job = jobs[i];
+        const JobState &state = *states[i];
+        failures += state.written ? 0 : 1;
+        totalIterations += state.iterations;
+
+        std::printf("%s: %ux%u %s, %.3f s wall, %.3f s compute, %.2f Mpixels/s per thread, %.3f s write%s\n",
+                    job.output.c_str(),
+                    job.width,
+                    job.height,
+                    RealTypeNames[static_cast<int>(state.used)],
+                    std::chrono::duration<double>(state.finished - state.started).count(),
+                    static_cast<double>(state.computeNanoseconds) / 1e9,
+                    static_cast<double>(job.width) * job.height / std::max(1.0, static_cast<double>(state.computeNanoseconds)) * 1e3,
+                    state.writeSeconds,
+                    state.written ? "" : " WRITE FAILED");
+    }
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::printf("total: %.2f s, %.1f Mpixels/s, %.1f M iterations/s, %.2f s of writing after the last tile\n",
+                seconds,
+                static_cast<double>(totalPixels) / seconds / 1e6,
+                static_cast<double>(totalIterations) / seconds / 1e6,
+                std::chrono::duration<double>(end - computed).count());
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+// Accuracy and speed check of the host double-double type.
+//
+// Compares DoubleDouble with the compiler's software 128-bit float, standing
+// in for an arbitrary precision library: first the operators on random
+// values, then every pixel of views down to a width of 1e-27 rendered with
+// IterateMandelbrot in double, double-double and 128-bit float, timed.
+//
+// Usage:
+//   ddcheck [--size WxH] [--iterations N]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "double_double.hpp"
+#include "mandelbrot_kernel.hpp"
+
+namespace
+{
+    using Quad = __float128;
+
+    struct Options
+    {
+        int width = 48;
+        int height = 32;
+        int iterations = 3000;
+    };
+
+    /** @brief A deep view, its center given with more digits than a double holds */
+    struct View
+    {
+        const char *centerReal;
+        const char *centerImag;
+        double span; ///< Real span, the imaginary one follows the aspect of the image
+    };
+
+    // Around c = i, a Misiurewicz point: the same kind of detail at every scale, and orbits that
+    // escape after a few hundred iterations, so a wrong count is lost precision and not chaos
+    constexpr View Views[] = {
+        {"0.0", "1.0", 1e-10},
+        {"0.0", "1.0", 1e-15},
+        {"0.0", "1.0", 1e-20},
+        {"0.0", "1.0", 1e-25},
+        {"0.0", "1.0", 1e-28},
+        {"0.0000000000000000000000000000123", "1.0000000000000000000000000000456", 1e-27},
+    };
+
+    constexpr double MaxMismatch = 0.01; ///< Share of pixels double-double may get wrong, orbits near the set amplify any rounding
+
+    Quad toQuad(const DoubleDouble &value)
+    {
+        return static_cast<Quad>(value.High()) + static_cast<Quad>(value.Low());
+    }
+
+    double relativeError(const DoubleDouble &value, Quad exact)
+    {
+        const Quad error = toQuad(value) - exact;
+        const double magnitude = std::fabs(static_cast<double>(exact));
+        return magnitude > 0.0 ? std::fabs(static_cast<double>(error)) / magnitude : std::fabs(static_cast<double>(error));
+    }
+
+    /** @brief Operators against 128-bit float on random operands of mixed magnitudes */
+    bool checkOperators()
+    {
+        std::mt19937_64 random(1);
+        std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+        std::uniform_int_distribution<int> exponent(-30, 30);
+        double worst[4] = {};
+
+        const auto draw = [&]()
+        {
+            const double high = std::ldexp(mantissa(random), exponent(random));
+            const double low = high * std::ldexp(mantissa(random), -54);
+            return DoubleDouble(high) + DoubleDouble(low);
+        };
+
+        for (int i = 0; i < 100000; ++i)
+        {
+            const DoubleDouble a = draw();
+            const DoubleDouble b = draw();
+            const Quad qa = toQuad(a);
+            const Quad qb = toQuad(b);
+            const double errors[4] = {
+                // Sums are measured against the larger operand, cancellation is exact
+                std::fabs(static_cast<double>(toQuad(a + b) - (qa + qb))) / std::fmax(std::fabs(a.High()), std::fabs(b.High())),
+                std::fabs(static_cast<double>(toQuad(a - b) - (qa - qb))) / std::fmax(std::fabs(a.High()), std::fabs(b.High())),
+                relativeError(a * b, qa * qb),
+                relativeError(a / b, qa / qb)};
+
+            for (int op = 0; op < 4; ++op)
+            {
+                worst[op] = std::fmax(worst[op], errors[op]);
+            }
+        }
+
+        DoubleDouble parsed;
+        const bool parses = DoubleDouble::Parse("-0.743643887037158704752191506114774", parsed) &&
+                            DoubleDouble::Parse("1.5e-27", parsed) && parsed.High() == 1.5e-27 &&
+                            !DoubleDouble::Parse("1.5e", parsed) && !DoubleDouble::Parse("0.1x", parsed);
+
+        // 2^-104, a couple of bits above the 106 of the format
+        const double bound = std::ldexp(1.0, -104);
+        const bool accurate = worst[0] < bound && worst[1] < bound && worst[2] < bound && worst[3] < bound;
+
+        std::printf("operators: worst relative error + %.1e, - %.1e, * %.1e, / %.1e, parse %s%s\n",
+                    worst[0], worst[1], worst[2], worst[3],
+                    parses ? "ok" : "FAILED",
+                    accurate ? "" : " (above 2^-104)");
+        return parses && accurate;
+    }
+
+    /** @brief Iteration counts of a view in one type, and the iterations done */
+    template <typename RealT, typename Convert>
+    std::vector<uint16_t> render(const Options &options, const DoubleDouble &minReal, const DoubleDouble &minImag,
+                                 const DoubleDouble &step, Convert &&convert, double &seconds, uint64_t &iterations)
+    {
+        std::vector<uint16_t> counts(static_cast<size_t>(options.width) * options.height);
+        const auto start = std::chrono::steady_clock::now();
+        iterations = 0;
+
+        for (int y = 0; y < options.height; ++y)
+        {
+            const RealT imag = convert(minImag + step * DoubleDouble(y));
+
+            for (int x = 0; x < options.width; ++x)
+            {
+                const RealT real = convert(minReal + step * DoubleDouble(x));
+                const uint16_t count = IterateMandelbrot(real, imag, static_cast<uint16_t>(options.iterations));
+                counts[y * options.width + x] = count;
+                iterations += count + 1;
+            }
+        }
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return counts;
+    }
+
+    size_t mismatches(const std::vector<uint16_t> &counts, const std::vector<uint16_t> &reference)
+    {
+        size_t different = 0;
+
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            different += counts[i] != reference[i] ? 1 : 0;
+        }
+
+        return different;
+    }
+
+    size_t distinct(const std::vector<uint16_t> &counts)
+    {
+        std::vector<bool> seen(0x10000, false);
+        size_t values = 0;
+
+        for (uint16_t count : counts)
+        {
+            values += seen[count] ? 0 : 1;
+            seen[count] = true;
+        }
+
+        return values;
+    }
+
+    bool parse(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+
+            if (arg == "--size" && i + 1 < argc)
+            {
+                if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2)
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--iterations" && i + 1 < argc)
+            {
+                options.iterations = std::atoi(argv[++i]);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return options.width > 1 && options.height > 1 && options.iterations > 0 && options.iterations <= 0xFFFF;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    if (!parse(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: ddcheck [--size WxH] [--iterations N]\n");
+        return 1;
+    }
+
+#ifdef FP_FAST_FMA
+    std::printf("products: fused multiply-add\n");
+#else
+    std::printf("products: Dekker split, build with -mfma for fused multiply-add\n");
+#endif
+
+    bool passed = checkOperators();
+    double fastSeconds = 0.0;
+    double quadSeconds = 0.0;
+    uint64_t fastIterations = 0;
+    uint64_t quadIterations = 0;
+
+    for (const View &view : Views)
+    {
+        DoubleDouble centerReal;
+        DoubleDouble centerImag;
+        DoubleDouble::Parse(view.centerReal, centerReal);
+        DoubleDouble::Parse(view.centerImag, centerImag);
+
+        const DoubleDouble step = DoubleDouble(view.span) / DoubleDouble(options.width - 1);
+        const DoubleDouble minReal = centerReal - step * DoubleDouble((options.width - 1) / 2.0);
+        const DoubleDouble minImag = centerImag - step * DoubleDouble((options.height - 1) / 2.0);
+
+        double seconds[3];
+        uint64_t iterations[3];
+        const auto plain = render<double>(options, minReal, minImag, step,
+                                          [](const DoubleDouble &value) { return value.High(); },
+                                          seconds[0], iterations[0]);
+        const auto fast = render<DoubleDouble>(options, minReal, minImag, step,
+                                               [](const DoubleDouble &value) { return value; },
+                                               seconds[1], iterations[1]);
+        const auto exact = render<Quad>(options, minReal, minImag, step,
+                                        [](const DoubleDouble &value) { return toQuad(value); },
+                                        seconds[2], iterations[2]);
+
+        const size_t pixels = exact.size();
+        const size_t wrong = mismatches(fast, exact);
+        const bool ok = wrong <= static_cast<size_t>(MaxMismatch * pixels);
+        passed = passed && ok;
+        fastSeconds += seconds[1];
+        quadSeconds += seconds[2];
+        fastIterations += iterations[1];
+        quadIterations += iterations[2];
+
+        std::printf("span %.0e: %zu levels, double %zu wrong, double-double %zu wrong of %zu, %.1f / %.1f / %.1f ns per iteration%s\n",
+                    view.span,
+                    distinct(exact),
+                    mismatches(plain, exact),
+                    wrong,
+                    pixels,
+                    1e9 * seconds[0] / static_cast<double>(iterations[0]),
+                    1e9 * seconds[1] / static_cast<double>(iterations[1]),
+                    1e9 * seconds[2] / static_cast<double>(iterations[2]),
+                    ok ? "" : " MISMATCH");
+    }
+
+    const double fastRate = fastSeconds / static_cast<double>(fastIterations);
+    const double quadRate = quadSeconds / static_cast<double>(quadIterations);
+
+    std::printf("double-double is %.1fx faster than 128-bit float\n", quadRate / fastRate);
+    std::printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
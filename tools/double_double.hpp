@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/** @brief Double-double real for host renders deeper than `double` reaches
+ *
+ * A value is the unevaluated sum of two doubles, the low one at most half
+ * an ulp of the high one, which gives about 106 mantissa bits: views stay
+ * sharp down to a width of about 1e-28 where `double` breaks into blocks
+ * around 1e-13. Products use the error-free FMA transform when the target
+ * has a fused multiply-add (`FP_FAST_FMA`, `-mfma` from the makefile) and
+ * Dekker's split otherwise, so every operation is a dozen or two plain
+ * double instructions instead of a call into an arbitrary precision library.
+ *
+ * Only the operators `IterateMandelbrot` and the tools need are provided,
+ * with the same semantics as for `double`. Requires IEEE double rounding:
+ * no `-ffast-math`, which would fold the error terms away.
+ */
+class DoubleDouble
+{
+private:
+    double hi;
+    double lo;
+
+    /** @brief a + b as a rounded sum and its exact error */
+    static DoubleDouble twoSum(double a, double b)
+    {
+        const double sum = a + b;
+        const double part = sum - a;
+        return BuildRaw(sum, (a - (sum - part)) + (b - part));
+    }
+
+    /** @brief a + b as a rounded sum and its exact error, for |a| >= |b| */
+    static DoubleDouble quickTwoSum(double a, double b)
+    {
+        const double sum = a + b;
+        return BuildRaw(sum, b - (sum - a));
+    }
+
+    /** @brief a * b as a rounded product and its exact error */
+    static DoubleDouble twoProduct(double a, double b)
+    {
+        const double product = a * b;
+#ifdef FP_FAST_FMA
+        return BuildRaw(product, std::fma(a, b, -product));
+#else
+        // Dekker: halves of 26 bits multiply exactly
+        constexpr double Splitter = 134217729.0; // 2^27 + 1
+        const double aBig = Splitter * a;
+        const double aHigh = aBig - (aBig - a);
+        const double aLow = a - aHigh;
+        const double bBig = Splitter * b;
+        const double bHigh = bBig - (bBig - b);
+        const double bLow = b - bHigh;
+        return BuildRaw(product, ((aHigh * bHigh - product) + aHigh * bLow + aLow * bHigh) + aLow * bLow);
+#endif
+    }
+
+public:
+    constexpr DoubleDouble() : hi(0.0), lo(0.0) {}
+    constexpr DoubleDouble(double number) : hi(number), lo(0.0) {}
+    constexpr DoubleDouble(int number) : hi(number), lo(0.0) {}
+
+    /** @brief Build from a normalized pair, |lo| at most half an ulp of hi */
+    static constexpr DoubleDouble BuildRaw(double hi, double lo)
+    {
+        DoubleDouble result;
+        result.hi = hi;
+        result.lo = lo;
+        return result;
+    }
+
+    /** @brief Leading part, the value rounded to double */
+    constexpr double High() const { return hi; }
+
+    /** @brief Trailing part */
+    constexpr double Low() const { return lo; }
+
+    explicit constexpr operator double() const { return hi; }
+
+    DoubleDouble operator+(const DoubleDouble &other) const
+    {
+        // Both parts summed with their errors, so cancellation stays exact
+        DoubleDouble high = twoSum(hi, other.hi);
+        const DoubleDouble low = twoSum(lo, other.lo);
+        high = quickTwoSum(high.hi, high.lo + low.hi);
+        return quickTwoSum(high.hi, high.lo + low.lo);
+    }
+
+    DoubleDouble operator-(const DoubleDouble &other) const { return *this + -other; }
+
+    constexpr DoubleDouble operator-() const { return BuildRaw(-hi, -lo); }
+
+    DoubleDouble operator*(const DoubleDouble &other) const
+    {
+        const DoubleDouble product = twoProduct(hi, other.hi);
+        return quickTwoSum(product.hi, product.lo + (hi * other.lo + lo * other.hi));
+    }
+
+    /** @brief *this * *this, the same value as the product for one multiply less */
+    DoubleDouble Square() const
+    {
+        const DoubleDouble product = twoProduct(hi, hi);
+        return quickTwoSum(product.hi, product.lo + 2.0 * (hi * lo));
+    }
+
+    /** @brief 2 * *this, exact */
+    constexpr DoubleDouble Twice() const { return BuildRaw(2.0 * hi, 2.0 * lo); }
+
+    DoubleDouble operator/(const DoubleDouble &other) const
+    {
+        // Long division, one double digit at a time
+        const double first = hi / other.hi;
+        DoubleDouble rest = *this - other * DoubleDouble(first);
+        const double second = rest.hi / other.hi;
+        rest = rest - other * DoubleDouble(second);
+        const double third = rest.hi / other.hi;
+        return quickTwoSum(first, second) + DoubleDouble(third);
+    }
+
+    DoubleDouble &operator+=(const DoubleDouble &other) { return *this = *this + other; }
+    DoubleDouble &operator-=(const DoubleDouble &other) { return *this = *this - other; }
+    DoubleDouble &operator*=(const DoubleDouble &other) { return *this = *this * other; }
+
+    constexpr bool operator==(const DoubleDouble &other) const { return hi == other.hi && lo == other.lo; }
+    constexpr bool operator!=(const DoubleDouble &other) const { return !(*this == other); }
+    constexpr bool operator<(const DoubleDouble &other) const { return hi < other.hi || (hi == other.hi && lo < other.lo); }
+    constexpr bool operator>(const DoubleDouble &other) const { return other < *this; }
+    constexpr bool operator<=(const DoubleDouble &other) const { return !(other < *this); }
+    constexpr bool operator>=(const DoubleDouble &other) const { return !(*this < other); }
+
+    /** @brief Read a decimal number with all of its digits, as "-0.7436438870371587047521915061" or "1.5e-27"
+     * @param text Number, optional sign, digits, optional fraction and exponent
+     * @param out Receives the value, rounded to about 31 significant digits
+     * @return false when the text is not a complete number
+     */
+    static bool Parse(const char *text, DoubleDouble &out)
+    {
+        const bool negative = *text == '-';
+        text += (*text == '-' || *text == '+') ? 1 : 0;
+
+        DoubleDouble value;
+        int32_t scale = 0;
+        bool digits = false;
+        bool fraction = false;
+
+        for (; (*text >= '0' && *text <= '9') || (*text == '.' && !fraction); ++text)
+        {
+            if (*text == '.')
+            {
+                fraction = true;
+                continue;
+            }
+
+            value = value * DoubleDouble(10) + DoubleDouble(*text - '0');
+            scale -= fraction ? 1 : 0;
+            digits = true;
+        }
+
+        if (*text == 'e' || *text == 'E')
+        {
+            const bool down = text[1] == '-';
+            text += (text[1] == '-' || text[1] == '+') ? 2 : 1;
+            int32_t exponent = 0;
+
+            if (*text < '0' || *text > '9')
+            {
+                return false;
+            }
+
+            for (; *text >= '0' && *text <= '9' && exponent < 10000; ++text)
+            {
+                exponent = exponent * 10 + (*text - '0');
+            }
+
+            scale += down ? -exponent : exponent;
+        }
+
+        if (!digits || *text != '\0')
+        {
+            return false;
+        }
+
+        // Exact powers of ten up to 10^22, applied a chunk at a time
+        for (; scale != 0;)
+        {
+            const int32_t step = scale > 0 ? (scale < 22 ? scale : 22) : (scale > -22 ? -scale : 22);
+            const DoubleDouble power(std::pow(10.0, step));
+            value = scale > 0 ? value * power : value / power;
+            scale += scale > 0 ? -step : step;
+        }
+
+        out = negative ? -value : value;
+        return true;
+    }
+};
+
+/** @brief Pixel step below which `double` runs out of bits and a render takes DoubleDouble
+ *
+ * 2^-42: coordinates up to 2 in magnitude keep 10 bits under the step.
+ */
+constexpr double DoubleDoubleStep = 2.27e-13;
+
+/** @brief `IterateMandelbrot` for double-double, picked over the generic loop
+ *
+ * Same counts and orbit as the generic loop, which multiplies seven times
+ * per iteration: here the squares of the escape test are kept for the next
+ * iteration and the doubling is exact, leaving two squares and a product.
+ */
+template <typename Visit>
+inline uint16_t IterateMandelbrot(const DoubleDouble &cReal, const DoubleDouble &cImag, uint16_t maxIterations, Visit &&visit)
+{
+    uint16_t iteration = 0;
+    DoubleDouble zReal = cReal;
+    DoubleDouble zImag = cImag;
+    DoubleDouble realSquare = zReal.Square();
+    DoubleDouble imagSquare = zImag.Square();
+    const DoubleDouble four(4.0);
+
+    while (iteration < maxIterations)
+    {
+        zImag = zReal.Twice() * zImag + cImag;
+        zReal = realSquare - imagSquare + cReal;
+        realSquare = zReal.Square();
+        imagSquare = zImag.Square();
+
+        if (realSquare + imagSquare > four)
+        {
+            return iteration;
+        }
+
+        visit(zReal, zImag);
+        ++iteration;
+    }
+    return maxIterations;
+}
@@ -0,0 +1,552 @@
+// Reference SCU DSP simulation for the Mandelbrot microprogram.
+//
+// Runs ScuDsp::Program on a model of the SCU DSP and checks every pixel of a
+// set of views against IterateMandelbrot on a bit-exact host Fxp. The model
+// also lints each executed instruction against the timing-safe rules the
+// program documents, and runs once with and once without jump delay slots.
+//
+// Usage:
+//   dspsim [--iterations N]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "host_fxp.hpp"
+#include "mandelbrot_kernel.hpp"
+#include "scu_dsp_program.hpp"
+
+namespace
+{
+    /** @brief Model of the SCU DSP, limited to what the program uses */
+    class ScuDspModel
+    {
+    private:
+        static constexpr int64_t Mask48 = (static_cast<int64_t>(1) << 48) - 1;
+
+        const uint32_t *program;
+        bool delaySlot;
+
+        uint32_t ram[4][ScuDsp::BankSize];
+        uint8_t ct[4];
+        int64_t a;   ///< 48-bit accumulator
+        int64_t p;   ///< 48-bit product register
+        int64_t alu; ///< Last ALU result
+        int64_t mul; ///< RX * RY of the previous instruction
+        int32_t rx;
+        int32_t ry;
+        bool flagS;
+        bool flagZ;
+        bool flagC;
+        uint64_t cycles;
+        std::string error;
+
+        static int64_t signExtend48(int64_t value)
+        {
+            value &= Mask48;
+            return (value & (static_cast<int64_t>(1) << 47)) ? value - (static_cast<int64_t>(1) << 48) : value;
+        }
+
+        static uint32_t bank(uint32_t source)
+        {
+            return source & 3;
+        }
+
+        uint32_t read(uint32_t source, bool increments[4]) const
+        {
+            if (source >= ScuDsp::MC0)
+            {
+                increments[bank(source)] = true;
+            }
+
+            return ram[bank(source)][ct[bank(source)]];
+        }
+
+        void fail(size_t pc, const char *message)
+        {
+            if (error.empty())
+            {
+                char text[128];
+                std::snprintf(text, sizeof(text), "pc %zu: %s", pc, message);
+                error = text;
+            }
+        }
+
+        void setFlags32(uint32_t result)
+        {
+            flagS = (result & 0x80000000u) != 0;
+            flagZ = result == 0;
+        }
+
+        /** @brief ALU result as a 48-bit value, low word replaced for 32-bit ops */
+        int64_t with32(uint32_t low) const
+        {
+            return signExtend48((a & ~static_cast<int64_t>(0xFFFFFFFF)) | low);
+        }
+
+        void operation(size_t pc, uint32_t word)
+        {
+            const uint32_t aluOp = (word >> 26) & 0xF;
+            const uint32_t acl = static_cast<uint32_t>(a);
+            const uint32_t pl = static_cast<uint32_t>(p);
+            bool increments[4] = {false, false, false, false};
+            bool bankRead[4] = {false, false, false, false};
+
+            auto noteRead = [&](uint32_t source)
+            {
+                if (source <= ScuDsp::MC3)
+                {
+                    if (bankRead[bank(source)])
+                    {
+                        fail(pc, "bank read by two buses");
+                    }
+
+                    bankRead[bank(source)] = true;
+                }
+            };
+
+            // ALU, computed from A and P as they were at the start
+            switch (aluOp)
+            {
+            case ScuDsp::NOP:
+                break;
+            case ScuDsp::AND:
+                alu = with32(acl & pl);
+                setFlags32(acl & pl);
+                flagC = false;
+                break;
+            case ScuDsp::OR:
+                alu = with32(acl | pl);
+                setFlags32(acl | pl);
+                flagC = false;
+                break;
+            case ScuDsp::XOR:
+                alu = with32(acl ^ pl);
+                setFlags32(acl ^ pl);
+                flagC = false;
+                break;
+            case ScuDsp::ADD:
+            {
+                const uint64_t sum = static_cast<uint64_t>(acl) + pl;
+                alu = with32(static_cast<uint32_t>(sum));
+                setFlags32(static_cast<uint32_t>(sum));
+                flagC = (sum >> 32) != 0;
+                break;
+            }
+            case ScuDsp::SUB:
+            {
+                const uint32_t difference = acl - pl;
+                alu = with32(difference);
+                setFlags32(difference);
+                flagC = acl < pl;
+                break;
+            }
+            case ScuDsp::AD2:
+                alu = signExtend48(a + p);
+                flagS = alu < 0;
+                flagZ = alu == 0;
+                break;
+            case ScuDsp::RL8:
+            {
+                const uint32_t rotated = (acl << 8) | (acl >> 24);
+                alu = with32(rotated);
+                setFlags32(rotated);
+                flagC = (rotated & 1) != 0;
+                break;
+            }
+            default:
+                fail(pc, "ALU operation not modelled");
+                break;
+            }
+
+            // X bus
+            int32_t newRx = rx;
+            int64_t newP = p;
+
+            if (word & (1u << 25))
+            {
+                const uint32_t source = (word >> 20) & 7;
+                noteRead(source);
+                newRx = static_cast<int32_t>(read(source, increments));
+            }
+
+            switch ((word >> 23) & 3)
+            {
+            case 2:
+                newP = mul;
+                break;
+            case 3:
+            {
+                const uint32_t source = (word >> 20) & 7;
+
+                if (!(word & (1u << 25)))
+                {
+                    noteRead(source);
+                }
+
+                newP = static_cast<int32_t>(read(source, increments));
+                break;
+            }
+            default:
+                break;
+            }
+
+            // Y bus
+            int32_t newRy = ry;
+            int64_t newA = a;
+
+            if (word & (1u << 19))
+            {
+                const uint32_t source = (word >> 14) & 7;
+                noteRead(source);
+                newRy = static_cast<int32_t>(read(source, increments));
+            }
+
+            switch ((word >> 17) & 3)
+            {
+            case 1:
+                newA = 0;
+                break;
+            case 2:
+                if (aluOp == ScuDsp::NOP)
+                {
+                    fail(pc, "MOV ALU,A without ALU operation");
+                }
+
+                newA = alu;
+                break;
+            case 3:
+            {
+                const uint32_t source = (word >> 14) & 7;
+
+                if (!(word & (1u << 19)))
+                {
+                    noteRead(source);
+                }
+
+                newA = static_cast<int32_t>(read(source, increments));
+                break;
+            }
+            default:
+                break;
+            }
+
+            // D1 bus
+            const uint32_t d1 = (word >> 12) & 3;
+            int32_t ctWrite[4] = {-1, -1, -1, -1};
+
+            if (d1 == 1 || d1 == 3)
+            {
+                const uint32_t destination = (word >> 8) & 0xF;
+                uint32_t value = 0;
+
+                if (d1 == 1)
+                {
+                    value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(word & 0xFF)));
+                }
+                else
+                {
+                    const uint32_t source = word & 0xF;
+
+                    if (source == ScuDsp::ALL || source == ScuDsp::ALH)
+                    {
+                        if (aluOp != ScuDsp::NOP)
+                        {
+                            fail(pc, "ALL/ALH read next to an ALU operation");
+                        }
+
+                        value = source == ScuDsp::ALL ? static_cast<uint32_t>(alu)
+                                                      : static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(alu >> 32)));
+                    }
+                    else if (source <= ScuDsp::MC3)
+                    {
+                        noteRead(source);
+                        value = read(source, increments);
+                    }
+                    else
+                    {
+                        fail(pc, "D1 source not modelled");
+                    }
+                }
+
+                if (destination <= ScuDsp::DMC3)
+                {
+                    if (bankRead[destination])
+                    {
+                        fail(pc, "bank read and written in one instruction");
+                    }
+
+                    ram[destination][ct[destination]] = value;
+                    increments[destination] = true;
+                }
+                else if (destination == ScuDsp::RX)
+                {
+                    if (word & (1u << 25))
+                    {
+                        fail(pc, "RX written by two buses");
+                    }
+
+                    newRx = static_cast<int32_t>(value);
+                }
+                else if (destination == ScuDsp::PL)
+                {
+                    newP = static_cast<int32_t>(value);
+                }
+                else if (destination >= ScuDsp::CT0)
+                {
+                    ctWrite[destination - ScuDsp::CT0] = static_cast<int32_t>(value & 0x3F);
+                }
+                else
+                {
+                    fail(pc, "D1 destination not modelled");
+                }
+            }
+
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                if (ctWrite[i] >= 0)
+                {
+                    ct[i] = static_cast<uint8_t>(ctWrite[i]);
+                }
+                else if (increments[i])
+                {
+                    ct[i] = (ct[i] + 1) & 0x3F;
+                }
+            }
+
+            rx = newRx;
+            ry = newRy;
+            p = signExtend48(newP);
+            a = signExtend48(newA);
+        }
+
+        bool condition(uint32_t cond) const
+        {
+            if (!(cond & 0x40))
+            {
+                return true;
+            }
+
+            const bool any = ((cond & 1) && flagZ) || ((cond & 2) && flagS) || ((cond & 4) && flagC);
+            return (cond & 0x20) ? any : !any;
+        }
+
+    public:
+        ScuDspModel(const uint32_t *program, bool delaySlot) : program(program), delaySlot(delaySlot), cycles(0) {}
+
+        /** @brief Run the program on a data RAM image until END
+         * @return false on a lint violation or a runaway program
+         */
+        bool Run(uint32_t (&image)[4][ScuDsp::BankSize])
+        {
+            std::memcpy(ram, image, sizeof(ram));
+            std::memset(ct, 0, sizeof(ct));
+            a = p = alu = mul = 0;
+            rx = ry = 0;
+            flagS = flagZ = flagC = false;
+            error.clear();
+
+            size_t pc = 0;
+            int32_t pendingJump = -1;
+
+            for (uint64_t step = 0; step < 100000000 && error.empty(); ++step)
+            {
+                const uint32_t word = program[pc];
+                size_t next = pc + 1;
+
+                if (pendingJump >= 0)
+                {
+                    next = static_cast<size_t>(pendingJump);
+                    pendingJump = -1;
+                }
+
+                ++cycles;
+
+                if ((word >> 30) == 0)
+                {
+                    operation(pc, word);
+                }
+                else if ((word >> 30) == 2)
+                {
+                    const uint32_t destination = (word >> 26) & 0xF;
+                    int32_t immediate = static_cast<int32_t>(word & 0x1FFFFFF);
+
+                    if (immediate & 0x1000000)
+                    {
+                        immediate -= 0x2000000;
+                    }
+
+                    if ((word >> 25) & 1)
+                    {
+                        fail(pc, "conditional MVI not modelled");
+                    }
+                    else if (destination == ScuDsp::RX)
+                    {
+                        rx = immediate;
+                    }
+                    else if (destination == ScuDsp::PL)
+                    {
+                        p = immediate;
+                    }
+                    else
+                    {
+                        fail(pc, "MVI destination not modelled");
+                    }
+                }
+                else if ((word >> 28) == 0xD)
+                {
+                    if (condition((word >> 19) & 0x7F))
+                    {
+                        if (delaySlot)
+                        {
+                            pendingJump = static_cast<int32_t>(word & 0xFF);
+                        }
+                        else
+                        {
+                            next = word & 0xFF;
+                        }
+                    }
+
+                    if (program[pc + 1] != 0)
+                    {
+                        fail(pc, "jump without a NOP after it");
+                    }
+                }
+                else if ((word >> 28) == 0xF)
+                {
+                    std::memcpy(image, ram, sizeof(ram));
+                    return error.empty();
+                }
+                else
+                {
+                    fail(pc, "command not modelled");
+                }
+
+                mul = signExtend48(static_cast<int64_t>(rx) * ry);
+                pc = next;
+
+                if (pc >= ScuDsp::Program.size)
+                {
+                    fail(pc, "ran off the end of the program");
+                }
+            }
+
+            if (error.empty())
+            {
+                error = "no END reached";
+            }
+
+            return false;
+        }
+
+        const std::string &GetError() const { return error; }
+        uint64_t GetCycles() const { return cycles; }
+        void ResetCycles() { cycles = 0; }
+    };
+
+    /** @brief View checked against the kernel */
+    struct View
+    {
+        const char *name;
+        double minReal;
+        double maxReal;
+        double minImag;
+        double maxImag;
+    };
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t maxIterations = 100;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            maxIterations = static_cast<uint16_t>(std::atoi(argv[++i]));
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: dspsim [--iterations N]\n");
+            return 1;
+        }
+    }
+
+    const uint16_t width = 320;
+    const uint16_t height = 224;
+    const View views[] = {
+        {"default", -2.0, 1.0, -1.0, 1.0},
+        {"seahorse", -0.76, -0.72, 0.08, 0.12},
+        {"needle", -1.80, -1.70, -0.05, 0.05},
+    };
+
+    int failures = 0;
+
+    for (const bool delaySlot : {true, false})
+    {
+        for (const View &view : views)
+        {
+            ScuDspModel model(ScuDsp::Program.code, delaySlot);
+            model.ResetCycles();
+
+            const HostFxp minReal(view.minReal);
+            const HostFxp maxReal(view.maxReal);
+            const HostFxp minImag(view.minImag);
+            const HostFxp maxImag(view.maxImag);
+            const HostFxp stepReal = (maxReal - minReal) / HostFxp(width - 1);
+            const HostFxp stepImag = (maxImag - minImag) / HostFxp(height - 1);
+
+            uint64_t iterations = 0;
+            int mismatches = 0;
+
+            for (uint16_t y = 0; y < height && model.GetError().empty(); ++y)
+            {
+                for (uint16_t x = 0; x < width; x += ScuDsp::MaxBatch)
+                {
+                    const size_t count = std::min<size_t>(ScuDsp::MaxBatch, width - x);
+                    int32_t cReal[ScuDsp::MaxBatch];
+                    int32_t cImag[ScuDsp::MaxBatch];
+                    uint32_t image[4][ScuDsp::BankSize] = {};
+
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        cReal[i] = (minReal + HostFxp::BuildRaw(stepReal.RawValue() * static_cast<int32_t>(x + i))).RawValue();
+                        cImag[i] = (minImag + HostFxp::BuildRaw(stepImag.RawValue() * y)).RawValue();
+                    }
+
+                    ScuDsp::PrepareBatch(cReal, cImag, count, maxIterations, image);
+
+                    if (!model.Run(image))
+                    {
+                        std::printf("%s (%s delay slot): %s\n", view.name, delaySlot ? "with" : "without", model.GetError().c_str());
+                        ++failures;
+                        break;
+                    }
+
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        const uint16_t expected = IterateMandelbrot(HostFxp::BuildRaw(cReal[i]), HostFxp::BuildRaw(cImag[i]), maxIterations);
+                        iterations += expected;
+
+                        if (image[0][i] != expected && mismatches++ < 5)
+                        {
+                            std::printf("%s: pixel (%d,%d) dsp %u, kernel %u\n", view.name, x + static_cast<int>(i), y, image[0][i], expected);
+                        }
+                    }
+                }
+            }
+
+            failures += mismatches > 0 ? 1 : 0;
+            std::printf("%-8s %s delay slot: %d mismatches, %.1f DSP cycles per iteration\n",
+                        view.name,
+                        delaySlot ? "with   " : "without",
+                        mismatches,
+                        iterations > 0 ? static_cast<double>(model.GetCycles()) / static_cast<double>(iterations) : 0.0);
+        }
+    }
+
+    std::printf("%s (%zu program words)\n", failures == 0 ? "PASS" : "FAIL", ScuDsp::Program.size);
+    return failures == 0 ? 0 : 1;
+}
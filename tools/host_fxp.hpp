@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+/** @brief Host stand-in for the SRL 16.16 fixed-point type
+ *
+ * Reproduces the arithmetic of `SRL::Math::Types::Fxp` bit for bit (products
+ * keep bits 47..16 of the 64-bit result, as the SH2 dmuls.l/xtrct sequence
+ * does) so the host tools can compute the exact iteration counts the Saturn
+ * renders with `IterateMandelbrot<Fxp>`.
+ */
+class HostFxp
+{
+private:
+    int32_t value;
+
+public:
+    constexpr HostFxp() : value(0) {}
+    constexpr HostFxp(double number) : value(static_cast<int32_t>(number * 65536.0)) {}
+    constexpr HostFxp(int number) : value(number * 65536) {}
+
+    /** @brief Build from a raw 16.16 value */
+    static constexpr HostFxp BuildRaw(int32_t raw)
+    {
+        HostFxp result;
+        result.value = raw;
+        return result;
+    }
+
+    /** @brief Raw 16.16 value */
+    constexpr int32_t RawValue() const { return value; }
+
+    constexpr HostFxp operator+(const HostFxp &other) const { return BuildRaw(value + other.value); }
+    constexpr HostFxp operator-(const HostFxp &other) const { return BuildRaw(value - other.value); }
+    constexpr HostFxp operator-() const { return BuildRaw(-value); }
+
+    constexpr HostFxp operator*(const HostFxp &other) const
+    {
+        return BuildRaw(static_cast<int32_t>((static_cast<int64_t>(value) * other.value) >> 16));
+    }
+
+    constexpr HostFxp operator/(const HostFxp &other) const
+    {
+        return BuildRaw(static_cast<int32_t>((static_cast<int64_t>(value) * 65536) / other.value));
+    }
+
+    HostFxp &operator+=(const HostFxp &other) { return *this = *this + other; }
+    HostFxp &operator-=(const HostFxp &other) { return *this = *this - other; }
+
+    constexpr bool operator==(const HostFxp &other) const { return value == other.value; }
+    constexpr bool operator!=(const HostFxp &other) const { return value != other.value; }
+    constexpr bool operator<(const HostFxp &other) const { return value < other.value; }
+    constexpr bool operator>(const HostFxp &other) const { return value > other.value; }
+    constexpr bool operator<=(const HostFxp &other) const { return value <= other.value; }
+    constexpr bool operator>=(const HostFxp &other) const { return value >= other.value; }
+};
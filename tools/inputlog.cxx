@@ -0,0 +1,301 @@
+// Host tool for the pad input logs replayed by the renderer (InputMode::Replay).
+//
+// Logs reach the host as the "mil" hex lines the renderer prints at the end
+// of a recording, or are written by hand as a script of held buttons:
+//
+//   # frames  buttons (- for none)
+//   120       -
+//   1         A
+//   90        -
+//   40        Right
+//
+// Usage:
+//   inputlog decode CAPTURE.TXT OUT.MIL   hex lines of a captured log to a file
+//   inputlog encode SCRIPT.TXT OUT.MIL    script to a file
+//   inputlog print FILE.MIL               list the events of a file
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "input_log.hpp"
+
+namespace
+{
+    static constexpr struct
+    {
+        const char *name;
+        uint16_t bit;
+    } Buttons[] = {
+        {"Left", InputLog::Left},
+        {"Right", InputLog::Right},
+        {"Up", InputLog::Up},
+        {"Down", InputLog::Down},
+        {"A", InputLog::A},
+        {"B", InputLog::B},
+        {"C", InputLog::C},
+        {"X", InputLog::X},
+        {"Y", InputLog::Y},
+        {"Z", InputLog::Z},
+        {"L", InputLog::L},
+        {"R", InputLog::R},
+        {"Start", InputLog::Start}};
+
+    // Large enough for any session the console can record
+    using Recorder = InputRecorder<1 << 20>;
+
+    void usage()
+    {
+        std::fprintf(stderr,
+                     "usage: inputlog decode CAPTURE.TXT OUT.MIL\n"
+                     "       inputlog encode SCRIPT.TXT OUT.MIL\n"
+                     "       inputlog print FILE.MIL\n");
+    }
+
+    bool readFile(const char *path, std::vector<uint8_t> &data)
+    {
+        std::ifstream in(path, std::ios::binary);
+
+        if (!in)
+        {
+            std::perror(path);
+            return false;
+        }
+
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool writeFile(const char *path, const std::vector<uint8_t> &data)
+    {
+        FILE *file = std::fopen(path, "wb");
+
+        if (file == nullptr)
+        {
+            std::perror(path);
+            return false;
+        }
+
+        const bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        std::fclose(file);
+        return written;
+    }
+
+    int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        return c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+    }
+
+    /** @brief Collect the bytes of every "mil" line, whatever the emulator put before it */
+    bool decode(const char *capture, std::vector<uint8_t> &data)
+    {
+        std::ifstream in(capture);
+
+        if (!in)
+        {
+            std::perror(capture);
+            return false;
+        }
+
+        std::string line;
+
+        while (std::getline(in, line))
+        {
+            const size_t start = line.find("mil ");
+
+            if (start == std::string::npos)
+            {
+                continue;
+            }
+
+            for (size_t i = start + 4; i + 1 < line.size(); i += 2)
+            {
+                const int high = hexDigit(line[i]);
+                const int low = hexDigit(line[i + 1]);
+
+                if (high < 0 || low < 0)
+                {
+                    break;
+                }
+
+                data.push_back(static_cast<uint8_t>(high << 4 | low));
+            }
+        }
+
+        return true;
+    }
+
+    bool parseButtons(const std::string &word, uint16_t &mask)
+    {
+        if (word == "-")
+        {
+            return true;
+        }
+
+        for (const auto &button : Buttons)
+        {
+            if (word == button.name)
+            {
+                mask |= button.bit;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** @brief Record a script through the same recorder as the console */
+    bool encode(const char *script, std::vector<uint8_t> &data)
+    {
+        std::ifstream in(script);
+
+        if (!in)
+        {
+            std::perror(script);
+            return false;
+        }
+
+        static Recorder recorder;
+        std::string line;
+        int number = 0;
+
+        while (std::getline(in, line))
+        {
+            ++number;
+            line = line.substr(0, line.find('#'));
+            std::istringstream words(line);
+            long frames = 0;
+
+            if (!(words >> frames))
+            {
+                continue;
+            }
+
+            uint16_t mask = 0;
+            std::string word;
+
+            while (words >> word)
+            {
+                if (!parseButtons(word, mask))
+                {
+                    std::fprintf(stderr, "%s:%d: unknown button %s\n", script, number, word.c_str());
+                    return false;
+                }
+            }
+
+            for (long i = 0; i < frames; ++i)
+            {
+                if (!recorder.Record(mask))
+                {
+                    std::fprintf(stderr, "%s:%d: too many events\n", script, number);
+                    return false;
+                }
+            }
+        }
+
+        data.resize(InputLog::FileSize(recorder.GetEventCount()));
+        recorder.Write(data.data());
+        return true;
+    }
+
+    /** @brief List the events and check the file plays back to its frame count */
+    bool print(const std::vector<uint8_t> &data)
+    {
+        uint32_t frameCount = 0;
+        uint32_t eventCount = 0;
+
+        if (data.size() < InputLog::HeaderSize || !InputLog::ParseHeader(data.data(), frameCount, eventCount) ||
+            data.size() < InputLog::FileSize(eventCount))
+        {
+            std::fprintf(stderr, "not an input log or truncated\n");
+            return false;
+        }
+
+        std::printf("%u frames, %u events, %zu bytes\n", frameCount, eventCount, data.size());
+        uint32_t frame = 0;
+
+        for (uint32_t i = 0; i < eventCount; ++i)
+        {
+            const InputLog::Event event = InputLog::ReadEvent(data.data() + InputLog::HeaderSize + i * InputLog::EventSize);
+            frame += event.delay;
+            std::printf("%8u ", frame);
+
+            if (event.buttons == 0)
+            {
+                std::printf(" -");
+            }
+
+            for (const auto &button : Buttons)
+            {
+                if (event.buttons & button.bit)
+                {
+                    std::printf(" %s", button.name);
+                }
+            }
+
+            std::printf("\n");
+        }
+
+        InputReplayer replayer;
+        uint32_t played = 0;
+
+        if (!replayer.Open(data.data(), data.size()))
+        {
+            return false;
+        }
+
+        while (!replayer.IsDone())
+        {
+            replayer.Next();
+            ++played;
+        }
+
+        return played == frameCount;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && (std::strcmp(argv[1], "decode") == 0 || std::strcmp(argv[1], "encode") == 0))
+    {
+        std::vector<uint8_t> data;
+        const bool decoding = std::strcmp(argv[1], "decode") == 0;
+
+        if (!(decoding ? decode(argv[2], data) : encode(argv[2], data)))
+        {
+            return 1;
+        }
+
+        uint32_t frameCount = 0;
+        uint32_t eventCount = 0;
+
+        if (data.size() < InputLog::HeaderSize || !InputLog::ParseHeader(data.data(), frameCount, eventCount))
+        {
+            std::fprintf(stderr, "%s: no input log found\n", argv[2]);
+            return 1;
+        }
+
+        std::fprintf(stderr, "%u frames, %u events\n", frameCount, eventCount);
+        return writeFile(argv[3], data) ? 0 : 1;
+    }
+
+    if (argc == 3 && std::strcmp(argv[1], "print") == 0)
+    {
+        std::vector<uint8_t> data;
+        return readFile(argv[2], data) && print(data) ? 0 : 1;
+    }
+
+    usage();
+    return 1;
+}
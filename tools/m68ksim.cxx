@@ -0,0 +1,630 @@
+// Reference 68000 emulation for the sound CPU Mandelbrot program.
+//
+// Loads SoundCpu::Program into a model of the MC68EC000 and its sound RAM,
+// drives it through the mailbox the way SoundCpuWorker does and checks every
+// pixel of a set of views against IterateMandelbrot on a bit-exact host Fxp.
+// It also cancels batches part way and checks that the program stops within
+// one iteration and that the counts it did store are right.
+//
+// The model decodes the instruction fields rather than matching the words
+// the assembler emits, so an encoding mistake shows up as a wrong result or
+// an unmodelled instruction. Cycle counts follow the 68000 timing tables.
+//
+// Usage:
+//   m68ksim [--iterations N]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "host_fxp.hpp"
+#include "m68k_program.hpp"
+#include "mandelbrot_kernel.hpp"
+
+namespace
+{
+    /** @brief Model of the 68000, limited to what the program uses */
+    class M68kModel
+    {
+    private:
+        static constexpr uint32_t RamSize = 512 * 1024;
+
+        std::vector<uint8_t> ram;
+        uint32_t d[8];
+        uint32_t a[8];
+        uint32_t pc;
+        bool flagN;
+        bool flagZ;
+        bool flagV;
+        bool flagC;
+        uint64_t cycles;
+        uint64_t instructions;
+        std::string error;
+
+        /** @brief Decoded effective address */
+        struct Operand
+        {
+            uint8_t mode;
+            uint8_t reg;
+            uint32_t address; ///< Memory operands
+            uint32_t value;   ///< Immediates
+        };
+
+        void fail(uint32_t at, const char *message)
+        {
+            if (error.empty())
+            {
+                char text[128];
+                std::snprintf(text, sizeof(text), "pc %06X: %s", at, message);
+                error = text;
+            }
+        }
+
+        uint32_t read(uint32_t address, uint8_t size)
+        {
+            address &= 0xFFFFFF;
+
+            if (address + size > RamSize || (size > 1 && (address & 1) != 0))
+            {
+                fail(pc, "bad memory access");
+                return 0;
+            }
+
+            uint32_t value = 0;
+
+            for (uint8_t i = 0; i < size; ++i)
+            {
+                value = (value << 8) | ram[address + i];
+            }
+
+            return value;
+        }
+
+        void write(uint32_t address, uint8_t size, uint32_t value)
+        {
+            address &= 0xFFFFFF;
+
+            if (address + size > RamSize || (size > 1 && (address & 1) != 0))
+            {
+                fail(pc, "bad memory access");
+                return;
+            }
+
+            for (uint8_t i = 0; i < size; ++i)
+            {
+                ram[address + i] = static_cast<uint8_t>(value >> (8 * (size - 1 - i)));
+            }
+        }
+
+        uint16_t fetch()
+        {
+            const uint16_t word = static_cast<uint16_t>(read(pc, 2));
+            pc += 2;
+            return word;
+        }
+
+        static uint32_t mask(uint8_t size)
+        {
+            return size == 4 ? 0xFFFFFFFFu : (1u << (8 * size)) - 1;
+        }
+
+        static bool negative(uint32_t value, uint8_t size)
+        {
+            return (value >> (8 * size - 1)) & 1;
+        }
+
+        /** @brief Decode an effective address, fetching its extension words */
+        Operand decode(uint8_t mode, uint8_t reg, uint8_t size)
+        {
+            Operand op{mode, reg, 0, 0};
+
+            switch (mode)
+            {
+            case 0:
+            case 1:
+                break;
+            case 2:
+                op.address = a[reg];
+                cycles += size == 4 ? 8 : 4;
+                break;
+            case 3:
+                op.address = a[reg];
+                a[reg] += size;
+                cycles += size == 4 ? 8 : 4;
+                break;
+            case 5:
+                op.address = a[reg] + static_cast<uint32_t>(static_cast<int16_t>(fetch()));
+                cycles += size == 4 ? 12 : 8;
+                break;
+            case 7:
+                if (reg == 4)
+                {
+                    op.value = fetch();
+
+                    if (size == 4)
+                    {
+                        op.value = (op.value << 16) | fetch();
+                    }
+
+                    op.value &= mask(size);
+                    cycles += size == 4 ? 8 : 4;
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                fail(pc, "addressing mode not modelled");
+            }
+
+            return op;
+        }
+
+        uint32_t load(const Operand &op, uint8_t size)
+        {
+            switch (op.mode)
+            {
+            case 0:
+                return d[op.reg] & mask(size);
+            case 1:
+                return a[op.reg] & mask(size);
+            case 7:
+                return op.value;
+            default:
+                return read(op.address, size);
+            }
+        }
+
+        void store(const Operand &op, uint8_t size, uint32_t value)
+        {
+            switch (op.mode)
+            {
+            case 0:
+                d[op.reg] = (d[op.reg] & ~mask(size)) | (value & mask(size));
+                break;
+            case 1:
+                a[op.reg] = value;
+                break;
+            case 7:
+                fail(pc, "store to an immediate");
+                break;
+            default:
+                write(op.address, size, value);
+            }
+        }
+
+        void setLogic(uint32_t value, uint8_t size)
+        {
+            flagN = negative(value, size);
+            flagZ = (value & mask(size)) == 0;
+            flagV = false;
+            flagC = false;
+        }
+
+        uint32_t add(uint32_t x, uint32_t y, uint8_t size)
+        {
+            const uint32_t result = (x + y) & mask(size);
+            flagN = negative(result, size);
+            flagZ = result == 0;
+            flagV = negative(~(x ^ y) & (x ^ result), size);
+            flagC = static_cast<uint64_t>(x & mask(size)) + (y & mask(size)) > mask(size);
+            return result;
+        }
+
+        /** @brief x - y with the flags of SUB and CMP */
+        uint32_t subtract(uint32_t x, uint32_t y, uint8_t size)
+        {
+            const uint32_t result = (x - y) & mask(size);
+            flagN = negative(result, size);
+            flagZ = result == 0;
+            flagV = negative((x ^ y) & (x ^ result), size);
+            flagC = (y & mask(size)) > (x & mask(size));
+            return result;
+        }
+
+        bool condition(uint8_t cond) const
+        {
+            switch (cond)
+            {
+            case 0x0:
+                return true;
+            case 0x4:
+                return !flagC;
+            case 0x6:
+                return !flagZ;
+            case 0x7:
+                return flagZ;
+            case 0xA:
+                return !flagN;
+            case 0xE:
+                return !flagZ && flagN == flagV;
+            default:
+                return false;
+            }
+        }
+
+        static uint8_t moveSize(uint16_t word)
+        {
+            switch (word >> 12)
+            {
+            case 1:
+                return 1;
+            case 2:
+                return 4;
+            default:
+                return 2;
+            }
+        }
+
+        void step()
+        {
+            const uint32_t at = pc;
+            const uint16_t word = fetch();
+            const uint8_t line = word >> 12;
+            const uint8_t reg = (word >> 9) & 7;
+            const uint8_t opmode = (word >> 6) & 7;
+            const uint8_t eaMode = (word >> 3) & 7;
+            const uint8_t eaReg = word & 7;
+            ++instructions;
+
+            if (line >= 1 && line <= 3)
+            {
+                // MOVE and MOVEA
+                const uint8_t size = moveSize(word);
+                const Operand src = decode(eaMode, eaReg, size);
+                const uint32_t value = load(src, size);
+                const Operand dst = decode(opmode, reg, size);
+                cycles += 4;
+
+                if (dst.mode == 1)
+                {
+                    store(dst, 4, size == 2 ? static_cast<uint32_t>(static_cast<int16_t>(value)) : value);
+                }
+                else
+                {
+                    store(dst, size, value);
+                    setLogic(value, size);
+                }
+            }
+            else if (line == 7 && (word & 0x100) == 0)
+            {
+                d[reg] = static_cast<uint32_t>(static_cast<int8_t>(word & 0xFF));
+                setLogic(d[reg], 4);
+                cycles += 4;
+            }
+            else if ((word & 0xF1C0) == 0x41C0)
+            {
+                // Only the address is computed, LEA d16(An) takes 8 cycles
+                const uint64_t before = cycles;
+                const Operand src = decode(eaMode, eaReg, 4);
+                a[reg] = src.address;
+                cycles = before + 8;
+            }
+            else if ((word & 0xFFF8) == 0x4840)
+            {
+                d[eaReg] = (d[eaReg] >> 16) | (d[eaReg] << 16);
+                setLogic(d[eaReg], 4);
+                cycles += 4;
+            }
+            else if ((word & 0xFF00) == 0x4200 || (word & 0xFF00) == 0x4A00)
+            {
+                // CLR and TST
+                const uint8_t size = static_cast<uint8_t>(1 << ((word >> 6) & 3));
+                const Operand op = decode(eaMode, eaReg, size);
+                const bool clear = (word & 0xFF00) == 0x4200;
+                const uint32_t value = clear ? 0 : load(op, size);
+
+                if (clear)
+                {
+                    store(op, size, 0);
+                    cycles += op.mode == 0 ? (size == 4 ? 6 : 4) : 8;
+                }
+                else
+                {
+                    cycles += 4;
+                }
+
+                setLogic(value, size);
+            }
+            else if ((word & 0xFFC0) == 0x0C80)
+            {
+                const Operand imm = decode(7, 4, 4);
+                const Operand op = decode(eaMode, eaReg, 4);
+                subtract(load(op, 4), imm.value, 4);
+                cycles += op.mode == 0 ? 6 : 4;
+            }
+            else if (line == 5 && (word & 0x100) == 0 && opmode != 3)
+            {
+                // ADDQ, to an address register without flags
+                const uint8_t size = static_cast<uint8_t>(1 << opmode);
+                const uint32_t value = reg == 0 ? 8 : reg;
+                const Operand op = decode(eaMode, eaReg, size);
+
+                if (op.mode == 1)
+                {
+                    a[eaReg] += value;
+                    cycles += 8;
+                }
+                else
+                {
+                    store(op, size, add(load(op, size), value, size));
+                    cycles += op.mode == 0 ? (size == 4 ? 8 : 4) : 8;
+                }
+            }
+            else if (line == 6)
+            {
+                const uint8_t cond = (word >> 8) & 0xF;
+                int32_t displacement = static_cast<int8_t>(word & 0xFF);
+                const uint32_t base = pc;
+                const bool wide = displacement == 0;
+
+                if (wide)
+                {
+                    displacement = static_cast<int16_t>(fetch());
+                }
+
+                if (cond == 1)
+                {
+                    fail(at, "BSR not modelled");
+                }
+                else if (condition(cond))
+                {
+                    pc = base + static_cast<uint32_t>(displacement);
+                    cycles += 10;
+                }
+                else
+                {
+                    cycles += wide ? 12 : 8;
+                }
+            }
+            else if (line == 0xC && opmode == 3)
+            {
+                const Operand src = decode(eaMode, eaReg, 2);
+                const uint32_t x = load(src, 2);
+                d[reg] = x * (d[reg] & 0xFFFF);
+                setLogic(d[reg], 4);
+                cycles += 38 + 2 * static_cast<uint64_t>(__builtin_popcount(x));
+            }
+            else if ((line == 0xD || line == 9) && opmode != 3 && opmode != 7 && (opmode & 4) == 0)
+            {
+                // ADD and SUB <ea>,Dn
+                const uint8_t size = static_cast<uint8_t>(1 << opmode);
+                const Operand src = decode(eaMode, eaReg, size);
+                const uint32_t value = load(src, size);
+                const uint32_t result = line == 0xD ? add(d[reg], value, size) : subtract(d[reg], value, size);
+                d[reg] = (d[reg] & ~mask(size)) | result;
+                cycles += size == 4 ? (src.mode <= 1 || src.mode == 7 ? 8 : 6) : 4;
+            }
+            else if (line == 0xD && opmode == 7)
+            {
+                const Operand src = decode(eaMode, eaReg, 4);
+                a[reg] += load(src, 4);
+                cycles += 8;
+            }
+            else if (line == 0xB && opmode <= 2)
+            {
+                const uint8_t size = static_cast<uint8_t>(1 << opmode);
+                const Operand src = decode(eaMode, eaReg, size);
+                subtract(d[reg], load(src, size), size);
+                cycles += size == 4 ? 6 : 4;
+            }
+            else if (line == 0xB && opmode == 7)
+            {
+                const Operand src = decode(eaMode, eaReg, 4);
+                subtract(a[reg], load(src, 4), 4);
+                cycles += 6;
+            }
+            else
+            {
+                fail(at, "instruction not modelled");
+            }
+        }
+
+    public:
+        M68kModel() : ram(RamSize, 0), d(), a(), pc(0), flagN(false), flagZ(false), flagV(false), flagC(false), cycles(0), instructions(0)
+        {
+        }
+
+        /** @brief Write the vectors and the program, as SoundCpuWorker does, and reset */
+        void Load()
+        {
+            write(0, 4, SoundCpu::StackTop);
+            write(4, 4, SoundCpu::ProgramAddress);
+
+            for (size_t i = 0; i < SoundCpu::Program.size; ++i)
+            {
+                write(SoundCpu::ProgramAddress + 2 * static_cast<uint32_t>(i), 2, SoundCpu::Program.code[i]);
+            }
+
+            a[7] = read(0, 4);
+            pc = read(4, 4);
+        }
+
+        uint16_t Mailbox(uint16_t slot) { return static_cast<uint16_t>(read(SoundCpu::MailboxAddress + 2 * slot, 2)); }
+
+        void SetMailbox(uint16_t slot, uint16_t value) { write(SoundCpu::MailboxAddress + 2 * slot, 2, value); }
+
+        /** @brief Run until Slot::Command is clear or the instruction limit
+         * @return Instructions executed
+         */
+        uint64_t RunWhileBusy(uint64_t limit)
+        {
+            const uint64_t start = instructions;
+
+            while (Mailbox(SoundCpu::Slot::Command) != 0 && error.empty())
+            {
+                if (instructions - start >= limit)
+                {
+                    fail(pc, "batch did not end");
+                    break;
+                }
+
+                step();
+            }
+
+            return instructions - start;
+        }
+
+        /** @brief Run a fixed number of instructions */
+        void Run(uint64_t count)
+        {
+            for (uint64_t i = 0; i < count && error.empty(); ++i)
+            {
+                step();
+            }
+        }
+
+        const std::string &GetError() const { return error; }
+        uint64_t GetCycles() const { return cycles; }
+        void ResetCycles() { cycles = 0; }
+    };
+
+    /** @brief View checked against the kernel */
+    struct View
+    {
+        const char *name;
+        double minReal;
+        double maxReal;
+        double minImag;
+        double maxImag;
+    };
+
+    /** @brief Write a batch into the model's mailbox and start it, as SoundCpuWorker::Submit() does */
+    void submit(M68kModel &model, const int32_t *cReal, const int32_t *cImag, size_t count, uint16_t maxIterations)
+    {
+        uint16_t mailbox[SoundCpu::Slot::Words] = {};
+        SoundCpu::PrepareBatch(cReal, cImag, count, maxIterations, mailbox);
+
+        for (uint16_t i = 0; i < SoundCpu::Slot::Words; ++i)
+        {
+            model.SetMailbox(i, mailbox[i]);
+        }
+
+        model.SetMailbox(SoundCpu::Slot::Command, 1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t maxIterations = 100;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            maxIterations = static_cast<uint16_t>(std::atoi(argv[++i]));
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: m68ksim [--iterations N]\n");
+            return 1;
+        }
+    }
+
+    const uint16_t width = 320;
+    const uint16_t height = 224;
+    const View views[] = {
+        {"default", -2.0, 1.0, -1.0, 1.0},
+        {"seahorse", -0.76, -0.72, 0.08, 0.12},
+        {"needle", -1.80, -1.70, -0.05, 0.05},
+    };
+
+    // Instructions of one iteration, with room for the pixel setup: the bound on cancelling
+    const uint64_t cancelBound = 256;
+    int failures = 0;
+
+    for (const View &view : views)
+    {
+        M68kModel model;
+        model.Load();
+
+        const HostFxp minReal(view.minReal);
+        const HostFxp maxReal(view.maxReal);
+        const HostFxp minImag(view.minImag);
+        const HostFxp maxImag(view.maxImag);
+        const HostFxp stepReal = (maxReal - minReal) / HostFxp(width - 1);
+        const HostFxp stepImag = (maxImag - minImag) / HostFxp(height - 1);
+
+        uint64_t iterations = 0;
+        uint64_t batchCycles = 0; ///< Cycles of the batches that ran to the end
+        uint64_t cancelSteps = 0;
+        int mismatches = 0;
+        int cancels = 0;
+
+        for (uint16_t y = 0; y < height && model.GetError().empty(); ++y)
+        {
+            for (uint16_t x = 0; x < width && model.GetError().empty(); x += SoundCpu::MaxBatch)
+            {
+                const size_t count = std::min<size_t>(SoundCpu::MaxBatch, width - x);
+                int32_t cReal[SoundCpu::MaxBatch];
+                int32_t cImag[SoundCpu::MaxBatch];
+                uint16_t expected[SoundCpu::MaxBatch];
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    cReal[i] = (minReal + HostFxp::BuildRaw(stepReal.RawValue() * static_cast<int32_t>(x + i))).RawValue();
+                    cImag[i] = (minImag + HostFxp::BuildRaw(stepImag.RawValue() * y)).RawValue();
+                    expected[i] = IterateMandelbrot(HostFxp::BuildRaw(cReal[i]), HostFxp::BuildRaw(cImag[i]), maxIterations);
+                }
+
+                submit(model, cReal, cImag, count, maxIterations);
+
+                // Every 16th row is cancelled part way, like a row the master finished first
+                const bool cancel = y % 16 == 8;
+
+                if (cancel)
+                {
+                    model.Run(static_cast<uint64_t>(x + 1) * 37);
+                    model.SetMailbox(SoundCpu::Slot::Cancel, 1);
+                    const uint64_t steps = model.RunWhileBusy(cancelBound);
+                    cancelSteps = std::max(cancelSteps, steps);
+                    ++cancels;
+                }
+                else
+                {
+                    model.ResetCycles();
+                    model.RunWhileBusy(static_cast<uint64_t>(count) * (maxIterations + 1) * cancelBound);
+                    batchCycles += model.GetCycles();
+                }
+
+                if (!model.GetError().empty())
+                {
+                    std::printf("%s: %s\n", view.name, model.GetError().c_str());
+                    ++failures;
+                    break;
+                }
+
+                const uint16_t done = model.Mailbox(SoundCpu::Slot::Done);
+
+                if (done > count || (!cancel && done != count))
+                {
+                    std::printf("%s: row %d stored %u of %zu counts\n", view.name, y, done, count);
+                    ++mismatches;
+                }
+
+                for (size_t i = 0; i < std::min<size_t>(done, count); ++i)
+                {
+                    const uint16_t result = model.Mailbox(static_cast<uint16_t>(SoundCpu::Slot::Results + i));
+                    iterations += cancel ? 0 : expected[i];
+
+                    if (result != expected[i] && mismatches++ < 5)
+                    {
+                        std::printf("%s: pixel (%d,%d) 68000 %u, kernel %u\n", view.name, x + static_cast<int>(i), y, result, expected[i]);
+                    }
+                }
+            }
+        }
+
+        failures += mismatches > 0 ? 1 : 0;
+        std::printf("%-8s %d mismatches, %d cancels stopped within %llu instructions, %.1f cycles per iteration\n",
+                    view.name,
+                    mismatches,
+                    cancels,
+                    static_cast<unsigned long long>(cancelSteps),
+                    iterations > 0 ? static_cast<double>(batchCycles) / static_cast<double>(iterations) : 0.0);
+    }
+
+    std::printf("%s (%zu program words)\n", failures == 0 ? "PASS" : "FAIL", SoundCpu::Program.size);
+    return failures == 0 ? 0 : 1;
+}
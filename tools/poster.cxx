@@ -0,0 +1,344 @@
+// Out-of-core poster renderer.
+//
+// Renders an image of any size, 65536x65536 and beyond, one tile at a time
+// on every core with the shared Mandelbrot kernel, and streams each finished
+// tile into a tiled image file (see tiled_image.hpp). Memory holds a tile per
+// thread and the touched pages of the index, whatever the image size. Run
+// again with the same arguments after a crash or an interrupt, the tiles
+// already in the file are skipped. Pixel steps too fine for double are
+// rendered in double-double.
+//
+// Usage:
+//   poster [--center RE IM] [--span SPAN] [--size WxH] [--tile N]
+//          [--iterations N] [--threads N] --out FILE
+//   poster --extract FILE X Y WxH OUT.pgm
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "double_double.hpp"
+#include "mandelbrot_kernel.hpp"
+#include "thread_pool.hpp"
+#include "tiled_image.hpp"
+
+namespace
+{
+    /** @brief Render settings, the default view matches the Saturn renderer */
+    struct Options
+    {
+        DoubleDouble centerReal = DoubleDouble(-0.5);
+        DoubleDouble centerImag = DoubleDouble(0.0);
+        double span = 3.0; ///< Real span, pixels are square
+        uint32_t width = 16384;
+        uint32_t height = 16384;
+        int tile = 256;
+        int iterations = 1024;
+        int threads = 0; ///< 0 for one per hardware thread
+        std::string out;
+    };
+
+    constexpr uint32_t MaxSide = 1u << 20;  ///< Pixels on a side
+    constexpr uint64_t MaxTiles = 1u << 24; ///< Tiles of an image, an index of at most 256MB to map and validate
+
+    void usage()
+    {
+        std::fprintf(stderr,
+                     "usage: poster [--center RE IM] [--span SPAN] [--size WxH] [--tile N]\n"
+                     "              [--iterations N] [--threads N] --out FILE\n"
+                     "       poster --extract FILE X Y WxH OUT.pgm\n");
+    }
+
+    bool parse(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "--center" && i + 2 < argc)
+            {
+                const bool real = DoubleDouble::Parse(argv[++i], options.centerReal);
+
+                if (!DoubleDouble::Parse(argv[++i], options.centerImag) || !real)
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--span" && hasValue)
+            {
+                options.span = std::atof(argv[++i]);
+            }
+            else if (arg == "--size" && hasValue)
+            {
+                if (std::sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2)
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--tile" && hasValue)
+            {
+                options.tile = std::atoi(argv[++i]);
+            }
+            else if (arg == "--iterations" && hasValue)
+            {
+                options.iterations = std::atoi(argv[++i]);
+            }
+            else if (arg == "--threads" && hasValue)
+            {
+                options.threads = std::atoi(argv[++i]);
+            }
+            else if (arg == "--out" && hasValue)
+            {
+                options.out = argv[++i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if (options.out.empty() || options.span <= 0.0 ||
+            options.width <= 1 || options.height <= 1 || options.width > MaxSide || options.height > MaxSide ||
+            options.tile < 16 || options.tile > 4096 ||
+            options.iterations <= 0 || options.iterations > 0xFFFF || options.threads < 0)
+        {
+            return false;
+        }
+
+        const uint64_t tile = static_cast<uint64_t>(options.tile);
+        const uint64_t tiles = ((options.width + tile - 1) / tile) * ((options.height + tile - 1) / tile);
+
+        if (tiles > MaxTiles)
+        {
+            std::fprintf(stderr, "%ux%u in tiles of %d is %llu tiles, more than %llu: raise --tile\n",
+                         options.width, options.height, options.tile,
+                         static_cast<unsigned long long>(tiles), static_cast<unsigned long long>(MaxTiles));
+            return false;
+        }
+
+        return true;
+    }
+
+    /** @brief Render one tile into palette indices, mapped like the zoom encoder */
+    template <typename RealT>
+    void renderTile(const TiledImage &image, size_t tile, const DoubleDouble &minReal, const DoubleDouble &minImag,
+                    const DoubleDouble &step, std::vector<uint8_t> &pixels)
+    {
+        uint32_t left;
+        uint32_t top;
+        uint32_t width;
+        uint32_t height;
+        image.GetRect(tile, left, top, width, height);
+        pixels.resize(static_cast<size_t>(width) * height);
+
+        const uint16_t iterations = image.GetHeader().iterations;
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const RealT imag = static_cast<RealT>(minImag + step * DoubleDouble(static_cast<double>(top + y)));
+
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const RealT real = static_cast<RealT>(minReal + step * DoubleDouble(static_cast<double>(left + x)));
+                pixels[y * width + x] = static_cast<uint8_t>(IterateMandelbrot(real, imag, iterations) % 256);
+            }
+        }
+    }
+
+    int render(const Options &options)
+    {
+        TiledImage::Header header = TiledImage::MakeHeader(options.width, options.height,
+                                                           static_cast<uint16_t>(options.tile),
+                                                           static_cast<uint16_t>(options.iterations));
+        header.centerReal[0] = options.centerReal.High();
+        header.centerReal[1] = options.centerReal.Low();
+        header.centerImag[0] = options.centerImag.High();
+        header.centerImag[1] = options.centerImag.Low();
+        header.span = options.span;
+
+        TiledImage image;
+        size_t resumed;
+        std::string error;
+
+        if (!image.Create(options.out, header, resumed, error))
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        const DoubleDouble step = DoubleDouble(options.span) / DoubleDouble(static_cast<double>(options.width - 1));
+        const DoubleDouble minReal = options.centerReal - step * DoubleDouble((options.width - 1) / 2.0);
+        const DoubleDouble minImag = options.centerImag - step * DoubleDouble((options.height - 1) / 2.0);
+        const bool deep = step.High() < DoubleDoubleStep;
+        const size_t tiles = image.GetTileCount();
+
+        ThreadPool pool(static_cast<unsigned>(options.threads));
+        std::vector<std::vector<uint8_t>> pixels(pool.GetSize());
+        std::vector<std::vector<uint8_t>> scratch(pool.GetSize());
+        std::atomic<size_t> finished{resumed};
+        std::atomic<uint64_t> rendered{0};
+        std::atomic<bool> failed{false};
+        const auto start = std::chrono::steady_clock::now();
+
+        std::printf("%s: %ux%u in %zu tiles of %d, %zu already done, %s, %u threads\n",
+                    options.out.c_str(), options.width, options.height, tiles, options.tile, resumed,
+                    deep ? "double-double" : "double", pool.GetSize());
+
+        pool.ForEach(tiles, [&](size_t tile, unsigned thread)
+                     {
+                         if (image.HasTile(tile) || failed)
+                         {
+                             return;
+                         }
+
+                         if (deep)
+                         {
+                             renderTile<DoubleDouble>(image, tile, minReal, minImag, step, pixels[thread]);
+                         }
+                         else
+                         {
+                             renderTile<double>(image, tile, minReal, minImag, step, pixels[thread]);
+                         }
+
+                         if (!image.WriteTile(tile, pixels[thread].data(), scratch[thread]))
+                         {
+                             failed = true;
+                             return;
+                         }
+
+                         rendered += pixels[thread].size();
+                         const size_t done = ++finished;
+
+                         if (done % 64 == 0 || done == tiles)
+                         {
+                             std::fprintf(stderr, "\rtile %zu/%zu", done, tiles);
+                         }
+                     });
+
+        image.Close();
+        std::fprintf(stderr, "\n");
+
+        if (failed)
+        {
+            std::fprintf(stderr, "%s: write failed, run again to resume\n", options.out.c_str());
+            return 1;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%s: %zu tiles rendered in %.1f s, %.1f Mpixels/s\n",
+                    options.out.c_str(), tiles - resumed, seconds,
+                    seconds > 0.0 ? static_cast<double>(rendered) / seconds / 1e6 : 0.0);
+        return 0;
+    }
+
+    /** @brief Copy a rectangle of a tiled image into a binary PGM of its palette indices */
+    int extract(int argc, char **argv)
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+
+        if (argc != 7 || std::sscanf(argv[3], "%u", &x) != 1 || std::sscanf(argv[4], "%u", &y) != 1 ||
+            std::sscanf(argv[5], "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+        {
+            usage();
+            return 1;
+        }
+
+        TiledImage image;
+        std::string error;
+
+        if (!image.Open(argv[2], error))
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        const TiledImage::Header &header = image.GetHeader();
+
+        if (x >= header.width || y >= header.height)
+        {
+            std::fprintf(stderr, "%s: rectangle outside the %ux%u image\n", argv[2], header.width, header.height);
+            return 1;
+        }
+
+        width = std::min(width, header.width - x);
+        height = std::min(height, header.height - y);
+
+        std::vector<uint8_t> out(static_cast<size_t>(width) * height, 0);
+        std::vector<uint8_t> pixels;
+        size_t missing = 0;
+
+        for (uint32_t row = y / header.tileSize; row <= (y + height - 1) / header.tileSize; ++row)
+        {
+            for (uint32_t column = x / header.tileSize; column <= (x + width - 1) / header.tileSize; ++column)
+            {
+                const size_t tile = static_cast<size_t>(row) * image.GetColumns() + column;
+                uint32_t left;
+                uint32_t top;
+                uint32_t tileWidth;
+                uint32_t tileHeight;
+                image.GetRect(tile, left, top, tileWidth, tileHeight);
+
+                if (!image.ReadTile(tile, pixels))
+                {
+                    ++missing; // Left black
+                    continue;
+                }
+
+                for (uint32_t line = std::max(top, y); line < std::min(top + tileHeight, y + height); ++line)
+                {
+                    for (uint32_t pixel = std::max(left, x); pixel < std::min(left + tileWidth, x + width); ++pixel)
+                    {
+                        out[(line - y) * width + pixel - x] = pixels[(line - top) * tileWidth + pixel - left];
+                    }
+                }
+            }
+        }
+
+        FILE *file = std::fopen(argv[6], "wb");
+
+        if (file == nullptr)
+        {
+            std::perror(argv[6]);
+            return 1;
+        }
+
+        std::fprintf(file, "P5\n%u %u\n255\n", width, height);
+        const bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+        std::fclose(file);
+
+        if (!written)
+        {
+            std::fprintf(stderr, "%s: write failed\n", argv[6]);
+            return 1;
+        }
+
+        std::printf("%s: %ux%u at %u,%u%s\n", argv[6], width, height, x, y,
+                    missing > 0 ? ", some tiles missing" : "");
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--extract")
+    {
+        return extract(argc, argv);
+    }
+
+    Options options;
+
+    if (!parse(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+
+    return render(options);
+}
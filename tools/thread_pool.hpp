@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** @brief Fixed set of host threads sharing indexed work
+ *
+ * ForEach() hands the indices of a loop to every thread through one atomic
+ * counter, so a loop of millions of tiles takes no memory per item, and
+ * returns once all of them are done. The threads live as long as the pool
+ * and sleep between loops.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    std::function<void(size_t, unsigned)> body; ///< Work of the current loop, (index, thread)
+    std::atomic<size_t> next{0};
+    size_t count = 0;
+    unsigned generation = 0; ///< Loops started, tells the threads a new one is there
+    unsigned running = 0;    ///< Threads still in the current loop
+    bool stopping = false;
+
+    /** @brief Take indices of the current loop until there are none left */
+    void drain(unsigned thread)
+    {
+        for (size_t index = next++; index < count; index = next++)
+        {
+            body(index, thread);
+        }
+    }
+
+    void run(unsigned thread)
+    {
+        unsigned seen = 0;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&]() { return stopping || generation != seen; });
+
+                if (stopping)
+                {
+                    return;
+                }
+
+                seen = generation;
+            }
+
+            drain(thread);
+
+            std::lock_guard<std::mutex> guard(lock);
+
+            if (--running == 0)
+            {
+                idle.notify_all();
+            }
+        }
+    }
+
+public:
+    /** @param size Threads, 0 for one per hardware thread */
+    explicit ThreadPool(unsigned size = 0)
+    {
+        size = size > 0 ? size : std::max(1u, std::thread::hardware_concurrency());
+
+        // The calling thread works too
+        for (unsigned i = 1; i < size; ++i)
+        {
+            threads.emplace_back(&ThreadPool::run, this, i);
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+
+        wake.notify_all();
+
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /** @brief Threads working on a loop, the calling one included */
+    unsigned GetSize() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+    /** @brief Run work(index, thread) for every index below count, on all threads
+     *
+     * `thread` is below GetSize() and unique among the calls running at the
+     * same time, to pick per-thread buffers. Not reentrant.
+     */
+    template <typename Work>
+    void ForEach(size_t items, Work &&work)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            body = std::ref(work);
+            count = items;
+            next = 0;
+            running = static_cast<unsigned>(threads.size());
+            ++generation;
+        }
+
+        wake.notify_all();
+        drain(0);
+
+        std::unique_lock<std::mutex> guard(lock);
+        idle.wait(guard, [&]() { return running == 0; });
+        body = nullptr;
+    }
+};
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "zoom_stream_format.hpp"
+
+/** @brief Tiled image container for host renders larger than memory
+ *
+ * File layout, host byte order:
+ * - Header: magic "MTI1", image and tile size, and the view it shows.
+ * - Index: one Entry per tile, row-major. An entry whose offset is 0 has no
+ *   tile yet.
+ * - Tiles, in the order they were finished: palette indices of a tile, row
+ *   by row, PackBits encoded like the zoom stream frames.
+ *
+ * The index is memory-mapped, so it costs the pages being touched and
+ * nothing else. A tile is appended first and its entry filled in after, its
+ * offset last. A file left behind by a crash therefore only lists tiles that
+ * are on disk, and the checksum catches a tile torn by a power loss. Opening
+ * it again with the same header resumes: invalid entries are cleared and the
+ * caller skips the tiles HasTile() reports.
+ */
+class TiledImage
+{
+public:
+    static constexpr uint8_t Magic[4] = {'M', 'T', 'I', '1'};
+
+    /** @brief Image description stored at the start of the file */
+    struct Header
+    {
+        uint8_t magic[4];
+        uint16_t tileSize;
+        uint16_t iterations;
+        uint32_t width;
+        uint32_t height;
+        double centerReal[2]; ///< High and low parts of a double-double
+        double centerImag[2];
+        double span;          ///< Real span, pixels are square
+        uint8_t reserved[8];
+    };
+
+    /** @brief Where a tile is */
+    struct Entry
+    {
+        uint64_t offset;   ///< Byte offset in the file, 0 while the tile is missing
+        uint32_t size;     ///< Encoded bytes
+        uint32_t checksum; ///< FNV-1a of the encoded bytes
+    };
+
+    static_assert(sizeof(Header) == 64, "Header layout");
+    static_assert(sizeof(Entry) == 16, "Entry layout");
+
+private:
+    int file = -1;
+    Header header{};
+    uint8_t *mapping = nullptr; ///< Header and index, mapped from the page-aligned start of the file
+    Entry *index = nullptr;
+    size_t mappedBytes = 0;
+    std::atomic<uint64_t> end{0}; ///< Where the next tile is appended
+
+    static uint32_t checksum(const uint8_t *data, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+
+        return hash;
+    }
+
+    static bool readAll(int descriptor, uint8_t *data, size_t size, uint64_t offset)
+    {
+        while (size > 0)
+        {
+            const ssize_t done = pread(descriptor, data, size, static_cast<off_t>(offset));
+
+            if (done <= 0)
+            {
+                return false;
+            }
+
+            data += done;
+            size -= static_cast<size_t>(done);
+            offset += static_cast<uint64_t>(done);
+        }
+
+        return true;
+    }
+
+    static bool writeAll(int descriptor, const uint8_t *data, size_t size, uint64_t offset)
+    {
+        while (size > 0)
+        {
+            const ssize_t done = pwrite(descriptor, data, size, static_cast<off_t>(offset));
+
+            if (done <= 0)
+            {
+                return false;
+            }
+
+            data += done;
+            size -= static_cast<size_t>(done);
+            offset += static_cast<uint64_t>(done);
+        }
+
+        return true;
+    }
+
+    /** @brief Clear the entries that point past the end of the file or whose data does not match */
+    size_t validate(uint64_t fileSize)
+    {
+        std::vector<uint8_t> data;
+        size_t kept = 0;
+
+        for (size_t i = 0; i < GetTileCount(); ++i)
+        {
+            Entry &entry = index[i];
+
+            if (entry.offset == 0)
+            {
+                continue;
+            }
+
+            data.resize(entry.size);
+            const bool valid = entry.offset >= GetDataOffset() && entry.offset + entry.size <= fileSize &&
+                               readAll(file, data.data(), entry.size, entry.offset) &&
+                               checksum(data.data(), entry.size) == entry.checksum;
+
+            if (!valid)
+            {
+                entry = Entry{};
+            }
+
+            kept += valid ? 1 : 0;
+        }
+
+        return kept;
+    }
+
+public:
+    TiledImage() = default;
+    TiledImage(const TiledImage &) = delete;
+    TiledImage &operator=(const TiledImage &) = delete;
+
+    ~TiledImage() { Close(); }
+
+    /** @brief Fill the fixed fields of a header */
+    static Header MakeHeader(uint32_t width, uint32_t height, uint16_t tileSize, uint16_t iterations)
+    {
+        Header result{};
+        std::memcpy(result.magic, Magic, sizeof(Magic));
+        result.width = width;
+        result.height = height;
+        result.tileSize = tileSize;
+        result.iterations = iterations;
+        return result;
+    }
+
+    /** @brief Create the file, or resume it when it holds the same image
+     * @param path File name
+     * @param description Image to store, see MakeHeader()
+     * @param resumed Receives the tiles already on disk
+     * @param error Receives what went wrong
+     * @return false when the file cannot be used, or holds another image
+     */
+    bool Create(const std::string &path, const Header &description, size_t &resumed, std::string &error)
+    {
+        Close();
+        header = description;
+        resumed = 0;
+        file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+        if (file < 0)
+        {
+            error = path + ": cannot open";
+            return false;
+        }
+
+        struct stat status;
+        fstat(file, &status);
+        mappedBytes = static_cast<size_t>(GetDataOffset());
+
+        if (status.st_size > 0)
+        {
+            Header existing;
+
+            if (!readAll(file, reinterpret_cast<uint8_t *>(&existing), sizeof(existing), 0) ||
+                std::memcmp(&existing, &header, sizeof(header)) != 0)
+            {
+                error = path + ": holds another image, not resuming over it";
+                Close();
+                return false;
+            }
+
+            // Cut short while the index was being laid out
+            if (static_cast<uint64_t>(status.st_size) < GetDataOffset() &&
+                ftruncate(file, static_cast<off_t>(GetDataOffset())) != 0)
+            {
+                error = path + ": cannot extend the index";
+                Close();
+                return false;
+            }
+        }
+        else if (!writeAll(file, reinterpret_cast<const uint8_t *>(&header), sizeof(header), 0) ||
+                 ftruncate(file, static_cast<off_t>(GetDataOffset())) != 0)
+        {
+            error = path + ": cannot write the header";
+            Close();
+            return false;
+        }
+
+        void *mapped = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+        if (mapped == MAP_FAILED)
+        {
+            error = path + ": cannot map the index";
+            Close();
+            return false;
+        }
+
+        mapping = static_cast<uint8_t *>(mapped);
+        index = reinterpret_cast<Entry *>(mapping + sizeof(Header));
+        const uint64_t fileSize = std::max<uint64_t>(static_cast<uint64_t>(status.st_size), GetDataOffset());
+        resumed = status.st_size > 0 ? validate(fileSize) : 0;
+        end = fileSize > GetDataOffset() ? fileSize : GetDataOffset();
+        return true;
+    }
+
+    /** @brief Open an existing file for reading */
+    bool Open(const std::string &path, std::string &error)
+    {
+        Close();
+        file = open(path.c_str(), O_RDONLY);
+
+        if (file < 0 || !readAll(file, reinterpret_cast<uint8_t *>(&header), sizeof(header), 0) ||
+            std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.tileSize == 0)
+        {
+            error = path + ": not a tiled image";
+            Close();
+            return false;
+        }
+
+        struct stat status;
+        fstat(file, &status);
+        mappedBytes = static_cast<size_t>(GetDataOffset());
+
+        if (static_cast<uint64_t>(status.st_size) < GetDataOffset())
+        {
+            error = path + ": index cut short";
+            Close();
+            return false;
+        }
+
+        void *mapped = mmap(nullptr, mappedBytes, PROT_READ, MAP_SHARED, file, 0);
+
+        if (mapped == MAP_FAILED)
+        {
+            error = path + ": cannot map the index";
+            Close();
+            return false;
+        }
+
+        mapping = static_cast<uint8_t *>(mapped);
+        index = reinterpret_cast<Entry *>(mapping + sizeof(Header));
+        return true;
+    }
+
+    /** @brief Flush the index and close the file */
+    void Close()
+    {
+        if (mapping != nullptr)
+        {
+            msync(mapping, mappedBytes, MS_SYNC);
+            munmap(mapping, mappedBytes);
+            mapping = nullptr;
+            index = nullptr;
+        }
+
+        if (file >= 0)
+        {
+            close(file);
+            file = -1;
+        }
+    }
+
+    const Header &GetHeader() const { return header; }
+
+    uint32_t GetColumns() const { return (header.width + header.tileSize - 1) / header.tileSize; }
+
+    uint32_t GetRows() const { return (header.height + header.tileSize - 1) / header.tileSize; }
+
+    size_t GetTileCount() const { return static_cast<size_t>(GetColumns()) * GetRows(); }
+
+    /** @brief Where the tiles start, after the header and the index */
+    uint64_t GetDataOffset() const { return sizeof(Header) + GetTileCount() * sizeof(Entry); }
+
+    /** @brief Pixel rectangle of a tile, clipped to the image */
+    void GetRect(size_t tile, uint32_t &x, uint32_t &y, uint32_t &width, uint32_t &height) const
+    {
+        x = static_cast<uint32_t>(tile % GetColumns()) * header.tileSize;
+        y = static_cast<uint32_t>(tile / GetColumns()) * header.tileSize;
+        width = std::min<uint32_t>(header.tileSize, header.width - x);
+        height = std::min<uint32_t>(header.tileSize, header.height - y);
+    }
+
+    /** @brief Whether a tile is on disk */
+    bool HasTile(size_t tile) const { return index[tile].offset != 0; }
+
+    /** @brief Append a tile and list it in the index, safe from several threads
+     * @param tile Tile number, row-major
+     * @param pixels Palette indices of the tile rectangle, row by row
+     * @param scratch Encoding buffer, kept by the caller between tiles
+     */
+    bool WriteTile(size_t tile, const uint8_t *pixels, std::vector<uint8_t> &scratch)
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+        GetRect(tile, x, y, width, height);
+
+        const size_t length = static_cast<size_t>(width) * height;
+        scratch.resize(length + length / 128 + 1);
+        const size_t size = ZoomStream::EncodeFrame(pixels, length, scratch.data());
+        const uint64_t offset = end.fetch_add(size);
+
+        if (!writeAll(file, scratch.data(), size, offset))
+        {
+            return false;
+        }
+
+        Entry &entry = index[tile];
+        entry.size = static_cast<uint32_t>(size);
+        entry.checksum = checksum(scratch.data(), size);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.offset = offset;
+        return true;
+    }
+
+    /** @brief Decode a tile
+     * @param tile Tile number, row-major
+     * @param pixels Receives the palette indices of the tile rectangle, row by row
+     * @return false when the tile is missing or damaged
+     */
+    bool ReadTile(size_t tile, std::vector<uint8_t> &pixels) const
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+        GetRect(tile, x, y, width, height);
+
+        const Entry entry = index[tile];
+        std::vector<uint8_t> data(entry.size);
+        pixels.resize(static_cast<size_t>(width) * height);
+
+        return entry.offset != 0 &&
+               readAll(file, data.data(), entry.size, entry.offset) &&
+               checksum(data.data(), entry.size) == entry.checksum &&
+               ZoomStream::DecodeFrame(data.data(), entry.size, pixels.data(), pixels.size());
+    }
+};
@@ -0,0 +1,260 @@
+// Host encoder for pre-rendered zoom streams played by ZoomPlayer.
+//
+// Renders a geometric zoom towards a point with the shared Mandelbrot kernel
+// and writes the frames as a ZoomStream file (see src/zoom_stream_format.hpp).
+// Frames whose pixels are too close for double are rendered in double-double,
+// so the center takes all the digits it is given and --end goes to about 1e-28.
+//
+// Usage:
+//   zoomenc [--center RE IM] [--start SPAN] [--end SPAN] [--frames N]
+//           [--size WxH] [--iterations N] [--fields N] [--out FILE]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "double_double.hpp"
+#include "mandelbrot_kernel.hpp"
+#include "zoom_stream_format.hpp"
+
+namespace
+{
+    /** @brief Encoder settings, defaults match the Saturn renderer */
+    struct Options
+    {
+        DoubleDouble centerReal = DoubleDouble(-0.743643887037151);
+        DoubleDouble centerImag = DoubleDouble(0.131825904205330);
+        double startSpan = 3.0;    ///< Real span of the first frame
+        double endSpan = 3.0e-4;   ///< Real span of the last frame
+        double aspect = 2.0 / 3.0; ///< Imaginary span / real span, as the default view
+        int frames = 300;
+        int width = 160;  ///< Pixel-doubled to 320x224 by the player
+        int height = 112;
+        int iterations = 256;
+        int fields = 0; ///< Fields per frame, 0 for the fewest the drive keeps up with, at least 2
+        std::string out = "cd/data/ZOOM.MZS";
+    };
+
+    void usage()
+    {
+        std::fprintf(stderr,
+                     "usage: zoomenc [--center RE IM] [--start SPAN] [--end SPAN] [--frames N]\n"
+                     "               [--size WxH] [--iterations N] [--fields N] [--out FILE]\n");
+    }
+
+    bool parse(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "--center" && i + 2 < argc)
+            {
+                const bool real = DoubleDouble::Parse(argv[++i], options.centerReal);
+
+                if (!DoubleDouble::Parse(argv[++i], options.centerImag) || !real)
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--start" && hasValue)
+            {
+                options.startSpan = std::atof(argv[++i]);
+            }
+            else if (arg == "--end" && hasValue)
+            {
+                options.endSpan = std::atof(argv[++i]);
+            }
+            else if (arg == "--frames" && hasValue)
+            {
+                options.frames = std::atoi(argv[++i]);
+            }
+            else if (arg == "--size" && hasValue)
+            {
+                if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2)
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--iterations" && hasValue)
+            {
+                options.iterations = std::atoi(argv[++i]);
+            }
+            else if (arg == "--fields" && hasValue)
+            {
+                options.fields = std::atoi(argv[++i]);
+            }
+            else if (arg == "--out" && hasValue)
+            {
+                options.out = argv[++i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return options.frames > 0 && options.frames <= 0xFFFF &&
+               options.width > 1 && options.height > 1 &&
+               options.iterations > 0 && options.iterations <= 0xFFFF &&
+               options.fields >= 0 && options.startSpan > 0.0 && options.endSpan > 0.0;
+    }
+
+    constexpr int DriveSectorsPerSecond = 150; ///< What a 2x CD drive sustains
+    constexpr int FieldsPerSecond = 60;        ///< NTSC
+
+    /** @brief Render one frame into palette indices, mapped like the renderer */
+    template <typename RealT>
+    void render(const Options &options, double span, std::vector<uint8_t> &pixels)
+    {
+        const DoubleDouble stepReal = DoubleDouble(span) / DoubleDouble(options.width - 1);
+        const DoubleDouble stepImag = DoubleDouble(span * options.aspect) / DoubleDouble(options.height - 1);
+        const DoubleDouble minReal = options.centerReal - DoubleDouble(span / 2.0);
+        const DoubleDouble minImag = options.centerImag - DoubleDouble(span * options.aspect / 2.0);
+
+        for (int y = 0; y < options.height; ++y)
+        {
+            const RealT imag = static_cast<RealT>(minImag + stepImag * DoubleDouble(y));
+
+            for (int x = 0; x < options.width; ++x)
+            {
+                const uint16_t iteration = IterateMandelbrot(static_cast<RealT>(minReal + stepReal * DoubleDouble(x)),
+                                                             imag,
+                                                             static_cast<uint16_t>(options.iterations));
+                pixels[y * options.width + x] = static_cast<uint8_t>(iteration % 256);
+            }
+        }
+    }
+
+    void pad(std::vector<uint8_t> &data)
+    {
+        data.resize(ZoomStream::ToSectors(data.size()) * ZoomStream::SectorSize, 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    if (!parse(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+
+    const size_t length = static_cast<size_t>(options.width) * options.height;
+    std::vector<uint8_t> pixels(length);
+    std::vector<uint8_t> encoded(length + length / 128 + 1);
+    std::vector<uint8_t> frames;
+    std::vector<uint16_t> sectors;
+    size_t rawBytes = 0;
+    int deepFrames = 0;
+
+    for (int frame = 0; frame < options.frames; ++frame)
+    {
+        const double t = options.frames > 1 ? static_cast<double>(frame) / (options.frames - 1) : 0.0;
+        const double span = options.startSpan * std::pow(options.endSpan / options.startSpan, t);
+
+        const bool deep = span / (options.width - 1) < DoubleDoubleStep;
+
+        if (deep)
+        {
+            render<DoubleDouble>(options, span, pixels);
+            ++deepFrames;
+        }
+        else
+        {
+            render<double>(options, span, pixels);
+        }
+
+        const size_t size = ZoomStream::EncodeFrame(pixels.data(), length, encoded.data());
+        std::vector<uint8_t> block(ZoomStream::FrameHeaderSize + size);
+        ZoomStream::Write32(block.data(), static_cast<uint32_t>(size));
+        std::memcpy(block.data() + ZoomStream::FrameHeaderSize, encoded.data(), size);
+        pad(block);
+
+        sectors.push_back(static_cast<uint16_t>(block.size() / ZoomStream::SectorSize));
+        frames.insert(frames.end(), block.begin(), block.end());
+        rawBytes += length;
+
+        std::fprintf(stderr, "\rframe %d/%d: %zu bytes", frame + 1, options.frames, size);
+    }
+
+    std::fprintf(stderr, "\n");
+
+    ZoomStream::Header header{};
+    header.width = static_cast<uint16_t>(options.width);
+    header.height = static_cast<uint16_t>(options.height);
+    header.frameCount = static_cast<uint16_t>(options.frames);
+    header.headerSectors = static_cast<uint16_t>(ZoomStream::ToSectors(ZoomStream::HeaderSize + sectors.size() * sizeof(uint16_t)));
+    header.maxFrameSectors = 0;
+
+    for (uint16_t count : sectors)
+    {
+        header.maxFrameSectors = std::max(header.maxFrameSectors, count);
+    }
+
+    // ZoomPlayer has two frame buffers: a frame is read while the one before it is shown,
+    // so the largest one has to arrive within a single frame slot, not just on average
+    const int neededFields = (header.maxFrameSectors * FieldsPerSecond + DriveSectorsPerSecond - 1) / DriveSectorsPerSecond;
+    const int fields = options.fields > 0 ? options.fields : std::max(2, neededFields);
+    header.fieldsPerFrame = static_cast<uint16_t>(fields);
+
+    std::vector<uint8_t> head(ZoomStream::HeaderSize + sectors.size() * sizeof(uint16_t));
+    ZoomStream::WriteHeader(head.data(), header);
+
+    for (size_t i = 0; i < sectors.size(); ++i)
+    {
+        ZoomStream::Write16(head.data() + ZoomStream::HeaderSize + i * sizeof(uint16_t), sectors[i]);
+    }
+
+    pad(head);
+
+    FILE *file = std::fopen(options.out.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        std::perror(options.out.c_str());
+        return 1;
+    }
+
+    const bool written = std::fwrite(head.data(), 1, head.size(), file) == head.size() &&
+                         std::fwrite(frames.data(), 1, frames.size(), file) == frames.size();
+    std::fclose(file);
+
+    if (!written)
+    {
+        std::fprintf(stderr, "%s: write failed\n", options.out.c_str());
+        return 1;
+    }
+
+    const double seconds = static_cast<double>(options.frames * fields) / FieldsPerSecond;
+    const double sectorsPerSecond = static_cast<double>(frames.size() / ZoomStream::SectorSize) / seconds;
+    const int peakSectorsPerSecond = header.maxFrameSectors * FieldsPerSecond / fields;
+
+    std::printf("%s: %d frames (%d in double-double), %zu bytes (%.1f%% of raw), %d fields per frame, "
+                "%.0f sectors/s on average, largest frame %d sectors, %d sectors/s\n",
+                options.out.c_str(),
+                options.frames,
+                deepFrames,
+                head.size() + frames.size(),
+                100.0 * static_cast<double>(frames.size()) / static_cast<double>(rawBytes),
+                fields,
+                sectorsPerSecond,
+                header.maxFrameSectors,
+                peakSectorsPerSecond);
+
+    if (fields < neededFields)
+    {
+        std::printf("warning: the largest frames need more than the %d sectors/s of a 2x drive and will be late, use --fields %d or lower --size\n",
+                    DriveSectorsPerSecond,
+                    neededFields);
+    }
+
+    return 0;
+}